@@ -4,6 +4,9 @@
 #include "app/common.h"
 #include "app/config.h"
 #include "app/controller_base.h"
+#include "app/ik_portfolio.h"
+#include "app/nullspace_ik.h"
+#include "app/reachability_map.h"
 #include "app/solver.h"
 #include "hardware/arx_can.h"
 #include "utils.h"
@@ -26,11 +29,46 @@ class Arx5CartesianController : public Arx5ControllerBase
     Arx5CartesianController(std::string model, std::string interface_name);
 
     void set_eef_cmd(EEFState new_cmd);
-    void set_eef_traj(std::vector<EEFState> new_traj);
+    // The returned handle reports the progress and resolves when the trajectory ends or is overridden
+    std::shared_ptr<TrajHandle> set_eef_traj(std::vector<EEFState> new_traj);
     EEFState get_eef_cmd();
+    // Same as above with quaternion poses. The RPY versions are converted and forwarded to these.
+    void set_eef_cmd(EEFStateSE3 new_cmd);
+    std::shared_ptr<TrajHandle> set_eef_traj(std::vector<EEFStateSE3> new_traj);
+    std::shared_ptr<TrajHandle> set_eef_traj(const EEFTrajectory &new_traj);
+    EEFStateSE3 get_eef_cmd_se3();
+
+    // Move the eef at a constant velocity: (vx, vy, vz) in m/s and angular velocity (wx, wy, wz) in rad/s, both in
+    // the base frame; gripper_vel in m/s. The control thread integrates the twist every tick within
+    // robot_config.ee_vel_max and the controller_config.eef_twist_*_acc_max limits, and decelerates the arm to a stop
+    // when the command is not refreshed within `timeout` seconds. Any other command leaves the twist mode.
+    void set_eef_twist(Pose6d twist, double timeout = 0.1, double gripper_vel = 0.0);
 
     std::tuple<int, Eigen::VectorXd> multi_trial_ik(Eigen::Matrix<double, 6, 1> target_pose_6d,
                                                     Eigen::VectorXd current_joint_pos, int additional_trial_num = 5);
+
+    // Only available when controller_config.ik_method is "portfolio", otherwise empty
+    std::vector<IkSolverStats> get_ik_portfolio_stats();
+
+    // O(1) check against the reachability map. Always true if the map is not loaded.
+    bool is_reachable(Pose6d pose_6d);
+    bool is_reachable(PoseSE3 pose);
+
+  private:
+    std::shared_ptr<Arx5IkPortfolio> ik_portfolio_;
+    std::shared_ptr<Arx5NullspaceIk> nullspace_ik_;
+    std::shared_ptr<ReachabilityMap> reachability_map_;
+    // Dispatch to multi_trial_ik, the IK portfolio or the nullspace IK according to controller_config.ik_method.
+    // target_pose_6d is the same target, passed as given by the RPY entry points so that multi_trial_ik does not
+    // round-trip it through a quaternion.
+    std::tuple<int, Eigen::VectorXd> solve_ik_(const PoseSE3 &target_pose, const Pose6d &target_pose_6d,
+                                               Eigen::VectorXd current_joint_pos);
+    // Shared by the RPY and quaternion overloads, target_poses_6d has a row per waypoint of new_traj
+    void set_eef_cmd_(EEFStateSE3 new_cmd, const Pose6d &target_pose_6d);
+    std::shared_ptr<TrajHandle> set_eef_traj_(std::vector<EEFStateSE3> new_traj,
+                                              const Eigen::MatrixXd &target_poses_6d);
+    // Restart the cartesian interpolation from the current eef command. Should be called with cmd_mutex_ locked.
+    void restart_eef_interpolation_(double current_time);
 };
 } // namespace arx
 
@@ -0,0 +1,53 @@
+#ifndef CLOCK_DOMAIN_H
+#define CLOCK_DOMAIN_H
+
+#include <mutex>
+#include <string>
+
+namespace arx
+{
+
+struct LatencyStats
+{
+    long int count = 0;
+    double last = 0.0; // s
+    double mean = 0.0; // s, exponential moving average
+    double max = 0.0;  // s
+};
+
+// Translation between the controller time (Arx5ControllerBase::get_timestamp, seconds since the controller started)
+// and the system clocks, so that other processes can timestamp commands without querying the controller:
+//   "monotonic": CLOCK_MONOTONIC (std::chrono::steady_clock), shared by all processes of the machine, never jumps
+//   "realtime": CLOCK_REALTIME, the wall clock, can be stepped or slewed by NTP
+//   "tai": CLOCK_TAI, the realtime clock without leap seconds, e.g. disciplined by PTP across machines
+//   "controller": the controller time itself
+// The offsets of "realtime" and "tai" are measured again at every call, so clock adjustments are followed.
+class ClockDomain
+{
+  public:
+    ClockDomain(long int start_time_us);
+    ~ClockDomain() = default;
+
+    double now(std::string clock);
+    double to_controller_time(double time, std::string clock);
+    double from_controller_time(double controller_time, std::string clock);
+    // Time of the given clock when the controller time was 0
+    double get_epoch(std::string clock);
+
+    // Latency from a client timestamp (e.g. the observation or the send time of a command) to now
+    void record_latency(double client_time, std::string clock);
+    LatencyStats get_latency_stats();
+    void reset_latency_stats();
+
+    static void check_clock(std::string clock);
+
+  private:
+    const double LATENCY_EMA_ALPHA_ = 0.05;
+    const long int start_time_us_;
+    std::mutex latency_mutex_;
+    LatencyStats latency_stats_;
+};
+
+} // namespace arx
+
+#endif
@@ -0,0 +1,122 @@
+#ifndef COLLISION_H
+#define COLLISION_H
+
+#include "app/common.h"
+#include "app/link_kinematics.h"
+#include <kdl/frames.hpp>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace arx
+{
+
+// Capsule (swept sphere of a segment) in the frame of its link
+struct CollisionCapsule
+{
+    std::string link_name;
+    Eigen::Vector3d p0;
+    Eigen::Vector3d p1;
+    double radius; // m
+};
+
+struct CollisionResult
+{
+    // Signed distance between the two closest capsules (negative for penetration), m.
+    // Links are empty and the distance is infinite if there is no pair to check.
+    double distance;
+    std::string link_a;
+    std::string link_b;
+    Eigen::Vector3d point_a; // closest points on the capsule surfaces, in the base frame of this arm
+    Eigen::Vector3d point_b;
+};
+
+// Self- and inter-arm collision checking on capsules fitted to the link meshes of the urdf.
+// The vertices of each link mesh (collision mesh first, then visual mesh) are enclosed by capsules along their
+// principal axis, split in halves while it makes the approximation noticeably tighter. Links without a mesh file use
+// their primitive geometry (cylinder, sphere, box) instead.
+// Distance queries run forward kinematics of all links in one pass (Arx5LinkKinematics), build a bounding volume
+// hierarchy over the capsules and only compute capsule distances for the node pairs that can be closer than the
+// current result (a few microseconds per query).
+class Arx5CollisionChecker
+{
+  public:
+    // Adjacent links, and link pairs that already overlap at the zero (home) joint position, are excluded from the
+    // self-collision check since their capsules are expected to intersect around the joints.
+    Arx5CollisionChecker(std::string urdf_path, int joint_dof, std::string base_link = "base_link",
+                         std::string eef_link = "eef_link");
+    ~Arx5CollisionChecker() = default;
+
+    // Minimum distance between the (non-excluded) links of this arm
+    CollisionResult self_distance(VecDoF joint_pos);
+    // Minimum distance between the links of this arm and another arm.
+    // other_base_pose is the pose of the other arm's base link in the base frame of this arm. The query uses the
+    // buffers of both checkers, so `other` must not be queried by another thread at the same time.
+    CollisionResult inter_arm_distance(VecDoF joint_pos, std::shared_ptr<Arx5CollisionChecker> other,
+                                       Pose6d other_base_pose, VecDoF other_joint_pos);
+
+    // Check every waypoint and the straight joint-space segments between them (subdivided so that no joint moves
+    // more than max_joint_step). Returns the index of the first waypoint whose incoming segment gets closer than
+    // min_distance, or -1 if the whole trajectory is valid.
+    int validate_trajectory(std::vector<JointState> joint_traj, double min_distance = 0.0,
+                            double max_joint_step = 0.05);
+    // Same for two arms moving at the same time (self collisions of both arms included). The trajectories must have
+    // the same length and are paired by index.
+    int validate_dual_trajectory(std::vector<JointState> joint_traj, std::shared_ptr<Arx5CollisionChecker> other,
+                                 Pose6d other_base_pose, std::vector<JointState> other_joint_traj,
+                                 double min_distance = 0.0, double max_joint_step = 0.05);
+
+    std::vector<CollisionCapsule> get_capsules();
+    std::vector<std::pair<std::string, std::string>> get_excluded_pairs();
+    // Exclude (or include again) a link pair from the self-collision check
+    void set_pair_excluded(std::string link_a, std::string link_b, bool excluded);
+
+  private:
+    struct WorldCapsule
+    {
+        Eigen::Vector3d p0;
+        Eigen::Vector3d p1;
+        double radius;
+        int index; // in capsules_
+        Eigen::Vector3d aabb_min;
+        Eigen::Vector3d aabb_max;
+    };
+    struct BvhNode
+    {
+        Eigen::Vector3d aabb_min;
+        Eigen::Vector3d aabb_max;
+        int left;  // child node index, -1 for leaves
+        int right;
+        int capsule; // index in the world capsule list for leaves, -1 for internal nodes
+    };
+    struct Bvh
+    {
+        std::vector<WorldCapsule> capsules;
+        std::vector<BvhNode> nodes;
+    };
+
+    const int MAX_SPLIT_DEPTH_ = 2; // up to 4 capsules per link
+    const int JOINT_DOF_;
+    Arx5LinkKinematics link_kinematics_;
+    std::vector<std::string> link_names_; // links with geometry, in chain order
+    std::vector<int> link_segments_;      // index in link_kinematics_ of each link, -1 for the base link
+    std::vector<CollisionCapsule> capsules_;
+    std::vector<int> capsule_links_; // index in link_names_
+    std::vector<std::vector<bool>> excluded_;
+
+    // Buffers reused by the queries, so the checker is not thread-safe
+    std::vector<int> capsule_ids_;
+    Bvh bvh_a_;
+    Bvh bvh_b_;
+
+    void fit_link_capsules_(std::string urdf_path, std::string base_link);
+    void build_bvh_(const VecDoF &joint_pos, const KDL::Frame &base_frame, Bvh &bvh);
+    int build_bvh_nodes_(Bvh &bvh, std::vector<int> &capsule_ids, int begin, int end);
+    void bvh_distance_(const Bvh &bvh_a, int node_a, const Bvh &bvh_b, int node_b, bool self, CollisionResult &result,
+                       int &best_a, int &best_b);
+};
+
+} // namespace arx
+
+#endif
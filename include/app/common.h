@@ -3,9 +3,11 @@
 
 #include <Eigen/Core>
 #include <Eigen/Dense>
+#include <Eigen/Geometry>
 #include <chrono>
 #include <cmath>
 #include <cstdarg>
+#include <stdexcept>
 #include <string>
 #include <thread>
 #include <vector>
@@ -72,6 +74,18 @@ struct JointState
 
 };
 
+// Filtered joint state (see JointKalmanFilter), the raw readings stay in JointState
+struct JointStateEstimate
+{
+    double timestamp = 0.0;
+    VecDoF pos; // rad
+    VecDoF vel; // rad/s
+    VecDoF acc; // rad/s^2
+    JointStateEstimate(int dof) : pos(VecDoF::Zero(dof)), vel(VecDoF::Zero(dof)), acc(VecDoF::Zero(dof))
+    {
+    }
+};
+
 struct Gain
 {
     VecDoF kp;
@@ -132,6 +146,229 @@ struct EEFState
     }
 };
 
+// Rigid transform as translation + unit quaternion. Unlike Pose6d (roll, pitch, yaw), it has no singularity at
+// pitch = +-pi/2, composes without trigonometric functions and interpolates smoothly (SLERP).
+struct PoseSE3
+{
+    Eigen::Vector3d pos;     // m
+    Eigen::Quaterniond quat; // normalized, w + xi + yj + zk
+    PoseSE3() : pos(Eigen::Vector3d::Zero()), quat(Eigen::Quaterniond::Identity())
+    {
+    }
+    PoseSE3(Eigen::Vector3d pos, Eigen::Quaterniond quat) : pos(pos), quat(quat.normalized())
+    {
+    }
+    PoseSE3(Eigen::Vector3d pos, Eigen::Matrix3d rot) : pos(pos), quat(Eigen::Quaterniond(rot).normalized())
+    {
+    }
+
+    // Same convention as Pose6d: R = Rz(yaw) * Ry(pitch) * Rx(roll)
+    static PoseSE3 from_pose_6d(const Pose6d &pose_6d)
+    {
+        Eigen::Quaterniond quat = Eigen::AngleAxisd(pose_6d[5], Eigen::Vector3d::UnitZ()) *
+                                  Eigen::AngleAxisd(pose_6d[4], Eigen::Vector3d::UnitY()) *
+                                  Eigen::AngleAxisd(pose_6d[3], Eigen::Vector3d::UnitX());
+        return PoseSE3(pose_6d.head<3>(), quat);
+    }
+    static PoseSE3 from_matrix(const Eigen::Matrix4d &matrix)
+    {
+        return PoseSE3(matrix.block<3, 1>(0, 3), Eigen::Matrix3d(matrix.block<3, 3>(0, 0)));
+    }
+    // Same rpy extraction as KDL::Rotation::GetRPY
+    Pose6d to_pose_6d() const
+    {
+        Eigen::Matrix3d rot = quat.toRotationMatrix();
+        Pose6d pose_6d;
+        pose_6d.head<3>() = pos;
+        double pitch = std::atan2(-rot(2, 0), std::sqrt(rot(0, 0) * rot(0, 0) + rot(1, 0) * rot(1, 0)));
+        pose_6d[4] = pitch;
+        if (std::abs(pitch) > M_PI / 2 - 1E-12)
+        {
+            pose_6d[3] = 0;
+            pose_6d[5] = std::atan2(-rot(0, 1), rot(1, 1));
+        }
+        else
+        {
+            pose_6d[3] = std::atan2(rot(2, 1), rot(2, 2));
+            pose_6d[5] = std::atan2(rot(1, 0), rot(0, 0));
+        }
+        return pose_6d;
+    }
+    Eigen::Matrix4d to_matrix() const
+    {
+        Eigen::Matrix4d matrix = Eigen::Matrix4d::Identity();
+        matrix.block<3, 3>(0, 0) = quat.toRotationMatrix();
+        matrix.block<3, 1>(0, 3) = pos;
+        return matrix;
+    }
+    Eigen::Matrix3d rotation_matrix() const
+    {
+        return quat.toRotationMatrix();
+    }
+
+    PoseSE3 operator*(const PoseSE3 &other) const
+    {
+        return PoseSE3(pos + quat * other.pos, quat * other.quat);
+    }
+    PoseSE3 inverse() const
+    {
+        Eigen::Quaterniond quat_inv = quat.conjugate();
+        return PoseSE3(-(quat_inv * pos), quat_inv);
+    }
+    // Linear interpolation of the position and SLERP (along the shortest arc) of the rotation, alpha in [0, 1]
+    PoseSE3 interpolate(const PoseSE3 &other, double alpha) const
+    {
+        return PoseSE3(pos + alpha * (other.pos - pos), quat.slerp(alpha, other.quat));
+    }
+};
+
+struct EEFStateSE3
+{
+    double timestamp = 0.0f;
+    PoseSE3 pose;
+    double gripper_pos = 0.0f;    // m; 0 for close, GRIPPER_WIDTH for fully open
+    double gripper_vel = 0.0f;    // s^{-1}
+    double gripper_torque = 0.0f; // Nm
+    EEFStateSE3()
+    {
+    }
+    EEFStateSE3(PoseSE3 pose, double gripper_pos) : pose(pose), gripper_pos(gripper_pos)
+    {
+    }
+    EEFStateSE3(const EEFState &eef_state)
+        : timestamp(eef_state.timestamp), pose(PoseSE3::from_pose_6d(eef_state.pose_6d)),
+          gripper_pos(eef_state.gripper_pos), gripper_vel(eef_state.gripper_vel),
+          gripper_torque(eef_state.gripper_torque)
+    {
+    }
+    EEFState to_eef_state() const
+    {
+        EEFState eef_state(pose.to_pose_6d(), gripper_pos);
+        eef_state.timestamp = timestamp;
+        eef_state.gripper_vel = gripper_vel;
+        eef_state.gripper_torque = gripper_torque;
+        return eef_state;
+    }
+};
+
+// Waypoints as rows, with the values of one waypoint contiguous in memory: a (waypoint number, dof) numpy array maps
+// to it without copy, and its transpose is a column-per-waypoint matrix (as in TrajDerivative)
+using TrajMatrix = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+
+// Joint trajectory as structure of arrays: one allocation per field instead of three per JointState waypoint
+struct JointTrajectory
+{
+    Eigen::VectorXd timestamps;
+    TrajMatrix pos;              // waypoint number x dof, rad
+    TrajMatrix vel;              // waypoint number x dof, rad/s
+    TrajMatrix torque;           // waypoint number x dof, Nm
+    Eigen::VectorXd gripper_pos; // m
+    explicit JointTrajectory(int dof, int size = 0)
+        : timestamps(Eigen::VectorXd::Zero(size)), pos(TrajMatrix::Zero(size, dof)), vel(TrajMatrix::Zero(size, dof)),
+          torque(TrajMatrix::Zero(size, dof)), gripper_pos(Eigen::VectorXd::Zero(size))
+    {
+    }
+    // The vel and torque of the waypoints are copied if set, otherwise left at zero
+    JointTrajectory(const std::vector<JointState> &traj)
+        : JointTrajectory(traj.empty() ? 0 : int(traj[0].pos.size()), int(traj.size()))
+    {
+        for (int i = 0; i < size(); i++)
+        {
+            if (traj[i].pos.size() != dof())
+                throw std::invalid_argument("Joint state dimension mismatch");
+            set_state(i, traj[i]);
+        }
+    }
+    int size() const
+    {
+        return int(timestamps.size());
+    }
+    int dof() const
+    {
+        return int(pos.cols());
+    }
+    // The fields can be assigned separately (e.g. from Python), so check that their sizes agree before use
+    void check() const
+    {
+        if (pos.rows() != size() || vel.rows() != size() || torque.rows() != size() || gripper_pos.size() != size() ||
+            vel.cols() != dof() || torque.cols() != dof())
+            throw std::invalid_argument("Joint trajectory fields must have " + std::to_string(size()) +
+                                        " rows and " + std::to_string(dof()) + " columns");
+    }
+    // Keeps the first waypoints, new ones are uninitialized
+    void resize(int size)
+    {
+        timestamps.conservativeResize(size);
+        pos.conservativeResize(size, Eigen::NoChange);
+        vel.conservativeResize(size, Eigen::NoChange);
+        torque.conservativeResize(size, Eigen::NoChange);
+        gripper_pos.conservativeResize(size);
+    }
+    JointState get_state(int index) const
+    {
+        JointState state(pos.row(index).transpose(), vel.row(index).transpose(), torque.row(index).transpose(),
+                         gripper_pos[index]);
+        state.timestamp = timestamps[index];
+        return state;
+    }
+    void set_state(int index, const JointState &state)
+    {
+        timestamps[index] = state.timestamp;
+        pos.row(index) = state.pos.transpose();
+        if (state.vel.size() == dof())
+            vel.row(index) = state.vel.transpose();
+        if (state.torque.size() == dof())
+            torque.row(index) = state.torque.transpose();
+        gripper_pos[index] = state.gripper_pos;
+    }
+    std::vector<JointState> to_states() const
+    {
+        std::vector<JointState> traj;
+        traj.reserve(size());
+        for (int i = 0; i < size(); i++)
+            traj.push_back(get_state(i));
+        return traj;
+    }
+};
+
+// End effector trajectory as structure of arrays, the poses as (x, y, z, roll, pitch, yaw) rows
+struct EEFTrajectory
+{
+    Eigen::VectorXd timestamps;
+    Eigen::Matrix<double, Eigen::Dynamic, 6, Eigen::RowMajor> pose_6d;
+    Eigen::VectorXd gripper_pos; // m
+    explicit EEFTrajectory(int size = 0)
+        : timestamps(Eigen::VectorXd::Zero(size)),
+          pose_6d(Eigen::Matrix<double, Eigen::Dynamic, 6, Eigen::RowMajor>::Zero(size, 6)),
+          gripper_pos(Eigen::VectorXd::Zero(size))
+    {
+    }
+    EEFTrajectory(const std::vector<EEFState> &traj) : EEFTrajectory(int(traj.size()))
+    {
+        for (int i = 0; i < size(); i++)
+        {
+            timestamps[i] = traj[i].timestamp;
+            pose_6d.row(i) = traj[i].pose_6d.transpose();
+            gripper_pos[i] = traj[i].gripper_pos;
+        }
+    }
+    int size() const
+    {
+        return int(timestamps.size());
+    }
+    void check() const
+    {
+        if (pose_6d.rows() != size() || gripper_pos.size() != size())
+            throw std::invalid_argument("EEF trajectory fields must have " + std::to_string(size()) + " rows");
+    }
+    EEFStateSE3 get_state(int index) const
+    {
+        EEFStateSE3 state(PoseSE3::from_pose_6d(pose_6d.row(index).transpose()), gripper_pos[index]);
+        state.timestamp = timestamps[index];
+        return state;
+    }
+};
+
 } // namespace arx
 
 #define sleep_ms(x) std::this_thread::sleep_for(std::chrono::milliseconds(x))
@@ -18,8 +18,8 @@ class RobotConfig
     VecDoF joint_pos_max;
     VecDoF joint_vel_max;    // rad/s
     VecDoF joint_torque_max; // N*m
-    Pose6d ee_vel_max;       // Currently not in used
-    // end effector speed: m/s for (x, y, z), rad/s for (roll, pitch, yaw)
+    Pose6d ee_vel_max; // Used by the cartesian interpolation (controller_config.eef_interpolation) and set_eef_twist
+    // end effector speed: m/s for (x, y, z), rad/s for rotation around (x, y, z)
 
     double gripper_vel_max; // m/s
     double gripper_torque_max;
@@ -43,6 +43,10 @@ class RobotConfig
 
     std::string urdf_path;
 
+    // Offline reachability map used by the cartesian controller (generated by `make reachability_maps`).
+    // Set to an empty string to disable.
+    std::string reachability_map_path = std::string(SDK_ROOT) + "/models/reachability/" + robot_model + ".rmap";
+
     RobotConfig(std::string robot_model, VecDoF joint_pos_min, VecDoF joint_pos_max, VecDoF joint_vel_max,
                 VecDoF joint_torque_max, Pose6d ee_vel_max, double gripper_vel_max, double gripper_torque_max,
                 double gripper_width, double gripper_open_readout, int joint_dof, std::vector<int> motor_id,
@@ -249,6 +253,108 @@ class ControllerConfig
     //       X5 cannot be kept in the air.
     std::string interpolation_method; // "linear" or "cubic" (cubic is not well supported yet)
     double default_preview_time;      // The default value for preview time if the command has 0 timestamp
+    // A new joint command or trajectory restarts the interpolation from the current position. With a positive
+    // override_blend_time, the previous velocity and acceleration are also kept and faded into the new trajectory by
+    // a quintic polynomial over this time, which avoids jerks at high command rates. 0 restarts without blending.
+    double override_blend_time = 0.0; // s
+    // Clock of the command timestamps (see ClockDomain): "controller" (get_timestamp), "monotonic", "realtime" or
+    // "tai". Other clocks are converted to the controller time when a command arrives; 0 still means "now + preview".
+    std::string command_clock = "controller";
+    // Waypoint velocities of set_joint_traj and set_eef_traj (see TrajDerivative): "window" (finite differences
+    // averaged over 0.05s) or "spline" (C2 cubic spline from the current command velocity, stopping at the last
+    // waypoint). Only used by the "cubic" interpolation_method and as velocity feedforward.
+    std::string traj_vel_method = "window";
+
+    // Joint state estimator (Arx5ControllerBase::get_joint_state_estimate, see JointKalmanFilter), run on every reading
+    double estimator_pos_noise = 5e-4; // rad, standard deviation of the position reading
+    double estimator_vel_noise = 0.05; // rad/s, standard deviation of the velocity reading
+    double estimator_jerk_noise = 100; // (rad/s^3)^2/Hz, higher values track faster but filter less
+
+    // Inverse kinematics method of the cartesian controller:
+    // "multi_trial" (KDL LMA with random restarts), "portfolio" (parallel solvers, see Arx5IkPortfolio)
+    // or "nullspace" (single redundancy-aware solve, recommended for 7-DoF arms, see Arx5NullspaceIk)
+    std::string ik_method = "multi_trial";
+    double ik_timeout = 0.005; // s, only used by "portfolio"
+    // Ignore eef commands and skip waypoints that are out of the reachability map (robot_config.reachability_map_path)
+    // instead of trying the IK, each one publishes EventType::UNREACHABLE. The map is sampled and may miss reachable
+    // poses, so by default it only seeds the IK.
+    bool reachability_reject = false;
+
+    // How the cartesian controller moves between eef waypoints:
+    // "joint": IK on every waypoint, then interpolation in joint space (straight cartesian paths may bow)
+    // "cartesian": the pose is interpolated at every control tick (translation according to interpolation_method,
+    //              SLERP rotation), limited by robot_config.ee_vel_max and converted by differential IK
+    std::string eef_interpolation = "joint";
+
+    // Acceleration limit of the joint velocity mode (Arx5JointController::set_joint_vel), also applied when the
+    // velocity command times out and the joints decelerate to zero
+    double joint_acc_max = 20.0; // rad/s^2
+
+    // Acceleration limits of the eef twist mode (Arx5CartesianController::set_eef_twist), also applied when the twist
+    // times out and the eef decelerates to a stop
+    double eef_twist_lin_acc_max = 2.0;  // m/s^2
+    double eef_twist_ang_acc_max = 10.0; // rad/s^2
+
+    // The arm is set to damping when the torque streaming (Arx5JointController::set_joint_torque) stops for longer
+    double joint_torque_timeout = 0.02; // s
+
+    // Temporal ensembling of action chunks (Arx5JointController::submit_action_chunk): at every tick, the actions of
+    // all in-flight chunks at the current time are averaged with weights exp(-chunk_ensemble_decay * chunk age), the
+    // age counting from the observation of the chunk. Positive values favor the newest chunks, negative values the
+    // oldest ones (as in ACT). Chunks fade in and out over chunk_fade_time so that the command stays continuous; a
+    // chunk that fades in alone is blended with the previous command.
+    double chunk_ensemble_decay = 0.0; // 1/s
+    double chunk_fade_time = 0.05;     // s
+    int chunk_max_num = 8;             // The oldest chunk is dropped when more chunks are in flight
+
+    // Per-tick collision guard (see Arx5CollisionChecker): the joint position command is held whenever it would bring
+    // two links (of this arm, or of the peer arm set by `set_collision_peer`) closer than collision_min_distance.
+    // The capsules already enclose the meshes, so 0 still leaves some clearance between the real links.
+    bool collision_check = false;
+    double collision_min_distance = 0.0; // m
+
+    // Contact detection: a contact starts when the external torque of any joint exceeds contact_torque_threshold
+    // (empty: 30% of robot_config.joint_torque_max), and is handled once by contact_reaction:
+    //   "none": only reported (Arx5ControllerBase::is_contact_detected)
+    //   "stop": the current command is dropped and the arm holds the measured position
+    //   "retract": the arm moves back by contact_retract_distance along the external torque, then holds
+    //   "damping": the arm is set to damping (kp = 0)
+    // The external joint torques (Arx5ControllerBase::get_external_torque, see Arx5MomentumObserver) are estimated
+    // every tick from the measured motor torques, only while contact detection is enabled. The estimate lags by about
+    // 1 / momentum_observer_gain.
+    bool contact_detection = false;
+    double momentum_observer_gain = 100.0; // 1/s
+    VecDoF contact_torque_threshold; // Nm
+    std::string contact_reaction = "stop";
+    double contact_retract_distance = 0.05; // rad, norm over all joints
+    double contact_retract_time = 0.1;      // s
+
+    // Grasp mode of the gripper (Arx5ControllerBase::grasp, see GripperController). The object is grasped once the
+    // gripper stays below grasp_contact_vel while pushing with at least grasp_contact_ratio of the grasp torque for
+    // grasp_contact_time. Closing below grasp_min_width means that the grasp missed (or the object was lost), and
+    // closing further than grasp_slip_distance from the grasp width while holding is reported as a slip.
+    double grasp_contact_vel = 0.01; // m/s
+    double grasp_contact_ratio = 0.8;
+    double grasp_contact_time = 0.03;   // s
+    double grasp_min_width = 0.002;     // m
+    double grasp_slip_distance = 0.003; // m
+
+    // Load shedding (see LoadLevel): a tick overruns when its computation and CAN pacing (without the multi-rate
+    // tasks) take longer than controller_dt + overrun_tolerance. After overrun_escalate_cnt consecutive overruns, the
+    // control loop sheds one more level of optional work, up to load_shedding_max_level (0 disables it). It restores
+    // one level after overrun_recover_cnt consecutive ticks on time.
+    int load_shedding_max_level = 0;
+    double overrun_tolerance = 0.0005; // s
+    int overrun_escalate_cnt = 20;
+    int overrun_recover_cnt = 500;
+
+    // Multi-rate tasks (see TaskScheduler), run after the commands of the tick are sent. Gravity compensation is
+    // computed every gravity_comp_period (at least every tick) and extrapolated in between, diagnostics (see
+    // Arx5ControllerBase::get_diagnostics) every diagnostics_period unless the load is shed. The optional tasks are
+    // postponed once a tick has used task_budget_ratio of controller_dt.
+    double gravity_comp_period = 0.0; // s
+    double diagnostics_period = 0.02; // s
+    double task_budget_ratio = 0.8;
 
     ControllerConfig(std::string controller_type, VecDoF default_kp, VecDoF default_kd, double default_gripper_kp,
                      double default_gripper_kd, int over_current_cnt_max, double controller_dt,
@@ -264,6 +370,34 @@ class ControllerConfig
     }
 };
 
+// Joint mapping from a teleop leader to its follower (see Arx5ControllerBase::set_teleop_leader):
+//   follower_pos = joint_offset + joint_scale * leader_pos
+//   follower_vel = vel_feedforward * joint_scale * leader_vel (sent as velocity feedforward)
+//   follower_gripper_pos / follower_width = gripper_offset + gripper_scale * leader_gripper_pos / leader_width
+// With force feedback (bilateral teleop), the external torque of the follower is sent back to the leader:
+//   leader_torque = -force_feedback_scale * joint_scale * (follower_torque - follower_gravity_torque)
+//   leader_gripper_torque = -gripper_force_feedback_scale * follower_gripper_torque
+// A time-domain passivity controller adds damping to the leader torque whenever the feedback would inject energy
+// into the leader, so that delays and stiff contacts cannot make the coupling oscillate.
+class TeleopConfig
+{
+  public:
+    VecDoF joint_scale;
+    VecDoF joint_offset;                // rad
+    double vel_feedforward = 0.0;       // 0 to 1, compensates for the tracking delay of the follower
+    double gripper_scale = 1.0;
+    double gripper_offset = 0.0;
+    double leader_state_timeout = 0.05; // s, the follower holds its command if the leader state is older
+    double force_feedback_scale = 0.0;  // 0 disables the force feedback
+    double gripper_force_feedback_scale = 0.0;
+    double force_feedback_damping_max = 0.5; // Nm/(rad/s), upper bound of the passivity controller damping
+    double force_feedback_energy_max = 0.05; // J, dissipated energy that the feedback is allowed to give back
+
+    TeleopConfig(int joint_dof) : joint_scale(VecDoF::Ones(joint_dof)), joint_offset(VecDoF::Zero(joint_dof))
+    {
+    }
+};
+
 class ControllerConfigFactory
 {
   public:
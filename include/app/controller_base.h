@@ -1,11 +1,23 @@
 #ifndef CONTROLLER_BASE_H
 #define CONTROLLER_BASE_H
+#include "app/clock_domain.h"
+#include "app/collision.h"
 #include "app/common.h"
 #include "app/config.h"
+#include "app/differential_ik.h"
+#include "app/event_bus.h"
+#include "app/gripper_controller.h"
+#include "app/link_kinematics.h"
+#include "app/momentum_observer.h"
 #include "app/solver.h"
+#include "app/task_scheduler.h"
+#include "app/traj_derivative.h"
+#include "app/traj_handle.h"
 #include "hardware/arx_can.h"
 #include "utils.h"
+#include <atomic>
 #include <chrono>
+#include <deque>
 #include <memory>
 #include <mutex>
 #include <spdlog/sinks/stdout_color_sinks.h>
@@ -16,6 +28,54 @@
 
 namespace arx
 {
+// Where update_output_cmd_ takes the joint command from
+enum class CmdSource
+{
+    INTERPOLATOR, // interpolator_ (joint waypoints and trajectories)
+    EEF,          // eef_interpolator_ or the eef twist, converted by differential_ik_
+    JOINT_VEL,    // integrated joint velocity
+    JOINT_TORQUE, // torque streaming through joint_torque_mailbox_
+    TELEOP,       // mapped joint state of teleop_leader_
+    CHUNK,        // temporal ensembling of action_chunks_
+};
+
+// Optional work shed by the control loop when it overruns controller_dt, see controller_config.load_shedding_max_level.
+// Each level also sheds the work of the levels below.
+enum class LoadLevel
+{
+    NORMAL,
+    SHED_OPTIONAL, // No teleop force feedback, diagnostics or debug logs
+    REDUCED_RATE,  // Cartesian interpolation runs the differential IK every other tick and extrapolates in between
+    HOLD,          // The last command is held and new commands are discarded; the safety checks still run
+};
+
+// Computation time of the hard real-time part of each tick (safety checks, command update, CAN writes and state
+// update), without the CAN pacing sleeps, the multi-rate tasks (see get_task_stats) and the sleep until the next tick
+struct LoopStats
+{
+    long int count = 0;
+    long int overrun_count = 0; // See controller_config.overrun_tolerance
+    double last = 0.0;          // s
+    double mean = 0.0;          // s, exponential moving average
+    double max = 0.0;           // s
+};
+
+// Slow-changing state published by the diagnostics task, see controller_config.diagnostics_period
+struct Diagnostics
+{
+    double timestamp = 0.0;
+    PoseSE3 eef_pose;                  // Forward kinematics of the measured joint positions
+    Eigen::VectorXd motor_temperature; // Celsius, joints then gripper, as reported by the motors
+};
+
+// See Arx5JointController::submit_action_chunk
+struct ActionChunk
+{
+    std::vector<JointState> actions; // Absolute timestamps, the first action at observation_time
+    double observation_time;
+    double arrival_time; // The chunk fades in from here
+};
+
 class Arx5ControllerBase // parent class for the other two controllers
 {
   public:
@@ -23,12 +83,30 @@ class Arx5ControllerBase // parent class for the other two controllers
     ~Arx5ControllerBase();
     JointState get_joint_cmd();
     JointState get_joint_state();
+    // Position, velocity and acceleration filtered from the joint readings in the control thread
+    JointStateEstimate get_joint_state_estimate();
+    // External joint torques estimated by the momentum observer (zero unless controller_config.contact_detection)
+    VecDoF get_external_torque();
+    // Whether the external torque currently exceeds controller_config.contact_torque_threshold
+    bool is_contact_detected();
     EEFState get_eef_state();
+    EEFStateSE3 get_eef_state_se3();
     Pose6d get_home_pose();
     void set_gain(Gain new_gain);
     Gain get_gain();
 
     double get_timestamp();
+    // Conversion between the controller time and the system clocks, and command latency statistics
+    std::shared_ptr<ClockDomain> get_clock_domain();
+    // Safety trips, clipping, IK failures, contacts and trajectory completions, published by the control thread
+    std::shared_ptr<EventBus> get_event_bus();
+    LoopStats get_loop_stats();
+    void reset_loop_stats();
+    LoadLevel get_load_level();
+    // The hard real-time core of the control loop (its computation, as in LoopStats), then its multi-rate tasks
+    std::vector<TaskStats> get_task_stats();
+    void reset_task_stats();
+    Diagnostics get_diagnostics();
     RobotConfig get_robot_config();
     ControllerConfig get_controller_config();
     void set_log_level(spdlog::level::level_enum level);
@@ -36,6 +114,28 @@ class Arx5ControllerBase // parent class for the other two controllers
     void reset_to_home();
     void set_to_damping();
 
+    // Close the gripper at `speed` (m/s) until it grasps an object, then squeeze it with `torque` (Nm of the gripper
+    // motor) until release_grasp(), see GripperController. Meanwhile the gripper position of the joint and eef
+    // commands is ignored; after release_grasp() the gripper moves back to it. Requires a positive gripper kp.
+    void grasp(double torque, double speed = 0.05);
+    void release_grasp();
+    GraspState get_grasp_state();
+    double get_grasp_width();
+
+    // Also guard against collisions with another arm (requires controller_config.collision_check).
+    // peer_base_pose is the pose of the peer's base link in the base frame of this arm. The peer is not owned: it must
+    // outlive the pairing (this arm drops it in its destructor, and unpairs the peer too if it guards against this
+    // arm; the python bindings keep it alive). Pass nullptr to unpair.
+    void set_collision_peer(Arx5ControllerBase *peer, Pose6d peer_base_pose);
+
+    // Mirror another arm: every control tick, the joint command of this arm is set from the latest joint state of
+    // the leader, mapped by teleop_config. The leader should be set to low gains (e.g. kp = 0, small kd) to be moved
+    // by hand. The leader is not owned: it must outlive the coupling (the follower drops it in its destructor, the
+    // python bindings keep it alive). Pass nullptr to stop; any other command also stops mirroring. If teleop_config
+    // enables force feedback, the follower also streams its external torque to the leader.
+    void set_teleop_leader(Arx5ControllerBase *leader, TeleopConfig teleop_config);
+    TeleopConfig get_teleop_config();
+
   protected:
     RobotConfig robot_config_;
     ControllerConfig controller_config_;
@@ -44,6 +144,10 @@ class Arx5ControllerBase // parent class for the other two controllers
     JointState output_joint_cmd_{robot_config_.joint_dof};
 
     JointState joint_state_{robot_config_.joint_dof};
+    JointKalmanFilter joint_estimator_{robot_config_.joint_dof, controller_config_.estimator_pos_noise,
+                                       controller_config_.estimator_vel_noise,
+                                       controller_config_.estimator_jerk_noise};
+    JointStateEstimate joint_state_estimate_{robot_config_.joint_dof}; // Protected by state_mutex_
     Gain gain_{robot_config_.joint_dof};
     // bool prev_gripper_updated_ = false; // Declaring here leads to segfault
 
@@ -59,16 +163,134 @@ class Arx5ControllerBase // parent class for the other two controllers
     std::mutex state_mutex_;
 
     long int start_time_us_;
+    std::shared_ptr<ClockDomain> clock_domain_;
+    std::shared_ptr<EventBus> event_bus_;
+    std::shared_ptr<GripperController> gripper_controller_; // Protected by cmd_mutex_
+    // Load shedding, see controller_config.load_shedding_max_level
+    const double LOOP_STATS_EMA_ALPHA_ = 0.05;
+    LoopStats loop_stats_; // Protected by state_mutex_
+    std::atomic<LoadLevel> load_level_{LoadLevel::NORMAL};
+    int overrun_streak_ = 0; // Consecutive overrun ticks, only used by the control thread
+    int on_time_streak_ = 0;
+    int core_end_time_us_ = 0; // Set by send_recv_ before running the tasks, only used by the control thread
+    int pacing_time_us_ = 0;   // CAN pacing sleeps of the last send_recv_, only used by the control thread
+    // Set by set_log_level, restored when the load level goes back to NORMAL
+    std::atomic<spdlog::level::level_enum> log_level_{spdlog::level::info};
+    int eef_ik_tick_ = 0; // Counts the cartesian interpolation ticks to skip the differential IK at REDUCED_RATE
+    // Tasks run by the control thread after sending the commands
+    std::shared_ptr<TaskScheduler> task_scheduler_;
+    VecDoF gravity_torque_ = VecDoF::Zero(robot_config_.joint_dof);      // Last result of the gravity task
+    VecDoF gravity_torque_rate_ = VecDoF::Zero(robot_config_.joint_dof); // Nm/s, for the extrapolation
+    double gravity_time_ = 0.0;
+    double gravity_period_ = 0.0;    // s, extrapolated in between if longer than a tick
+    Diagnostics diagnostics_;        // Protected by state_mutex_
+    Diagnostics diagnostics_buffer_; // Filled by the diagnostics task, sized once so that it does not allocate
+    // Joints (bit i) whose command was clipped in the last tick, so that an event is only published when it starts
+    int prev_pos_clipped_ = 0;
+    int prev_vel_clipped_ = 0;
+    int prev_torque_clipped_ = 0;
+    double traj_end_time_ = 0.0; // End time of the joint or eef trajectory followed in the last tick
+    bool traj_running_ = false;  // Its end time has not been reached yet, TRAJ_COMPLETE is still to be published
     std::shared_ptr<Arx5Solver> solver_;
-    JointStateInterpolator interpolator_{robot_config_.joint_dof, controller_config_.interpolation_method};
+    // Quaternion forward kinematics (Arx5Solver only provides Pose6d)
+    std::shared_ptr<Arx5LinkKinematics> link_kinematics_;
+    std::mutex kinematics_mutex_;
+    // Only used by the diagnostics task, so that the control thread never waits for kinematics_mutex_
+    std::shared_ptr<Arx5LinkKinematics> diagnostics_kinematics_;
+    std::shared_ptr<Arx5CollisionChecker> collision_checker_;
+    std::shared_ptr<Arx5CollisionChecker> collision_peer_checker_;
+    Arx5ControllerBase *collision_peer_ = nullptr;
+    Pose6d collision_peer_base_pose_ = Pose6d::Zero();
+    bool prev_collision_blocked_ = false; // To suppress the warning message
+    // Contact detection, see controller_config.contact_detection
+    std::shared_ptr<Arx5MomentumObserver> momentum_observer_;        // nullptr without contact detection
+    VecDoF external_torque_ = VecDoF::Zero(robot_config_.joint_dof); // Protected by state_mutex_
+    VecDoF contact_torque_threshold_;
+    bool contact_detected_ = false; // Protected by state_mutex_
+    // Set by update_joint_state_ when a contact starts, handled by update_output_cmd_ in the same thread
+    bool contact_pending_ = false;
+    VecDoF contact_joint_pos_ = VecDoF::Zero(robot_config_.joint_dof); // Measured position at the contact
+    VecDoF contact_torque_ = VecDoF::Zero(robot_config_.joint_dof);    // External torque at the contact
+    JointStateInterpolator interpolator_{robot_config_.joint_dof, controller_config_.interpolation_method,
+                                         controller_config_.override_blend_time};
+    // Only changed with cmd_mutex_ locked, atomic so that set_joint_torque can check it without locking
+    std::atomic<CmdSource> cmd_source_{CmdSource::INTERPOLATOR};
+    // Cartesian interpolation (only set up by the cartesian controller), protected by cmd_mutex_
+    std::shared_ptr<Arx5DifferentialIk> differential_ik_;
+    EEFStateInterpolator eef_interpolator_{controller_config_.interpolation_method};
+    EEFStateSE3 eef_cmd_;                   // Speed-limited pose of the last tick
+    bool eef_twist_active_ = false;         // Integrate eef_twist_vel_ instead of following eef_interpolator_
+    Pose6d eef_twist_ = Pose6d::Zero();     // See Arx5CartesianController::set_eef_twist
+    Pose6d eef_twist_vel_ = Pose6d::Zero(); // Ramps towards eef_twist_ within the twist acceleration limits
+    double eef_twist_gripper_vel_ = 0.0;
+    double eef_twist_deadline_ = 0.0;
+    // Joint velocity mode (see Arx5JointController::set_joint_vel), also protected by cmd_mutex_
+    VecDoF joint_vel_cmd_ = VecDoF::Zero(robot_config_.joint_dof);
+    double joint_vel_gripper_cmd_ = 0.0;
+    double joint_vel_deadline_ = 0.0;
+    VecDoF joint_vel_ = VecDoF::Zero(robot_config_.joint_dof); // Acceleration-limited velocity of the last tick
+    std::deque<ActionChunk> action_chunks_; // In-flight action chunks, oldest first, also protected by cmd_mutex_
+    // Execution of the last set_joint_traj or set_eef_traj, also protected by cmd_mutex_. Overridden once the
+    // command source or the end time of its interpolator changes.
+    std::shared_ptr<TrajHandle> traj_handle_;
+    bool traj_handle_eef_ = false; // Followed by eef_interpolator_ instead of interpolator_
+    // Teleop: teleop_leader_ is atomic so that the loop can read the leader state before locking cmd_mutex_
+    std::atomic<Arx5ControllerBase *> teleop_leader_{nullptr};
+    TeleopConfig teleop_config_{robot_config_.joint_dof};
+    double teleop_leader_gripper_width_ = 0.0;
+    bool prev_teleop_leader_ok_ = true;                       // To suppress the warning message
+    double teleop_feedback_energy_ = 0.0;                     // Passivity observer of the force feedback, J
+    JointState teleop_feedback_out_{robot_config_.joint_dof}; // Force feedback sent to the leader
+    // Force feedback received from a bilateral teleop follower. Only the torque, gripper torque and timestamp (in the
+    // clock of this arm) are used, and the feedback is dropped after joint_torque_timeout.
+    Mailbox<JointState> teleop_feedback_mailbox_{JointState(robot_config_.joint_dof)};
+    std::mutex teleop_feedback_writer_mutex_;             // Serializes the followers, never locked by the loop
+    JointState teleop_feedback_{robot_config_.joint_dof}; // Latest feedback read by the loop
+    double gripper_torque_ff_ = 0.0;                      // Nm, sent with the gripper command
+    // Torque streaming (see Arx5JointController::set_joint_torque). Only the torque and timestamp are used.
+    Mailbox<JointState> joint_torque_mailbox_{JointState(robot_config_.joint_dof)};
+    std::mutex joint_torque_writer_mutex_;                 // Serializes the writers, never locked by the loop
+    JointState joint_torque_cmd_{robot_config_.joint_dof}; // Latest command read by the loop
+    bool prev_eef_tracking_ok_ = true; // To suppress the warning message
+    PoseSE3 forward_kinematics_se3_(const VecDoF &joint_pos);
+    // Convert a command timestamp from controller_config.command_clock to the controller time (0 is kept)
+    double to_controller_time_(double command_time);
+    // Velocities of a new trajectory, whose waypoint current_index is the current command (earlier ones are history)
+    void calc_traj_vel_(JointTrajectory &traj, int current_index, double avg_window_s);
     void init_robot_();
     void update_joint_state_();
     void update_output_cmd_();
+    JointState eef_interpolate_(double timestamp, const JointState &prev_output_cmd);
+    JointState joint_vel_integrate_(double timestamp, const JointState &prev_output_cmd);
+    JointState joint_torque_stream_(double timestamp, const JointState &prev_output_cmd);
+    JointState action_chunk_ensemble_(double timestamp, const JointState &prev_output_cmd);
+    JointState teleop_follow_(double timestamp, const JointState &prev_output_cmd, const JointState &leader_state,
+                              double leader_state_age);
+    void teleop_reflect_(Arx5ControllerBase *leader, const JointState &leader_state, double leader_state_age);
+    // Hand the joint command back to interpolator_ after another command source, starting from the last output
+    // command. Should be called with cmd_mutex_ locked.
+    void resume_interpolator_();
+    // Publish TRAJ_COMPLETE once when `timestamp` reaches the end time of the followed trajectory
+    void check_traj_complete_(double timestamp, double end_time);
+    // Track a trajectory that was just given to the interpolator, overriding the previous one. Should be called with
+    // cmd_mutex_ locked.
+    void start_traj_handle_(std::shared_ptr<TrajHandle> handle, bool eef);
+    void update_traj_handle_(double timestamp, const JointState &prev_output_cmd);
+    // Apply controller_config.contact_reaction. Should be called with cmd_mutex_ locked.
+    void react_to_contact_(double timestamp);
     void send_recv_();
     void recv_();
     void check_joint_state_sanity_();
     void over_current_protection_();
+    void collision_guard_(const JointState &prev_output_cmd, std::shared_ptr<Arx5CollisionChecker> peer_checker,
+                          const Pose6d &peer_base_pose, const VecDoF &peer_joint_pos);
     void background_send_recv_();
+    // Record the duration of a tick and move the load level up or down
+    // compute_time: s of work in the tick, pacing_time: s of CAN pacing sleeps
+    void update_load_level_(double compute_time, double pacing_time);
+    void set_load_level_(LoadLevel level);
+    void update_gravity_torque_(double timestamp);
+    void update_diagnostics_(double timestamp);
     void enter_emergency_state_();
 };
 } // namespace arx
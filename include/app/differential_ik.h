@@ -0,0 +1,53 @@
+#ifndef DIFFERENTIAL_IK_H
+#define DIFFERENTIAL_IK_H
+
+#include "app/common.h"
+#include <kdl/chain.hpp>
+#include <kdl/chainfksolverpos_recursive.hpp>
+#include <kdl/chainjnttojacsolver.hpp>
+#include <kdl/frames.hpp>
+#include <memory>
+#include <string>
+#include <tuple>
+
+namespace arx
+{
+
+// Inverse kinematics for targets that move by a small amount per call, e.g. a pose interpolated at every control
+// tick. Starting from the previous joint command, a few damped least squares steps are enough to converge, so a
+// solve only takes a few microseconds and the joint motion stays continuous (no restarts, no branch switching).
+// Not suited for distant targets: use Arx5NullspaceIk, Arx5IkPortfolio or multi_trial_ik instead.
+class Arx5DifferentialIk
+{
+  public:
+    Arx5DifferentialIk(std::string urdf_path, int joint_dof, Eigen::VectorXd joint_pos_min,
+                       Eigen::VectorXd joint_pos_max, std::string base_link = "base_link",
+                       std::string eef_link = "eef_link");
+    ~Arx5DifferentialIk() = default;
+
+    // Same return convention as Arx5Solver::inverse_kinematics. If the target cannot be reached within MAXITER_
+    // steps (e.g. out of the workspace), the closest joint position found is returned with E_MAX_ITERATIONS_EXCEEDED.
+    std::tuple<int, Eigen::VectorXd> inverse_kinematics(PoseSE3 target_pose, Eigen::VectorXd current_joint_pos);
+    PoseSE3 forward_kinematics(Eigen::VectorXd joint_pos);
+
+  private:
+    const double POS_TOLERANCE_ = 1E-5; // m
+    const double ORI_TOLERANCE_ = 1E-4; // rad
+    const double MAX_STEP_ = 0.1;       // rad, maximum joint update per iteration
+    const double DAMPING_ = 0.05;       // maximum damping near singularities
+    const double MANIPULABILITY_THRESHOLD_ = 1E-3;
+    const int MAXITER_ = 3;
+    const int JOINT_DOF_;
+    const Eigen::VectorXd JOINT_POS_MIN_;
+    const Eigen::VectorXd JOINT_POS_MAX_;
+
+    KDL::Chain chain_;
+    std::shared_ptr<KDL::ChainFkSolverPos_recursive> fk_solver_;
+    std::shared_ptr<KDL::ChainJntToJacSolver> jac_solver_;
+    KDL::JntArray q_kdl_;
+    KDL::Jacobian jac_;
+};
+
+} // namespace arx
+
+#endif
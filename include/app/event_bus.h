@@ -0,0 +1,128 @@
+#ifndef EVENT_BUS_H
+#define EVENT_BUS_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <semaphore.h>
+#include <spdlog/spdlog.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace arx
+{
+
+enum class EventType
+{
+    OVER_CURRENT,       // Joint or gripper torque above its limit, value: torque (Nm)
+    EMERGENCY,          // Emergency state entered, the arm is damped until the program restarts
+    GRIPPER_STALL,      // Gripper torque too large, the gripper command is held, value: torque (Nm)
+    IK_FAILURE,         // Inverse kinematics of an eef command failed, value: solver status
+    EEF_UNTRACKABLE,    // Cartesian interpolation cannot track the pose (out of the workspace)
+    JOINT_POS_CLIPPED,  // Joint pos cmd clipped to the joint limits, value: requested pos (rad)
+    JOINT_VEL_CLIPPED,  // Joint pos cmd clipped by the velocity limit, value: requested pos (rad)
+    TORQUE_CLIPPED,     // Joint torque cmd clipped, value: requested torque (Nm)
+    COLLISION_BLOCKED,  // Collision guard holds the joint command, value: distance (m)
+    CONTACT,            // Contact detected by the momentum observer, value: largest external torque (Nm)
+    TORQUE_TIMEOUT,     // Torque streaming not refreshed, set to damping, value: age of the command (s)
+    TELEOP_LEADER_LOST, // Teleop leader state too old, the follower holds, value: age of the state (s)
+    TRAJ_COMPLETE,      // The last waypoint of the joint or eef trajectory is reached, value: its timestamp
+    GRASPED,            // Grasp mode detected a contact and holds the object, value: gripper width (m)
+    GRASP_MISSED,       // Grasp mode closed without contact or lost the object, value: gripper width (m)
+    GRASP_SLIP,         // The held object slipped or yielded, value: width change since the grasp or last slip (m)
+    LOAD_LEVEL_CHANGED, // The control loop sheds more or less optional work, value: new LoadLevel
+    UNREACHABLE,        // Eef command or waypoint out of the reachability map and ignored, value: its timestamp
+};
+std::string event_type_name(EventType type);
+
+struct Event
+{
+    EventType type = EventType::EMERGENCY;
+    long int seq = 0;       // Increasing per bus in delivery order. Dropped events get none, see get_dropped_count
+    double timestamp = 0.0; // Controller time (s)
+    int joint_id = -1;      // -1 if the event is not about a joint, joint_dof for the gripper
+    double value = 0.0;     // See EventType
+};
+
+// Receives the events of a bus in a queue, for consumers that block (e.g. the Python iterator) instead of using a
+// callback. If it is not read fast enough, the oldest events are dropped.
+class EventListener
+{
+  public:
+    EventListener(int capacity);
+    ~EventListener() = default;
+
+    // Wait up to `timeout` seconds for the next event. Returns false on timeout, or once closed and empty.
+    bool next(Event &event, double timeout);
+    void close();
+    bool is_closed();
+    long int get_dropped_count();
+    void push(const Event &event); // Called by the dispatch thread of the bus
+
+  private:
+    const int CAPACITY_;
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    std::deque<Event> events_;
+    bool closed_ = false;
+    long int dropped_cnt_ = 0;
+};
+
+// Typed notifications from the control loop. publish() is wait-free for a single producer and lock-free for several
+// (bounded MPSC ring of sequenced slots), never allocates and only posts a semaphore, so the control thread can call
+// it every tick. A dispatch thread wakes up on the semaphore and hands the events to the subscribed callbacks and
+// listeners, in publishing order. If the ring is full, new events are dropped and counted.
+class EventBus
+{
+  public:
+    // Exceptions thrown by the callbacks are reported to the logger
+    EventBus(std::shared_ptr<spdlog::logger> logger, int capacity = 1024);
+    ~EventBus();
+
+    // Returns false if the event is dropped
+    bool publish(EventType type, double timestamp, int joint_id = -1, double value = 0.0);
+    // The callback runs on the dispatch thread and must not block it for long. Returns the id for unsubscribe().
+    int subscribe(std::function<void(const Event &)> callback);
+    // A callback already being called may still finish after this returns
+    void unsubscribe(int id);
+    // Closing the listener unsubscribes it
+    std::shared_ptr<EventListener> listen(int capacity = 1024);
+    long int get_dropped_count();
+
+  private:
+    struct Slot
+    {
+        std::atomic<long int> turn; // Position that may write the slot, plus one once written
+        Event event;
+    };
+    struct Subscriber
+    {
+        int id;
+        std::function<void(const Event &)> callback;
+        std::shared_ptr<EventListener> listener; // Instead of the callback
+    };
+    const long int MASK_; // Capacity (a power of two) - 1
+    std::unique_ptr<Slot[]> slots_;
+    std::atomic<long int> write_pos_{0};
+    long int read_pos_ = 0; // Only used by the dispatch thread
+    std::atomic<long int> dropped_cnt_{0};
+    sem_t event_sem_;
+    std::atomic<bool> stop_{false};
+    std::mutex subscriber_mutex_; // Never locked by the producers
+    // Copy-on-write, so that the dispatch thread only copies the pointer under subscriber_mutex_
+    std::shared_ptr<const std::vector<Subscriber>> subscribers_ = std::make_shared<const std::vector<Subscriber>>();
+    int next_subscriber_id_ = 0;
+    std::shared_ptr<spdlog::logger> logger_;
+    std::thread dispatch_thread_;
+
+    bool pop_(Event &event);
+    void dispatch_();
+};
+
+} // namespace arx
+
+#endif
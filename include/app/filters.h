@@ -0,0 +1,274 @@
+#ifndef FILTERS_H
+#define FILTERS_H
+
+#include <Eigen/Core>
+#include <Eigen/Dense>
+#include <array>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+namespace arx
+{
+
+// Streaming filters applied independently to every channel (e.g. joint) of a sample, with the channels vectorized by
+// Eigen. N is the number of channels: a fixed N keeps the whole state on the stack, Eigen::Dynamic sizes it once at
+// construction (used by the Python bindings). filter() never allocates and returns a reference to the internal
+// output, which stays valid until the next call. The first sample after reset() initializes the state, so there is
+// no start-up transient.
+
+template <int N = Eigen::Dynamic> class ExponentialFilter
+{
+  public:
+    using Vec = Eigen::Matrix<double, N, 1>;
+    // First-order low-pass: y += alpha * (x - y), alpha from the cutoff frequency (Hz) and the sample time (s)
+    ExponentialFilter(int channels, double dt, double cutoff) : channels_(channels), output_(Vec::Zero(channels))
+    {
+        if (dt <= 0 || cutoff <= 0)
+            throw std::invalid_argument("Filter dt and cutoff must be positive");
+        alpha_ = smoothing_factor(dt, cutoff);
+    }
+    static double smoothing_factor(double dt, double cutoff)
+    {
+        double tau = 1.0 / (2 * M_PI * cutoff);
+        return 1.0 / (1.0 + tau / dt);
+    }
+    void reset()
+    {
+        initialized_ = false;
+    }
+    const Vec &filter(const Vec &x)
+    {
+        if (x.size() != channels_)
+            throw std::invalid_argument("Filter expected " + std::to_string(channels_) + " channels but got " +
+                                        std::to_string(x.size()));
+        if (!initialized_)
+            output_ = x;
+        else
+            output_ += alpha_ * (x - output_);
+        initialized_ = true;
+        return output_;
+    }
+    int get_channels()
+    {
+        return channels_;
+    }
+
+  private:
+    int channels_;
+    double alpha_;
+    bool initialized_ = false;
+    Vec output_;
+};
+
+// One-euro filter (Casiez et al., CHI 2012): an exponential filter whose cutoff rises with the speed of the signal,
+// so slow motions are strongly smoothed and fast motions have little lag. Well suited for teleop inputs.
+template <int N = Eigen::Dynamic> class OneEuroFilter
+{
+  public:
+    using Vec = Eigen::Matrix<double, N, 1>;
+    using Arr = Eigen::Array<double, N, 1>;
+    // min_cutoff (Hz): cutoff at rest; beta (s/unit): cutoff increase per unit of speed; derivative_cutoff (Hz)
+    OneEuroFilter(int channels, double dt, double min_cutoff = 1.0, double beta = 0.0, double derivative_cutoff = 1.0)
+        : channels_(channels), dt_(dt), min_cutoff_(min_cutoff), beta_(beta), output_(Vec::Zero(channels)),
+          derivative_(Arr::Zero(channels)), alpha_(Arr::Zero(channels))
+    {
+        if (dt <= 0 || min_cutoff <= 0 || derivative_cutoff <= 0 || beta < 0)
+            throw std::invalid_argument("Filter dt and cutoffs must be positive, beta non-negative");
+        derivative_alpha_ = ExponentialFilter<N>::smoothing_factor(dt, derivative_cutoff);
+    }
+    void reset()
+    {
+        initialized_ = false;
+    }
+    const Vec &filter(const Vec &x)
+    {
+        if (x.size() != channels_)
+            throw std::invalid_argument("Filter expected " + std::to_string(channels_) + " channels but got " +
+                                        std::to_string(x.size()));
+        if (!initialized_)
+        {
+            output_ = x;
+            derivative_.setZero();
+            initialized_ = true;
+            return output_;
+        }
+        derivative_ += derivative_alpha_ * ((x - output_).array() / dt_ - derivative_);
+        // alpha = 1 / (1 + tau / dt) with tau = 1 / (2 pi cutoff), per channel
+        alpha_ = 1.0 / (1.0 + 1.0 / (2 * M_PI * dt_ * (min_cutoff_ + beta_ * derivative_.abs())));
+        output_.array() += alpha_ * (x - output_).array();
+        return output_;
+    }
+    int get_channels()
+    {
+        return channels_;
+    }
+
+  private:
+    int channels_;
+    double dt_;
+    double min_cutoff_;
+    double beta_;
+    double derivative_alpha_;
+    bool initialized_ = false;
+    Vec output_;
+    Arr derivative_; // Smoothed speed of the signal
+    Arr alpha_;
+};
+
+// Butterworth low-pass of even order (2 to 2 * MAX_SECTIONS), as a cascade of biquads (bilinear transform, direct
+// form II transposed). Flat pass band and steeper roll-off than the exponential filter, at the cost of more lag.
+template <int N = Eigen::Dynamic, int MAX_SECTIONS = 4> class ButterworthFilter
+{
+  public:
+    using Vec = Eigen::Matrix<double, N, 1>;
+    ButterworthFilter(int channels, double dt, double cutoff, int order = 2)
+        : channels_(channels), section_num_(order / 2), output_(Vec::Zero(channels))
+    {
+        if (dt <= 0 || cutoff <= 0 || cutoff >= 0.5 / dt)
+            throw std::invalid_argument("Filter dt must be positive and cutoff between 0 and the Nyquist frequency");
+        if (order < 2 || order % 2 != 0 || order / 2 > MAX_SECTIONS)
+            throw std::invalid_argument("Butterworth order must be even, between 2 and " +
+                                        std::to_string(2 * MAX_SECTIONS));
+        double K = std::tan(M_PI * cutoff * dt);
+        for (int k = 0; k < section_num_; k++)
+        {
+            Section &section = sections_[k];
+            double Q = 1.0 / (2 * std::cos(M_PI * (2 * k + 1) / (2 * order)));
+            double norm = 1.0 / (1 + K / Q + K * K);
+            section.b0 = K * K * norm;
+            section.b1 = 2 * section.b0;
+            section.b2 = section.b0;
+            section.a1 = 2 * (K * K - 1) * norm;
+            section.a2 = (1 - K / Q + K * K) * norm;
+            section.z1 = Vec::Zero(channels);
+            section.z2 = Vec::Zero(channels);
+            section.x = Vec::Zero(channels);
+        }
+    }
+    void reset()
+    {
+        initialized_ = false;
+    }
+    const Vec &filter(const Vec &x)
+    {
+        if (x.size() != channels_)
+            throw std::invalid_argument("Filter expected " + std::to_string(channels_) + " channels but got " +
+                                        std::to_string(x.size()));
+        output_ = x;
+        for (int k = 0; k < section_num_; k++)
+        {
+            Section &s = sections_[k];
+            if (!initialized_)
+            {
+                // Steady state for a constant input (unit DC gain)
+                s.z2 = (s.b2 - s.a2) * output_;
+                s.z1 = (s.b1 - s.a1) * output_ + s.z2;
+            }
+            // y = b0 x + z1; z1 = b1 x - a1 y + z2; z2 = b2 x - a2 y, with output_ holding x then y
+            Vec &y = output_;
+            s.x = y;
+            y = s.b0 * s.x + s.z1;
+            s.z1 = s.b1 * s.x - s.a1 * y + s.z2;
+            s.z2 = s.b2 * s.x - s.a2 * y;
+        }
+        initialized_ = true;
+        return output_;
+    }
+    int get_channels()
+    {
+        return channels_;
+    }
+
+  private:
+    struct Section
+    {
+        double b0, b1, b2, a1, a2;
+        Vec z1, z2;
+        Vec x; // Input of the section, kept to avoid temporaries
+    };
+    int channels_;
+    int section_num_;
+    bool initialized_ = false;
+    std::array<Section, MAX_SECTIONS> sections_;
+    Vec output_;
+};
+
+// Causal Savitzky-Golay filter: least squares fit of a polynomial over the last `window` samples, evaluated at the
+// newest sample. derivative = 0 smooths the signal, 1 and 2 estimate its first and second time derivatives. The
+// weights are computed once at construction, so a sample costs `window` multiply-adds per channel.
+template <int N = Eigen::Dynamic> class SavitzkyGolayFilter
+{
+  public:
+    using Vec = Eigen::Matrix<double, N, 1>;
+    SavitzkyGolayFilter(int channels, double dt, int window, int poly_order = 2, int derivative = 0)
+        : channels_(channels), window_size_(window), output_(Vec::Zero(channels))
+    {
+        if (dt <= 0 || poly_order < 0 || window <= poly_order || derivative < 0 || derivative > poly_order)
+            throw std::invalid_argument(
+                "Savitzky-Golay filter requires dt > 0 and window > poly_order >= derivative >= 0");
+        // Sample j (0 is the oldest) is at time (j - window + 1) * dt
+        Eigen::MatrixXd A(window, poly_order + 1);
+        for (int j = 0; j < window; j++)
+            for (int k = 0; k <= poly_order; k++)
+                A(j, k) = std::pow((j - window + 1) * dt, k);
+        Eigen::MatrixXd pinv = (A.transpose() * A).ldlt().solve(A.transpose());
+        double factorial = 1.0;
+        for (int k = 2; k <= derivative; k++)
+            factorial *= k;
+        weights_ = factorial * pinv.row(derivative).transpose();
+        window_ = Eigen::Matrix<double, N, Eigen::Dynamic>::Zero(channels, window);
+    }
+    void reset()
+    {
+        initialized_ = false;
+    }
+    const Vec &filter(const Vec &x)
+    {
+        if (x.size() != channels_)
+            throw std::invalid_argument("Filter expected " + std::to_string(channels_) + " channels but got " +
+                                        std::to_string(x.size()));
+        if (!initialized_)
+        {
+            window_.colwise() = x;
+            newest_ = window_size_ - 1;
+            initialized_ = true;
+        }
+        newest_ = (newest_ + 1) % window_size_;
+        window_.col(newest_) = x;
+        output_.setZero();
+        for (int j = 0; j < window_size_; j++)
+            output_ += weights_[j] * window_.col((newest_ + 1 + j) % window_size_);
+        return output_;
+    }
+    int get_channels()
+    {
+        return channels_;
+    }
+
+  private:
+    int channels_;
+    int window_size_;
+    int newest_ = 0;
+    bool initialized_ = false;
+    Eigen::VectorXd weights_;                         // From the oldest to the newest sample
+    Eigen::Matrix<double, N, Eigen::Dynamic> window_; // Ring buffer, one column per sample
+    Vec output_;
+};
+
+// Run a filter over a whole signal, one sample per row (e.g. a (time, joint) numpy array)
+template <typename Filter> Eigen::MatrixXd filter_samples(Filter &filter, const Eigen::MatrixXd &samples)
+{
+    Eigen::MatrixXd filtered(samples.rows(), samples.cols());
+    typename Filter::Vec sample;
+    for (int i = 0; i < samples.rows(); i++)
+    {
+        sample = samples.row(i).transpose();
+        filtered.row(i) = filter.filter(sample).transpose();
+    }
+    return filtered;
+}
+
+} // namespace arx
+
+#endif
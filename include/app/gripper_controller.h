@@ -0,0 +1,55 @@
+#ifndef GRIPPER_CONTROLLER_H
+#define GRIPPER_CONTROLLER_H
+
+#include "app/config.h"
+#include "app/event_bus.h"
+#include <memory>
+
+namespace arx
+{
+
+enum class GraspState
+{
+    IDLE,    // The gripper follows the joint or eef commands
+    CLOSING, // Closing with a limited torque until a contact is detected
+    HOLDING, // Object grasped, squeezed with the grasp torque
+    MISSED,  // Closed without a contact, or the object was lost; held closed with the grasp torque
+};
+
+// Torque-limited grasping, run by the control thread every tick in place of the gripper position command. The
+// gripper motor is position controlled (torque = kp * position error + kd * velocity error), so its torque is limited
+// by keeping the position command within torque / kp of the measured position: the gripper closes at the given
+// speed, stops pushing harder than the grasp torque on contact, and then squeezes the object with exactly that
+// torque whatever its width. Publishes GRASPED, GRASP_MISSED and GRASP_SLIP on the event bus.
+class GripperController
+{
+  public:
+    GripperController(RobotConfig robot_config, ControllerConfig controller_config,
+                      std::shared_ptr<EventBus> event_bus);
+    ~GripperController() = default;
+
+    // torque: Nm of the gripper motor, speed: m/s
+    void grasp(double torque, double speed, double start_pos);
+    void release();
+    bool is_active(); // Not IDLE
+    // Returns the gripper position command (m)
+    double update(double timestamp, double gripper_pos, double gripper_vel, double gripper_torque, double gripper_kp);
+    GraspState get_state();
+    double get_grasp_width(); // m, measured when the grasp was detected (0 if not holding)
+
+  private:
+    RobotConfig robot_config_;
+    ControllerConfig controller_config_;
+    std::shared_ptr<EventBus> event_bus_;
+    GraspState state_ = GraspState::IDLE;
+    double torque_ = 0.0;
+    double speed_ = 0.0;
+    double target_pos_ = 0.0;       // Closing ramp
+    double contact_duration_ = 0.0; // s, since the contact condition holds
+    double grasp_width_ = 0.0;
+    double slip_ref_width_ = 0.0; // Width of the last grasp or slip, the next slip is measured from it
+};
+
+} // namespace arx
+
+#endif
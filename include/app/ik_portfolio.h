@@ -0,0 +1,135 @@
+#ifndef IK_PORTFOLIO_H
+#define IK_PORTFOLIO_H
+
+#include "app/common.h"
+#include <atomic>
+#include <condition_variable>
+#include <kdl/chain.hpp>
+#include <kdl/chainfksolverpos_recursive.hpp>
+#include <kdl/chainjnttojacsolver.hpp>
+#include <kdl/frames.hpp>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+namespace arx
+{
+
+struct IkSolverStats
+{
+    std::string name;
+    int attempts = 0;            // Number of portfolio solves this solver took part in
+    int successes = 0;           // Number of solves where it found a valid solution before being cancelled
+    int wins = 0;                // Number of solves where its solution was returned
+    double avg_latency_ms = 0.0; // Average time to find a valid solution (only counting successes)
+    double max_latency_ms = 0.0;
+};
+
+// Joint-limit-aware SQP inverse kinematics.
+// Each iteration solves a damped least squares QP of the pose error with the joint limits as box constraints,
+// so the iterates never leave the joint limits (unlike KDL LMA, which clips the result afterwards).
+class SqpIkSolver
+{
+  public:
+    SqpIkSolver(const KDL::Chain &chain, Eigen::VectorXd joint_pos_min, Eigen::VectorXd joint_pos_max,
+                double eps = 1E-4, int max_iter = 100);
+
+    // Return value follows `<kdl/solveri.hpp>` (0 means no error).
+    // The solver stops early with E_NO_CONVERGE when `cancel` is set by another thread.
+    int solve(const KDL::Frame &target, const Eigen::VectorXd &init_joint_pos, Eigen::VectorXd &joint_pos,
+              const std::atomic<bool> *cancel = nullptr);
+
+  private:
+    const double EPS_;
+    const int MAXITER_;
+    const double EPS_JOINTS_ = 1E-10;
+    const int JOINT_DOF_;
+    const Eigen::VectorXd JOINT_POS_MIN_;
+    const Eigen::VectorXd JOINT_POS_MAX_;
+    // Same weighting as KDL LMA: position in m, orientation in rad
+    const Eigen::Matrix<double, 6, 1> ERROR_WEIGHT_ = (Eigen::Matrix<double, 6, 1>() << 1, 1, 1, 0.01, 0.01, 0.01)
+                                                          .finished();
+
+    KDL::ChainFkSolverPos_recursive fk_solver_;
+    KDL::ChainJntToJacSolver jac_solver_;
+    KDL::JntArray q_kdl_;
+    KDL::Jacobian jac_;
+
+    Eigen::Matrix<double, 6, 1> weighted_error_(const KDL::Frame &target, const Eigen::VectorXd &joint_pos);
+    Eigen::VectorXd solve_box_qp_(const Eigen::MatrixXd &H, const Eigen::VectorXd &g, const Eigen::VectorXd &lower,
+                                  const Eigen::VectorXd &upper);
+};
+
+// Run several heterogeneous IK solvers in parallel on a worker pool (TRAC-IK style).
+// Every worker first starts its solver from the current joint positions, then keeps restarting it from random seeds
+// until it finds a converged solution within the joint limits or the timeout is reached. A solution of a seeded trial
+// wins right away and cancels the others. The random restarts may land on another IK branch, so their solutions only
+// win once every seeded trial has failed, and then the one nearest to the current joint positions is returned.
+// Available solvers: "lma" (KDL LMA), "nr_jl" (KDL Newton-Raphson with joint limits), "sqp" (SqpIkSolver)
+class Arx5IkPortfolio
+{
+  public:
+    Arx5IkPortfolio(std::string urdf_path, int joint_dof, Eigen::VectorXd joint_pos_min, Eigen::VectorXd joint_pos_max,
+                    std::string base_link = "base_link", std::string eef_link = "eef_link",
+                    std::vector<std::string> solver_names = {"lma", "nr_jl", "sqp"});
+    ~Arx5IkPortfolio();
+
+    // Same return convention as Arx5Solver::inverse_kinematics. The first trial of every solver is seeded
+    // with current_joint_pos. If no solver succeeds before the timeout, current_joint_pos (clipped to the
+    // joint limits) is returned together with E_NO_CONVERGE.
+    std::tuple<int, Eigen::VectorXd> inverse_kinematics(Pose6d target_pose_6d, Eigen::VectorXd current_joint_pos,
+                                                        double timeout_s = 0.005);
+    std::tuple<int, Eigen::VectorXd> inverse_kinematics(PoseSE3 target_pose, Eigen::VectorXd current_joint_pos,
+                                                        double timeout_s = 0.005);
+
+    std::vector<IkSolverStats> get_stats();
+    void reset_stats();
+    std::vector<std::string> get_solver_names();
+
+  private:
+    const int JOINT_DOF_;
+    const Eigen::VectorXd JOINT_POS_MIN_;
+    const Eigen::VectorXd JOINT_POS_MAX_;
+    // A solution is accepted only if its pose error is below these tolerances (m, rad)
+    const double POS_TOLERANCE_ = 1E-4;
+    const double ORI_TOLERANCE_ = 1E-2;
+
+    KDL::Chain chain_;
+    std::vector<std::string> solver_names_;
+    std::vector<std::thread> workers_;
+
+    std::mutex solve_mutex_; // Only one portfolio solve at a time
+    std::mutex job_mutex_;
+    std::condition_variable job_cv_;
+    std::condition_variable done_cv_;
+    long int job_id_ = 0;
+    bool shutdown_ = false;
+    int pending_workers_ = 0;
+    std::atomic<bool> solved_{false};
+
+    KDL::Frame target_frame_;
+    Eigen::VectorXd seed_joint_pos_;
+    long int deadline_us_ = 0;
+    Eigen::VectorXd result_joint_pos_;
+    int winner_ = -1;
+    bool winner_seeded_ = false;     // Found by the first trial of its worker, seeded with the current joint positions
+    double winner_distance_ = 0;     // Joint space distance of result_joint_pos_ to the current joint positions
+    int seeded_pending_workers_ = 0; // Workers whose seeded trial is still running
+
+    std::vector<IkSolverStats> stats_;
+    std::vector<double> latency_sum_ms_;
+
+    std::tuple<int, Eigen::VectorXd> solve_(const KDL::Frame &target_frame, const Eigen::VectorXd &current_joint_pos,
+                                            double timeout_s);
+    void worker_(int worker_id);
+    bool in_joint_limit_(const Eigen::VectorXd &joint_pos);
+    bool accept_(KDL::ChainFkSolverPos_recursive &fk_solver, const KDL::Frame &target,
+                 const Eigen::VectorXd &joint_pos);
+};
+
+} // namespace arx
+
+#endif
@@ -26,7 +26,32 @@ class Arx5JointController : public Arx5ControllerBase
 
     void set_joint_cmd(JointState new_cmd);
 
-    void set_joint_traj(std::vector<JointState> new_traj);
+    // The returned handle reports the progress and resolves when the trajectory ends or is overridden
+    std::shared_ptr<TrajHandle> set_joint_traj(std::vector<JointState> new_traj);
+    std::shared_ptr<TrajHandle> set_joint_traj(const JointTrajectory &new_traj);
+
+    // Joint velocity streaming (rad/s, gripper in m/s). The control thread integrates the velocity into the position
+    // command and sends it as velocity feedforward, within joint_vel_max and controller_config.joint_acc_max.
+    // If the command is not refreshed within `timeout` seconds, the joints decelerate to zero and hold. A collision
+    // guard block (controller_config.collision_check) drops the velocity command, so it has to be sent again.
+    // set_joint_cmd or set_joint_traj leaves the velocity mode.
+    void set_joint_vel(VecDoF joint_vel, double timeout = 0.1, double gripper_vel = 0.0);
+
+    // Torque streaming (N*m), sent at the next control tick without going through the interpolator. Torque clipping
+    // and the optional gravity compensation (controller_config.gravity_compensation) are still applied. The gains
+    // are not changed, so set kp (and kd) to zero first for pure torque control. If no command arrives within
+    // controller_config.joint_torque_timeout, the arm is set to damping and the torque mode is left.
+    // set_joint_cmd, set_joint_traj or set_joint_vel also leave the torque mode.
+    void set_joint_torque(VecDoF joint_torque);
+
+    // Action chunk of a policy (e.g. ACT or Diffusion Policy): joint positions (and gripper_pos) spaced by action_dt,
+    // the first one at observation_timestamp, when the policy input was captured, in controller_config.command_clock
+    // (the controller time of get_timestamp by default).
+    // The timestamps and velocities of the actions are ignored. Chunks stay in flight until their last action and are
+    // blended at every tick according to controller_config.chunk_ensemble_decay. Since the actions are aligned with
+    // the observation, the ones that became outdated during inference are skipped. Any other joint command discards
+    // the chunks.
+    void submit_action_chunk(std::vector<JointState> chunk, double observation_timestamp, double action_dt);
 
     // Only works when background_send_recv is disabled
     void send_recv_once();
@@ -0,0 +1,25 @@
+#ifndef KDL_UTILS_H
+#define KDL_UTILS_H
+
+#include "app/common.h"
+#include <kdl/chain.hpp>
+#include <kdl/frames.hpp>
+#include <kdl/tree.hpp>
+#include <kdl_parser/kdl_parser.hpp>
+#include <string>
+
+namespace arx
+{
+// Parse the URDF file and extract the chain from base_link to eef_link.
+// Fixed joints are kept so that the tip frame is exactly the eef link (same as Arx5Solver).
+KDL::Chain load_kdl_chain(std::string urdf_path, std::string base_link, std::string eef_link);
+
+// Pose6d: x, y, z, roll, pitch, yaw (same convention as Arx5Solver::forward_kinematics)
+KDL::Frame pose6d2frame(const Pose6d &pose_6d);
+Pose6d frame2pose6d(const KDL::Frame &frame);
+KDL::Frame se32frame(const PoseSE3 &pose);
+PoseSE3 frame2se3(const KDL::Frame &frame);
+
+} // namespace arx
+
+#endif
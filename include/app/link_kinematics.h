@@ -0,0 +1,57 @@
+#ifndef LINK_KINEMATICS_H
+#define LINK_KINEMATICS_H
+
+#include "app/common.h"
+#include <kdl/chain.hpp>
+#include <kdl/frames.hpp>
+#include <string>
+#include <vector>
+
+namespace arx
+{
+
+// Forward kinematics of every link of the chain in a single pass.
+// Arx5Solver::forward_kinematics only returns the eef pose, so anything that needs the intermediate links (collision
+// checking, visualization) would otherwise run the full chain once per link.
+// Links are the chain segments from base_link (excluded, its frame is the identity) to eef_link (the last one).
+class Arx5LinkKinematics
+{
+  public:
+    Arx5LinkKinematics(std::string urdf_path, int joint_dof, std::string base_link = "base_link",
+                       std::string eef_link = "eef_link");
+    ~Arx5LinkKinematics() = default;
+
+    // Frames of all links in the base frame, written into a preallocated array. The result is cached, so calling it
+    // again with the same joint position (e.g. from several users within one control tick) costs nothing.
+    // The reference stays valid until the next call with a different joint position.
+    const std::vector<KDL::Frame> &link_frames(const VecDoF &joint_pos);
+
+    // Pose of the last link (eef_link)
+    PoseSE3 forward_kinematics(VecDoF joint_pos);
+
+    // Homogeneous transforms of all links: link_num rows of row-major 4x4 matrices
+    Eigen::Matrix<double, Eigen::Dynamic, 16, Eigen::RowMajor> link_transforms(VecDoF joint_pos);
+    // joint_pos: N x joint_dof. Returns N * link_num rows of row-major 4x4 matrices (sample-major)
+    Eigen::Matrix<double, Eigen::Dynamic, 16, Eigen::RowMajor> batch_link_transforms(Eigen::MatrixXd joint_pos);
+
+    std::vector<std::string> get_link_names();
+    int get_link_num();
+    int get_joint_dof();
+
+  private:
+    const int JOINT_DOF_;
+    KDL::Chain chain_;
+    std::vector<std::string> link_names_;
+    std::vector<int> joint_ids_;             // joint index of each segment, -1 for fixed joints
+    std::vector<KDL::Frame> fixed_poses_;    // segment pose of fixed joints, computed once
+    std::vector<KDL::Frame> frames_;
+    VecDoF cached_joint_pos_;
+    bool cache_valid_ = false;
+
+    void check_joint_pos_(const VecDoF &joint_pos);
+    static void write_transform_(const KDL::Frame &frame, double *row);
+};
+
+} // namespace arx
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef MOMENTUM_OBSERVER_H
+#define MOMENTUM_OBSERVER_H
+
+#include "app/common.h"
+#include <kdl/chain.hpp>
+#include <kdl/chaindynparam.hpp>
+#include <kdl/jntarray.hpp>
+#include <kdl/jntspaceinertiamatrix.hpp>
+#include <memory>
+#include <string>
+
+namespace arx
+{
+
+// Generalized momentum observer (De Luca and Mattone, 2003): estimates the external joint torques from the measured
+// motor torques and the rigid body model, without differentiating the joint velocities. With p = M(q) qd,
+//   r = gain * (p - p(0) - integral(tau_motor - C(q, qd) qd - g(q) + dM/dt qd + r) dt)
+// follows the external torque as a first-order low-pass with time constant 1 / gain. dM/dt qd is integrated exactly
+// as the change of M between two updates applied to qd. The residual also contains the unmodeled torques (friction,
+// model errors), so detection thresholds must stay above them.
+class Arx5MomentumObserver
+{
+  public:
+    Arx5MomentumObserver(std::string urdf_path, int joint_dof, std::string base_link, std::string eef_link,
+                         Eigen::Vector3d gravity_vector, double gain);
+    ~Arx5MomentumObserver() = default;
+
+    // The first update after reset() only initializes the momentum
+    void reset();
+    // Returns the external torque estimate, valid until the next update
+    const VecDoF &update(double timestamp, const VecDoF &joint_pos, const VecDoF &joint_vel,
+                         const VecDoF &joint_torque);
+    const VecDoF &get_external_torque();
+
+  private:
+    const int JOINT_DOF_;
+    const double GAIN_;
+    const double MAX_DT_ = 0.1; // s, longer gaps (e.g. a paused loop) restart the observer
+    KDL::Chain chain_;
+    std::shared_ptr<KDL::ChainDynParam> dyn_param_;
+    bool initialized_ = false;
+    double timestamp_ = 0.0;
+    KDL::JntArray joint_pos_;
+    KDL::JntArray joint_vel_;
+    KDL::JntArray coriolis_; // C(q, qd) qd
+    KDL::JntArray gravity_;
+    KDL::JntSpaceInertiaMatrix mass_;
+    KDL::JntSpaceInertiaMatrix prev_mass_;
+    VecDoF momentum_; // M(q) qd
+    VecDoF initial_momentum_;
+    VecDoF integral_;
+    VecDoF mass_change_; // (M_k - M_{k-1}) qd_k
+    VecDoF residual_;    // External torque estimate
+};
+
+} // namespace arx
+
+#endif
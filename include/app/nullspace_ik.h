@@ -0,0 +1,82 @@
+#ifndef NULLSPACE_IK_H
+#define NULLSPACE_IK_H
+
+#include "app/common.h"
+#include <kdl/chain.hpp>
+#include <kdl/chainfksolverpos_recursive.hpp>
+#include <kdl/chainjnttojacsolver.hpp>
+#include <kdl/frames.hpp>
+#include <memory>
+#include <string>
+#include <tuple>
+
+namespace arx
+{
+
+// Weights of the secondary objectives that are optimized in the nullspace of the pose task
+struct NullspaceIkWeights
+{
+    double joint_limit = 0.1;    // keep joints away from their limits
+    double manipulability = 0.0; // keep away from singularities (needs one extra jacobian per joint per iteration)
+    double previous = 1.0;       // stay close to the reference (previous) joint position, avoids elbow flips
+    NullspaceIkWeights()
+    {
+    }
+    NullspaceIkWeights(double joint_limit, double manipulability, double previous)
+        : joint_limit(joint_limit), manipulability(manipulability), previous(previous)
+    {
+    }
+};
+
+// Redundancy-aware inverse kinematics (mainly for the 7-DoF X7 arms).
+// The pose error is solved by damped least squares, and the gradient of the secondary objectives is projected into
+// the nullspace of the jacobian, so the extra DoF is resolved within a single solve instead of random restarts.
+// For 6-DoF arms the nullspace is empty and it reduces to a joint-limit-clipped damped least squares solver.
+class Arx5NullspaceIk
+{
+  public:
+    Arx5NullspaceIk(std::string urdf_path, int joint_dof, Eigen::VectorXd joint_pos_min, Eigen::VectorXd joint_pos_max,
+                    std::string base_link = "base_link", std::string eef_link = "eef_link");
+    ~Arx5NullspaceIk() = default;
+
+    // Same return convention as Arx5Solver::inverse_kinematics.
+    // current_joint_pos is both the initial guess and the reference of the `previous` objective.
+    std::tuple<int, Eigen::VectorXd> inverse_kinematics(Pose6d target_pose_6d, Eigen::VectorXd current_joint_pos);
+    std::tuple<int, Eigen::VectorXd> inverse_kinematics(PoseSE3 target_pose, Eigen::VectorXd current_joint_pos);
+
+    // Yoshikawa manipulability sqrt(det(J J^T))
+    double manipulability(Eigen::VectorXd joint_pos);
+
+    void set_weights(NullspaceIkWeights weights);
+    NullspaceIkWeights get_weights();
+
+  private:
+    const double POS_TOLERANCE_ = 1E-4; // m
+    const double ORI_TOLERANCE_ = 1E-3; // rad
+    const double NULLSPACE_TOLERANCE_ = 1E-5;
+    const double NULLSPACE_GAIN_ = 0.5;
+    const double MAX_STEP_ = 0.5; // rad, maximum joint update per iteration
+    const double DAMPING_ = 0.05; // maximum damping near singularities
+    const double MANIPULABILITY_THRESHOLD_ = 1E-3;
+    const int MAXITER_ = 100;
+    const int JOINT_DOF_;
+    const Eigen::VectorXd JOINT_POS_MIN_;
+    const Eigen::VectorXd JOINT_POS_MAX_;
+
+    NullspaceIkWeights weights_;
+
+    KDL::Chain chain_;
+    std::shared_ptr<KDL::ChainFkSolverPos_recursive> fk_solver_;
+    std::shared_ptr<KDL::ChainJntToJacSolver> jac_solver_;
+    KDL::JntArray q_kdl_;
+    KDL::Jacobian jac_;
+
+    std::tuple<int, Eigen::VectorXd> solve_(const KDL::Frame &target, const Eigen::VectorXd &current_joint_pos);
+    Eigen::Matrix<double, 6, Eigen::Dynamic> jacobian_(const Eigen::VectorXd &joint_pos);
+    Eigen::VectorXd objective_gradient_(const Eigen::VectorXd &joint_pos, const Eigen::VectorXd &reference_joint_pos,
+                                        double current_manipulability);
+};
+
+} // namespace arx
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef REACHABILITY_MAP_H
+#define REACHABILITY_MAP_H
+
+#include "app/common.h"
+#include <cstdint>
+#include <string>
+
+namespace arx
+{
+
+// On-disk layout (native endianness), the file is memory-mapped as is:
+//   ReachabilityMapHeader
+//   int32_t  index[cell_num]            seed row of each (voxel, orientation bin), -1 for unreachable
+//   float    seeds[seed_num][joint_dof] joint positions that reach the cell
+// Cells are ordered as ((x * dims[1] + y) * dims[2] + z) * ori_bin_num + ori_bin
+struct ReachabilityMapHeader
+{
+    char magic[8]; // "ARXRMAP"
+    uint32_t version;
+    uint32_t joint_dof;
+    uint32_t dims[3];
+    uint32_t ori_resolution; // Orientation bins per cube-map face edge (6 * ori_resolution^2 bins in total)
+    double voxel_size;       // m
+    double origin[3];        // m, lower corner of the voxel grid in the base frame
+    uint64_t cell_num;
+    uint64_t seed_num;
+};
+
+// Voxelized reachability map of the eef, generated offline by sampling forward kinematics.
+// The orientation of a pose is binned by the direction of the eef x axis (cube map). Rotation around the x axis
+// is not binned, so a reachable cell only means the pose is likely reachable; IK is still needed for the exact
+// solution, and the stored seed is a good initial guess for it.
+class ReachabilityMap
+{
+  public:
+    // Memory-map a map generated by `generate()` (or the `reachability_maps` build target). Throws
+    // std::runtime_error if the file is missing, truncated or its index points out of the seeds.
+    ReachabilityMap(std::string map_path);
+    ~ReachabilityMap();
+    ReachabilityMap(const ReachabilityMap &) = delete;
+    ReachabilityMap &operator=(const ReachabilityMap &) = delete;
+
+    // O(1) lookups. Poses outside of the voxel grid are unreachable.
+    bool is_reachable(Pose6d pose_6d);
+    bool is_reachable(PoseSE3 pose);
+    // Returns false and leaves `seed` untouched if the pose is unreachable
+    bool get_seed(Pose6d pose_6d, Eigen::VectorXd &seed);
+    bool get_seed(PoseSE3 pose, Eigen::VectorXd &seed);
+    int get_joint_dof();
+    std::string get_path();
+
+    // Sample `sample_num` joint positions within the joint limits and write the map to output_path.
+    // Empty neighbours of reachable voxels are also marked as reachable to compensate for the sampling sparsity.
+    static void generate(std::string urdf_path, int joint_dof, Eigen::VectorXd joint_pos_min,
+                         Eigen::VectorXd joint_pos_max, std::string base_link, std::string eef_link,
+                         std::string output_path, double voxel_size = 0.03, int ori_resolution = 2,
+                         long int sample_num = 2000000);
+
+  private:
+    std::string map_path_;
+    void *data_ = nullptr;
+    size_t data_size_ = 0;
+    const ReachabilityMapHeader *header_ = nullptr;
+    const int32_t *index_ = nullptr;
+    const float *seeds_ = nullptr;
+
+    long int cell_index_(const Eigen::Vector3d &pos, const Eigen::Vector3d &x_axis);
+    bool get_seed_(long int cell, Eigen::VectorXd &seed);
+};
+
+} // namespace arx
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef TASK_SCHEDULER_H
+#define TASK_SCHEDULER_H
+
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace arx
+{
+
+// Duration of a task (or of the hard real-time core of the control loop) per run
+struct TaskStats
+{
+    std::string name;
+    double period = 0.0; // s, a whole number of ticks
+    int priority = 0;
+    long int count = 0;
+    long int deferred_count = 0; // Ticks where the task was due but postponed for lack of time
+    double last = 0.0;           // s
+    double mean = 0.0;           // s, exponential moving average
+    double max = 0.0;            // s
+};
+
+// Runs the periodic work of the control loop that does not have to happen before the commands are sent, each task at
+// its own period (a multiple of the tick). Called at the end of every tick: the tasks that are due run in ascending
+// priority value. Priority 0 tasks always run; the others only start if their mean duration still fits into the
+// budget of the tick, and are otherwise postponed to the next tick. Tasks with the same period are spread over
+// different ticks.
+class TaskScheduler
+{
+  public:
+    // tick_dt: s, budget: s of the tick (hard real-time core and its CAN pacing included) up to which the tasks above
+    // priority 0 may start
+    TaskScheduler(double tick_dt, double budget);
+    ~TaskScheduler() = default;
+
+    // period: s, rounded to a whole number of ticks (at least one). Not thread safe, add the tasks before the first
+    // run(). The task receives the controller time of the tick.
+    void add_task(std::string name, double period, int priority, std::function<void(double)> task);
+    // core_time: s of computation in the hard real-time part of the tick, before the tasks (as in LoopStats).
+    // pacing_time: s the core slept between the CAN frames; not part of its stats, but it still takes up the budget.
+    void run(double timestamp, double core_time, double pacing_time = 0.0);
+    // The hard real-time core first, then the tasks in priority order
+    std::vector<TaskStats> get_stats();
+    void reset_stats();
+
+  private:
+    struct Task
+    {
+        TaskStats stats;
+        int period_ticks;
+        long int next_tick;
+        std::function<void(double)> task;
+    };
+    const double TICK_DT_;
+    const double BUDGET_;
+    const double STATS_EMA_ALPHA_ = 0.05;
+    std::vector<Task> tasks_; // Sorted by priority
+    TaskStats core_stats_;
+    long int tick_ = 0; // Only used by run()
+    std::mutex stats_mutex_;
+
+    void record_(TaskStats &stats, double duration);
+};
+
+} // namespace arx
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef TRAJ_DERIVATIVE_H
+#define TRAJ_DERIVATIVE_H
+
+#include "app/common.h"
+#include <Eigen/Core>
+#include <string>
+#include <vector>
+
+namespace arx
+{
+
+// Waypoint velocities and accelerations of a joint trajectory, stored as structure of arrays (one column per
+// waypoint) and updated incrementally when waypoints are appended. Storage grows geometrically, so appending does
+// not allocate per waypoint, and the derivatives are only brought up to date when they are read.
+//   "window": average of the finite differences over +-avg_window_s and +-avg_window_s / 2 around each waypoint (as
+//             calc_joint_vel, which does not require strictly ascending timestamps). Appending only recomputes the
+//             waypoints within avg_window_s of the end.
+//   "spline": velocities of the C2 cubic spline through the waypoints, clamped to start_vel and end_vel, so that the
+//             cubic segments of JointStateInterpolator join with continuous acceleration and stop exactly at the
+//             requested end velocity. Appending extends the forward sweep of the tridiagonal solve, only the back
+//             substitution runs over the whole trajectory.
+// The accelerations are those of the cubic Hermite segment starting at each waypoint (the last one: of the segment
+// ending there). With "spline" they are continuous and can seed quintic segments.
+class TrajDerivative
+{
+  public:
+    TrajDerivative(int dof, std::string method, double avg_window_s = 0.05);
+    ~TrajDerivative() = default;
+
+    void reserve(int waypoint_num);
+    // Remove all waypoints, the boundary velocities are kept
+    void clear();
+    // Only used by "spline", zero by default
+    void set_boundary_vel(const VecDoF &start_vel, const VecDoF &end_vel);
+    // Timestamps must be strictly ascending
+    void append(double timestamp, Eigen::Ref<const Eigen::VectorXd> pos);
+    // Batch evaluation: replace the waypoints by `timestamps` and the columns of `pos` (dof x waypoint number)
+    void assign(const Eigen::VectorXd &timestamps, Eigen::Ref<const Eigen::MatrixXd> pos);
+    void assign(const std::vector<JointState> &traj);
+    void assign(const JointTrajectory &traj);
+    // Write the velocities into the waypoints given to assign()
+    void get_traj_vel(std::vector<JointState> &traj);
+    void get_traj_vel(JointTrajectory &traj);
+
+    int size();
+    Eigen::Ref<const Eigen::VectorXd> get_timestamps();
+    Eigen::Ref<const Eigen::MatrixXd> get_pos();
+    Eigen::Ref<const Eigen::MatrixXd> get_vel();
+    Eigen::Ref<const Eigen::MatrixXd> get_acc();
+
+    static void check_method(std::string method);
+
+  private:
+    int dof_;
+    std::string method_;
+    double avg_window_s_;
+    int size_ = 0;
+    VecDoF start_vel_;
+    VecDoF end_vel_;
+    Eigen::VectorXd timestamps_;
+    Eigen::MatrixXd pos_;
+    Eigen::MatrixXd vel_;
+    Eigen::MatrixXd acc_;
+    int vel_valid_ = 0; // Waypoints before this index have up-to-date velocities ("window")
+    bool acc_valid_ = false;
+    // Forward sweep of the tridiagonal solve ("spline"): vel_i = sweep_d_i - sweep_c_i * vel_{i+1}
+    int sweep_valid_ = 0;
+    bool spline_valid_ = false;
+    Eigen::VectorXd sweep_c_;
+    Eigen::MatrixXd sweep_d_;
+
+    void update_();
+    void update_window_();
+    void update_spline_();
+    void update_acc_();
+    int lower_bound_(double timestamp);
+};
+
+} // namespace arx
+
+#endif
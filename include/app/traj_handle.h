@@ -0,0 +1,62 @@
+#ifndef TRAJ_HANDLE_H
+#define TRAJ_HANDLE_H
+
+#include <future>
+#include <mutex>
+#include <vector>
+
+namespace arx
+{
+
+enum class TrajStatus
+{
+    RUNNING,
+    COMPLETED,  // The last waypoint is reached
+    OVERRIDDEN, // Replaced by another command (or a safety reaction) before the end
+};
+
+struct TrajProgress
+{
+    TrajStatus status = TrajStatus::RUNNING;
+    int next_waypoint = 0; // Index of the next waypoint to reach, waypoint_num once reached
+    int waypoint_num = 0;
+    double time_remaining = 0.0;     // s, until the last waypoint
+    double tracking_error_max = 0.0; // rad, norm of the measured minus the commanded joint pos
+    double tracking_error_rms = 0.0; // rad
+};
+
+// Execution of a trajectory given to set_joint_traj or set_eef_traj. The control thread updates the progress every
+// tick and resolves the future when the trajectory ends, so callers can wait for it or chain the next motion right
+// away. Only the waypoints that were still in the future when the trajectory was set are counted.
+class TrajHandle
+{
+  public:
+    // Controller times of the waypoints, in ascending order
+    TrajHandle(std::vector<double> waypoint_times);
+    ~TrajHandle() = default;
+
+    TrajStatus get_status();
+    TrajProgress get_progress();
+    bool is_done();
+    // Block until the trajectory is done or `timeout` seconds passed (forever if negative). Returns is_done().
+    bool wait(double timeout = -1.0);
+    std::shared_future<TrajStatus> get_future();
+    double get_end_time();
+
+    // Called by the control thread
+    void update(double timestamp, double tracking_error);
+    void finish(TrajStatus status);
+
+  private:
+    const std::vector<double> waypoint_times_;
+    std::mutex mutex_;
+    TrajProgress progress_;
+    double tracking_error_sq_sum_ = 0.0;
+    long int tick_cnt_ = 0;
+    std::promise<TrajStatus> promise_;
+    std::shared_future<TrajStatus> future_;
+};
+
+} // namespace arx
+
+#endif
@@ -2,6 +2,7 @@
 #define UTILS_H
 #include "app/common.h"
 #include <Eigen/Core>
+#include <atomic>
 #include <string>
 #include <vector>
 namespace arx
@@ -24,29 +25,133 @@ class MovingAverageXd
     Eigen::MatrixXd window_;
 };
 
+// Per-joint Kalman filter on a constant acceleration model driven by white jerk noise. Fuses the position and
+// velocity readings into filtered position, velocity and acceleration. All matrices are fixed-size 3x3, so an
+// update costs well below a microsecond per joint and does not allocate.
+class JointKalmanFilter
+{
+  public:
+    // pos_noise (rad) and vel_noise (rad/s): standard deviations of the readings
+    // jerk_noise ((rad/s^3)^2/Hz): spectral density of the jerk, higher values track faster but filter less
+    JointKalmanFilter(int dof, double pos_noise, double vel_noise, double jerk_noise);
+    ~JointKalmanFilter() = default;
+
+    void reset();
+    // The first update after reset() initializes the state from the readings
+    void update(double timestamp, const Eigen::VectorXd &pos, const Eigen::VectorXd &vel);
+    void get_estimate(JointStateEstimate &estimate);
+    JointStateEstimate get_estimate();
+
+  private:
+    int dof_;
+    double pos_var_;
+    double vel_var_;
+    double jerk_noise_;
+    bool initialized_ = false;
+    double timestamp_ = 0.0;
+    std::vector<Eigen::Vector3d> x_; // (pos, vel, acc) of each joint
+    std::vector<Eigen::Matrix3d> P_;
+};
+
+// With a positive blend_time, append_* and override_* do not restart from the current position only: the difference
+// between the previous and the new trajectory in velocity and acceleration is faded out by a quintic polynomial over
+// blend_time, so the interpolated position stays continuous up to the acceleration.
 class JointStateInterpolator
 {
   public:
-    JointStateInterpolator(int dof, std::string method);
+    JointStateInterpolator(int dof, std::string method, double blend_time = 0.0);
     ~JointStateInterpolator() = default;
     void init(JointState start_state, JointState end_state);
     void init_fixed(JointState start_state);
     void append_waypoint(double current_time, JointState end_state);
     void append_traj(double current_time, std::vector<JointState> traj);
+    void append_traj(double current_time, const JointTrajectory &traj);
     void override_waypoint(double current_time, JointState end_state);
     void override_traj(double current_time, std::vector<JointState> traj);
+    void override_traj(double current_time, const JointTrajectory &traj);
     JointState interpolate(double time);
     std::string to_string();
     bool is_initialized();
+    double get_end_time(); // Timestamp of the last waypoint
 
   private:
     int dof_;
     bool initialized_ = false;
     std::string method_;
-    std::vector<JointState> traj_;
+    JointTrajectory traj_;
+    double blend_time_;
+    // Blend offset: sum of blend_coeffs_[k] * (time - blend_start_time_)^k, added to traj_ until blend_end_time_
+    double blend_start_time_ = 0.0;
+    double blend_end_time_ = 0.0;
+    Eigen::MatrixXd blend_coeffs_; // dof x 6
+    JointState interpolate_traj_(double time);
+    int upper_bound_(double time); // Index of the first waypoint after `time`
+    // Check a new trajectory and return the index of its first waypoint not before current_time
+    int first_new_waypoint_(double current_time, const JointTrajectory &traj);
+    // Restart from the current state, followed by the waypoints [prev_begin, prev_end) of the current trajectory and
+    // the waypoints of `traj` from `begin`
+    void restart_traj_(double current_time, int prev_begin, int prev_end, const JointTrajectory &traj, int begin);
+    void pos_derivatives_(double time, double direction, Eigen::VectorXd &vel, Eigen::VectorXd &acc);
+    void start_blend_(double current_time, const Eigen::VectorXd &prev_vel, const Eigen::VectorXd &prev_acc);
+};
+
+// Interpolates eef poses in cartesian space: linear or cubic (Catmull-Rom spline through the waypoints, zero velocity
+// at both ends) translation, and SLERP rotation. The gripper is always linearly interpolated.
+class EEFStateInterpolator
+{
+  public:
+    EEFStateInterpolator(std::string method);
+    ~EEFStateInterpolator() = default;
+    void init_fixed(EEFStateSE3 start_state);
+    void override_waypoint(double current_time, EEFStateSE3 end_state);
+    void override_traj(double current_time, std::vector<EEFStateSE3> traj);
+    EEFStateSE3 interpolate(double time);
+    bool is_initialized();
+    double get_end_time(); // Timestamp of the last waypoint
+
+  private:
+    bool initialized_ = false;
+    std::string method_;
+    std::vector<EEFStateSE3> traj_;
+    Eigen::Vector3d pos_tangent_(int index);
+};
+
+// Single-slot mailbox that always holds the latest written value (triple buffering). write() and read() never block
+// or wait for each other, so a real-time thread can poll it every tick. Supports one writer and one reader at a time.
+template <typename T> class Mailbox
+{
+  public:
+    Mailbox(const T &initial_value) : buffers_{initial_value, initial_value, initial_value}
+    {
+    }
+    void write(const T &value)
+    {
+        buffers_[write_index_] = value;
+        write_index_ = shared_index_.exchange(write_index_ | FRESH_BIT_, std::memory_order_acq_rel) & INDEX_MASK_;
+    }
+    // Copy the latest value into `value`. Returns false and leaves it untouched if nothing was written since the last
+    // read. Assigning to a preallocated value of the same size does not allocate (for Eigen members).
+    bool read(T &value)
+    {
+        if ((shared_index_.load(std::memory_order_acquire) & FRESH_BIT_) == 0)
+            return false;
+        read_index_ = shared_index_.exchange(read_index_, std::memory_order_acq_rel) & INDEX_MASK_;
+        value = buffers_[read_index_];
+        return true;
+    }
+
+  private:
+    static const int FRESH_BIT_ = 4;
+    static const int INDEX_MASK_ = 3;
+    T buffers_[3];
+    int write_index_ = 0;              // only used by the writer
+    int read_index_ = 1;               // only used by the reader
+    std::atomic<int> shared_index_{2}; // the buffer in between, with FRESH_BIT_ set by write()
 };
 
+// Waypoint velocities by windowed finite differences, see TrajDerivative for the incremental and spline variants
 void calc_joint_vel(std::vector<JointState> &traj, double avg_window_s = 0.05);
+void calc_joint_vel(JointTrajectory &traj, double avg_window_s = 0.05);
 // std::string vec2str(const Eigen::VectorXd& vec, int precision = 3);
 
 std::string joint_traj2str(const std::vector<JointState> &traj, int precision = 3);
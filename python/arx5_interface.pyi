@@ -1,4 +1,4 @@
-from typing import Tuple, overload
+from typing import Callable, Optional, Tuple, overload
 import numpy as np
 import numpy.typing as npt
 from enum import Enum
@@ -31,6 +31,7 @@ class RobotConfig:
     base_link_name: str
     eef_link_name: str
     urdf_path: str
+    reachability_map_path: str
 
 class ControllerConfig:
     """Does not have a constructor, use ControllerConfigFactory.get_instance().get_config(...) instead."""
@@ -47,6 +48,56 @@ class ControllerConfig:
     shutdown_to_passive: bool
     interpolation_method: str
     default_preview_time: float
+    override_blend_time: float
+    command_clock: str
+    traj_vel_method: str
+    estimator_pos_noise: float
+    estimator_vel_noise: float
+    estimator_jerk_noise: float
+    ik_method: str
+    ik_timeout: float
+    reachability_reject: bool
+    eef_interpolation: str
+    joint_acc_max: float
+    eef_twist_lin_acc_max: float
+    eef_twist_ang_acc_max: float
+    joint_torque_timeout: float
+    chunk_ensemble_decay: float
+    chunk_fade_time: float
+    chunk_max_num: int
+    collision_check: bool
+    collision_min_distance: float
+    contact_detection: bool
+    momentum_observer_gain: float
+    contact_torque_threshold: npt.NDArray[np.float64]
+    contact_reaction: str
+    contact_retract_distance: float
+    contact_retract_time: float
+    grasp_contact_vel: float
+    grasp_contact_ratio: float
+    grasp_contact_time: float
+    grasp_min_width: float
+    grasp_slip_distance: float
+    load_shedding_max_level: int
+    overrun_tolerance: float
+    overrun_escalate_cnt: int
+    overrun_recover_cnt: int
+    gravity_comp_period: float
+    diagnostics_period: float
+    task_budget_ratio: float
+
+class TeleopConfig:
+    def __init__(self, joint_dof: int) -> None: ...
+    joint_scale: np.ndarray
+    joint_offset: np.ndarray
+    vel_feedforward: float
+    gripper_scale: float
+    gripper_offset: float
+    leader_state_timeout: float
+    force_feedback_scale: float
+    gripper_force_feedback_scale: float
+    force_feedback_damping_max: float
+    force_feedback_energy_max: float
 
 class RobotConfigFactory:
     @classmethod
@@ -106,6 +157,51 @@ class JointState:
     def vel(self) -> npt.NDArray[np.float64]: ...
     def torque(self) -> npt.NDArray[np.float64]: ...
 
+class JointTrajectory:
+    """Structure of arrays, one row per waypoint. The array attributes are views (no copy): modify them in place, or
+    assign new arrays of shape (size,) or (size, dof)"""
+
+    timestamps: npt.NDArray[np.float64]
+    pos: npt.NDArray[np.float64]
+    vel: npt.NDArray[np.float64]
+    torque: npt.NDArray[np.float64]
+    gripper_pos: npt.NDArray[np.float64]
+    @overload
+    def __init__(self, dof: int, size: int = 0) -> None: ...
+    @overload
+    def __init__(self, traj: list[JointState]) -> None: ...
+    def size(self) -> int: ...
+    def dof(self) -> int: ...
+    def get_state(self, index: int) -> JointState: ...
+    def set_state(self, index: int, state: JointState) -> None: ...
+    def to_states(self) -> list[JointState]: ...
+
+class EEFTrajectory:
+    """Structure of arrays, one row per waypoint, poses as (x, y, z, roll, pitch, yaw)"""
+
+    timestamps: npt.NDArray[np.float64]
+    pose_6d: npt.NDArray[np.float64]
+    gripper_pos: npt.NDArray[np.float64]
+    @overload
+    def __init__(self, size: int = 0) -> None: ...
+    @overload
+    def __init__(self, traj: list[EEFState]) -> None: ...
+    def size(self) -> int: ...
+    def get_state(self, index: int) -> EEFStateSE3: ...
+
+class JointStateEstimate:
+    """Kalman-filtered joint state, see controller_config.estimator_*_noise"""
+
+    def __init__(self, dof: int) -> None: ...
+    @property
+    def timestamp(self) -> float: ...
+    @property
+    def pos(self) -> npt.NDArray[np.float64]: ...
+    @property
+    def vel(self) -> npt.NDArray[np.float64]: ...
+    @property
+    def acc(self) -> npt.NDArray[np.float64]: ...
+
 class Arx5JointController:
     @overload
     def __init__(
@@ -123,11 +219,42 @@ class Arx5JointController:
     def send_recv_once(self) -> None: ...
     def recv_once(self) -> None: ...
     def set_joint_cmd(self, cmd: JointState) -> None: ...
-    def set_joint_traj(self, traj: list[JointState]) -> None: ...
+    @overload
+    def set_joint_traj(self, traj: list[JointState]) -> TrajHandle: ...
+    @overload
+    def set_joint_traj(self, traj: JointTrajectory) -> TrajHandle: ...
+    def set_joint_vel(
+        self,
+        joint_vel: npt.NDArray[np.float64],
+        timeout: float = 0.1,
+        gripper_vel: float = 0.0,
+    ) -> None:
+        """Joints decelerate to zero if not refreshed within timeout"""
+        ...
+    def set_joint_torque(self, joint_torque: npt.NDArray[np.float64]) -> None:
+        """Sent at the next tick. Falls back to damping after controller_config.joint_torque_timeout"""
+        ...
+    def submit_action_chunk(
+        self, chunk: list[JointState], observation_timestamp: float, action_dt: float
+    ) -> None:
+        """Blended with the other in-flight chunks at every tick (controller_config.chunk_ensemble_decay)"""
+        ...
     def get_joint_cmd(self) -> JointState: ...
     def get_timestamp(self) -> float: ...
+    def get_clock_domain(self) -> ClockDomain: ...
+    def get_event_bus(self) -> EventBus: ...
+    def get_loop_stats(self) -> LoopStats: ...
+    def reset_loop_stats(self) -> None: ...
+    def get_load_level(self) -> LoadLevel: ...
+    def get_task_stats(self) -> list[TaskStats]: ...
+    def reset_task_stats(self) -> None: ...
+    def get_diagnostics(self) -> Diagnostics: ...
     def get_joint_state(self) -> JointState: ...
+    def get_joint_state_estimate(self) -> JointStateEstimate: ...
+    def get_external_torque(self) -> npt.NDArray[np.float64]: ...
+    def is_contact_detected(self) -> bool: ...
     def get_eef_state(self) -> EEFState: ...
+    def get_eef_state_se3(self) -> EEFStateSE3: ...
     def get_home_pose(self) -> np.ndarray: ...
     def set_gain(self, gain: Gain) -> None: ...
     def get_gain(self) -> Gain: ...
@@ -135,9 +262,24 @@ class Arx5JointController:
     def get_controller_config(self) -> ControllerConfig: ...
     def reset_to_home(self) -> None: ...
     def set_to_damping(self) -> None: ...
+    def grasp(self, torque: float, speed: float = 0.05) -> None: ...
+    def release_grasp(self) -> None: ...
+    def get_grasp_state(self) -> GraspState: ...
+    def get_grasp_width(self) -> float: ...
     def calibrate_gripper(self) -> None: ...
     def calibrate_joint(self, joint_id: int) -> None: ...
     def set_log_level(self, level: LogLevel) -> None: ...
+    def set_collision_peer(
+        self,
+        peer: Arx5JointController | Arx5CartesianController | None,
+        peer_base_pose: npt.NDArray[np.float64],
+    ) -> None: ...
+    def set_teleop_leader(
+        self,
+        leader: Arx5JointController | Arx5CartesianController | None,
+        teleop_config: TeleopConfig,
+    ) -> None: ...
+    def get_teleop_config(self) -> TeleopConfig: ...
 
 class EEFState:
     timestamp: float
@@ -154,6 +296,45 @@ class EEFState:
     def __mul__(self, scalar: float) -> EEFState: ...
     def pose_6d(self) -> npt.NDArray[np.float64]: ...
 
+class PoseSE3:
+    pos: npt.NDArray[np.float64]
+    quat: npt.NDArray[np.float64]
+    """Unit quaternion in (w, x, y, z) order"""
+    @overload
+    def __init__(self) -> None: ...
+    @overload
+    def __init__(
+        self, pos: npt.NDArray[np.float64], quat: npt.NDArray[np.float64]
+    ) -> None: ...
+    @overload
+    def __init__(
+        self, pos: npt.NDArray[np.float64], rot: npt.NDArray[np.float64]
+    ) -> None: ...
+    @staticmethod
+    def from_pose_6d(pose_6d: npt.NDArray[np.float64]) -> PoseSE3: ...
+    @staticmethod
+    def from_matrix(matrix: npt.NDArray[np.float64]) -> PoseSE3: ...
+    def to_pose_6d(self) -> npt.NDArray[np.float64]: ...
+    def to_matrix(self) -> npt.NDArray[np.float64]: ...
+    def rotation_matrix(self) -> npt.NDArray[np.float64]: ...
+    def inverse(self) -> PoseSE3: ...
+    def interpolate(self, other: PoseSE3, alpha: float) -> PoseSE3: ...
+    def __mul__(self, other: PoseSE3) -> PoseSE3: ...
+
+class EEFStateSE3:
+    timestamp: float
+    pose: PoseSE3
+    gripper_pos: float
+    gripper_vel: float
+    gripper_torque: float
+    @overload
+    def __init__(self) -> None: ...
+    @overload
+    def __init__(self, pose: PoseSE3, gripper_pos: float) -> None: ...
+    @overload
+    def __init__(self, eef_state: EEFState) -> None: ...
+    def to_eef_state(self) -> EEFState: ...
+
 class Arx5CartesianController:
     @overload
     def __init__(self, model: str, interface_name: str) -> None: ...
@@ -164,13 +345,42 @@ class Arx5CartesianController:
         controller_config: ControllerConfig,
         interface_name: str,
     ) -> None: ...
+    @overload
     def set_eef_cmd(self, cmd: EEFState) -> None: ...
-    def set_eef_traj(self, traj: list[EEFState]) -> None: ...
+    @overload
+    def set_eef_cmd(self, cmd: EEFStateSE3) -> None: ...
+    @overload
+    def set_eef_traj(self, traj: list[EEFState]) -> TrajHandle: ...
+    @overload
+    def set_eef_traj(self, traj: list[EEFStateSE3]) -> TrajHandle: ...
+    @overload
+    def set_eef_traj(self, traj: EEFTrajectory) -> TrajHandle: ...
+    def set_eef_twist(
+        self,
+        twist: npt.NDArray[np.float64],
+        timeout: float = 0.1,
+        gripper_vel: float = 0.0,
+    ) -> None:
+        """twist: (vx, vy, vz, wx, wy, wz) in the base frame. The arm stops if not refreshed within timeout"""
+        ...
     def get_joint_cmd(self) -> JointState: ...
     def get_eef_cmd(self) -> EEFState: ...
+    def get_eef_cmd_se3(self) -> EEFStateSE3: ...
     def get_eef_state(self) -> EEFState: ...
+    def get_eef_state_se3(self) -> EEFStateSE3: ...
     def get_joint_state(self) -> JointState: ...
+    def get_joint_state_estimate(self) -> JointStateEstimate: ...
+    def get_external_torque(self) -> npt.NDArray[np.float64]: ...
+    def is_contact_detected(self) -> bool: ...
     def get_timestamp(self) -> float: ...
+    def get_clock_domain(self) -> ClockDomain: ...
+    def get_event_bus(self) -> EventBus: ...
+    def get_loop_stats(self) -> LoopStats: ...
+    def reset_loop_stats(self) -> None: ...
+    def get_load_level(self) -> LoadLevel: ...
+    def get_task_stats(self) -> list[TaskStats]: ...
+    def reset_task_stats(self) -> None: ...
+    def get_diagnostics(self) -> Diagnostics: ...
     def set_gain(self, gain: Gain) -> None: ...
     def get_gain(self) -> Gain: ...
     def get_home_pose(self) -> np.ndarray: ...
@@ -179,6 +389,32 @@ class Arx5CartesianController:
     def get_controller_config(self) -> ControllerConfig: ...
     def reset_to_home(self) -> None: ...
     def set_to_damping(self) -> None: ...
+    def grasp(self, torque: float, speed: float = 0.05) -> None: ...
+    def release_grasp(self) -> None: ...
+    def get_grasp_state(self) -> GraspState: ...
+    def get_grasp_width(self) -> float: ...
+    def multi_trial_ik(
+        self,
+        target_pose_6d: npt.NDArray[np.float64],
+        current_joint_pos: npt.NDArray[np.float64],
+        additional_trial_num: int = 5,
+    ) -> Tuple[int, npt.NDArray[np.float64]]: ...
+    def get_ik_portfolio_stats(self) -> list[IkSolverStats]: ...
+    @overload
+    def is_reachable(self, pose_6d: npt.NDArray[np.float64]) -> bool: ...
+    @overload
+    def is_reachable(self, pose: PoseSE3) -> bool: ...
+    def set_collision_peer(
+        self,
+        peer: Arx5JointController | Arx5CartesianController | None,
+        peer_base_pose: npt.NDArray[np.float64],
+    ) -> None: ...
+    def set_teleop_leader(
+        self,
+        leader: Arx5JointController | Arx5CartesianController | None,
+        teleop_config: TeleopConfig,
+    ) -> None: ...
+    def get_teleop_config(self) -> TeleopConfig: ...
 
 class Arx5Solver:
     @overload
@@ -221,3 +457,392 @@ class Arx5Solver:
     def forward_kinematics(
         self, joint_pos: npt.NDArray[np.float64]
     ) -> npt.NDArray[np.float64]: ...
+
+class TrajDerivative:
+    def __init__(self, dof: int, method: str, avg_window_s: float = 0.05) -> None: ...
+    def reserve(self, waypoint_num: int) -> None: ...
+    def clear(self) -> None: ...
+    def set_boundary_vel(self, start_vel: npt.NDArray[np.float64], end_vel: npt.NDArray[np.float64]) -> None: ...
+    def append(self, timestamp: float, pos: npt.NDArray[np.float64]) -> None: ...
+    def assign(self, timestamps: npt.NDArray[np.float64], pos: npt.NDArray[np.float64]) -> None:
+        """pos: (dof, waypoint number), one column per waypoint"""
+        ...
+    def size(self) -> int: ...
+    def get_timestamps(self) -> npt.NDArray[np.float64]: ...
+    def get_pos(self) -> npt.NDArray[np.float64]: ...
+    def get_vel(self) -> npt.NDArray[np.float64]: ...
+    def get_acc(self) -> npt.NDArray[np.float64]: ...
+
+class ExponentialFilter:
+    def __init__(self, channels: int, dt: float, cutoff: float) -> None: ...
+    def filter(self, x: npt.NDArray[np.float64]) -> npt.NDArray[np.float64]: ...
+    def filter_array(self, samples: npt.NDArray[np.float64]) -> npt.NDArray[np.float64]:
+        """One sample per row, returns the filtered samples"""
+        ...
+    def reset(self) -> None: ...
+    def get_channels(self) -> int: ...
+
+class OneEuroFilter:
+    def __init__(
+        self, channels: int, dt: float, min_cutoff: float = 1.0, beta: float = 0.0, derivative_cutoff: float = 1.0
+    ) -> None: ...
+    def filter(self, x: npt.NDArray[np.float64]) -> npt.NDArray[np.float64]: ...
+    def filter_array(self, samples: npt.NDArray[np.float64]) -> npt.NDArray[np.float64]: ...
+    def reset(self) -> None: ...
+    def get_channels(self) -> int: ...
+
+class ButterworthFilter:
+    def __init__(self, channels: int, dt: float, cutoff: float, order: int = 2) -> None: ...
+    def filter(self, x: npt.NDArray[np.float64]) -> npt.NDArray[np.float64]: ...
+    def filter_array(self, samples: npt.NDArray[np.float64]) -> npt.NDArray[np.float64]: ...
+    def reset(self) -> None: ...
+    def get_channels(self) -> int: ...
+
+class SavitzkyGolayFilter:
+    def __init__(self, channels: int, dt: float, window: int, poly_order: int = 2, derivative: int = 0) -> None: ...
+    def filter(self, x: npt.NDArray[np.float64]) -> npt.NDArray[np.float64]: ...
+    def filter_array(self, samples: npt.NDArray[np.float64]) -> npt.NDArray[np.float64]: ...
+    def reset(self) -> None: ...
+    def get_channels(self) -> int: ...
+
+class LatencyStats:
+    count: int
+    last: float
+    mean: float
+    max: float
+
+class ClockDomain:
+    """Does not have a constructor, use controller.get_clock_domain() instead.
+    clock: "controller", "monotonic" (time.monotonic()), "realtime" (time.time()) or "tai"
+    """
+
+    def now(self, clock: str) -> float: ...
+    def to_controller_time(self, time: float, clock: str) -> float: ...
+    def from_controller_time(self, controller_time: float, clock: str) -> float: ...
+    def get_epoch(self, clock: str) -> float: ...
+    def record_latency(self, client_time: float, clock: str) -> None: ...
+    def get_latency_stats(self) -> LatencyStats: ...
+    def reset_latency_stats(self) -> None: ...
+
+class EventType:
+    OVER_CURRENT: "EventType"
+    EMERGENCY: "EventType"
+    GRIPPER_STALL: "EventType"
+    IK_FAILURE: "EventType"
+    EEF_UNTRACKABLE: "EventType"
+    JOINT_POS_CLIPPED: "EventType"
+    JOINT_VEL_CLIPPED: "EventType"
+    TORQUE_CLIPPED: "EventType"
+    COLLISION_BLOCKED: "EventType"
+    CONTACT: "EventType"
+    TORQUE_TIMEOUT: "EventType"
+    TELEOP_LEADER_LOST: "EventType"
+    TRAJ_COMPLETE: "EventType"
+    GRASPED: "EventType"
+    GRASP_MISSED: "EventType"
+    GRASP_SLIP: "EventType"
+    LOAD_LEVEL_CHANGED: "EventType"
+    UNREACHABLE: "EventType"
+
+class Event:
+    type: EventType
+    seq: int  # Increasing in delivery order, events dropped by a full bus get none
+    timestamp: float  # Controller time
+    joint_id: int  # -1 if not about a joint, joint_dof for the gripper
+    value: float
+
+class EventListener:
+    """Blocking consumer of an EventBus: `for event in listener` or `async for event in listener`.
+    Iteration ends once the listener is closed."""
+
+    def next(self, timeout: float) -> Optional[Event]: ...  # None on timeout
+    def close(self) -> None: ...
+    def is_closed(self) -> bool: ...
+    def get_dropped_count(self) -> int: ...
+    def __iter__(self) -> "EventListener": ...
+    def __next__(self) -> Event: ...
+    def __aiter__(self) -> "EventListener": ...
+    async def __anext__(self) -> Event: ...
+
+class EventBus:
+    """Does not have a constructor, use controller.get_event_bus() instead.
+    Callbacks run on the dispatch thread of the bus. Unsubscribe them before deleting the controller.
+    """
+
+    def publish(self, type: EventType, timestamp: float, joint_id: int = -1, value: float = 0.0) -> bool: ...
+    def subscribe(self, callback: Callable[[Event], None]) -> int: ...
+    def unsubscribe(self, id: int) -> None: ...
+    def listen(self, capacity: int = 1024) -> EventListener: ...
+    def get_dropped_count(self) -> int: ...
+
+class GraspState:
+    IDLE: "GraspState"
+    CLOSING: "GraspState"
+    HOLDING: "GraspState"
+    MISSED: "GraspState"
+
+class LoadLevel:
+    NORMAL: "LoadLevel"
+    SHED_OPTIONAL: "LoadLevel"
+    REDUCED_RATE: "LoadLevel"
+    HOLD: "LoadLevel"
+
+class LoopStats:
+    count: int
+    overrun_count: int
+    last: float
+    mean: float
+    max: float
+
+class TaskStats:
+    name: str
+    period: float
+    priority: int
+    count: int
+    deferred_count: int  # Ticks where the task was postponed for lack of time
+    last: float
+    mean: float
+    max: float
+
+class Diagnostics:
+    timestamp: float
+    eef_pose: PoseSE3
+    motor_temperature: npt.NDArray[np.float64]  # Joints then gripper
+
+class TrajStatus:
+    RUNNING: "TrajStatus"
+    COMPLETED: "TrajStatus"
+    OVERRIDDEN: "TrajStatus"
+
+class TrajProgress:
+    status: TrajStatus
+    next_waypoint: int  # waypoint_num once the last waypoint is reached
+    waypoint_num: int
+    time_remaining: float
+    tracking_error_max: float  # rad
+    tracking_error_rms: float  # rad
+
+class TrajHandle:
+    """Returned by set_joint_traj and set_eef_traj. `await handle` resolves to the final TrajStatus."""
+
+    def get_status(self) -> TrajStatus: ...
+    def get_progress(self) -> TrajProgress: ...
+    def is_done(self) -> bool: ...
+    def wait(self, timeout: float = -1.0) -> bool: ...  # Forever if negative, returns is_done()
+    def get_end_time(self) -> float: ...
+    def __await__(self): ...
+
+class IkSolverStats:
+    name: str
+    attempts: int
+    successes: int
+    wins: int
+    avg_latency_ms: float
+    max_latency_ms: float
+
+class Arx5IkPortfolio:
+    @overload
+    def __init__(
+        self,
+        urdf_path: str,
+        joint_dof: int,
+        joint_pos_min: npt.NDArray[np.float64],
+        joint_pos_max: npt.NDArray[np.float64],
+    ) -> None: ...
+    @overload
+    def __init__(
+        self,
+        urdf_path: str,
+        joint_dof: int,
+        joint_pos_min: npt.NDArray[np.float64],
+        joint_pos_max: npt.NDArray[np.float64],
+        base_link: str,
+        eef_link: str,
+        solver_names: list[str],
+    ) -> None: ...
+    @overload
+    def inverse_kinematics(
+        self,
+        target_pose_6d: npt.NDArray[np.float64],
+        current_joint_pos: npt.NDArray[np.float64],
+        timeout_s: float = 0.005,
+    ) -> Tuple[int, npt.NDArray[np.float64]]: ...
+    @overload
+    def inverse_kinematics(
+        self,
+        target_pose: PoseSE3,
+        current_joint_pos: npt.NDArray[np.float64],
+        timeout_s: float = 0.005,
+    ) -> Tuple[int, npt.NDArray[np.float64]]: ...
+    def get_stats(self) -> list[IkSolverStats]: ...
+    def reset_stats(self) -> None: ...
+    def get_solver_names(self) -> list[str]: ...
+
+class NullspaceIkWeights:
+    joint_limit: float
+    manipulability: float
+    previous: float
+    @overload
+    def __init__(self) -> None: ...
+    @overload
+    def __init__(
+        self, joint_limit: float, manipulability: float, previous: float
+    ) -> None: ...
+
+class Arx5NullspaceIk:
+    @overload
+    def __init__(
+        self,
+        urdf_path: str,
+        joint_dof: int,
+        joint_pos_min: npt.NDArray[np.float64],
+        joint_pos_max: npt.NDArray[np.float64],
+    ) -> None: ...
+    @overload
+    def __init__(
+        self,
+        urdf_path: str,
+        joint_dof: int,
+        joint_pos_min: npt.NDArray[np.float64],
+        joint_pos_max: npt.NDArray[np.float64],
+        base_link: str,
+        eef_link: str,
+    ) -> None: ...
+    @overload
+    def inverse_kinematics(
+        self,
+        target_pose_6d: npt.NDArray[np.float64],
+        current_joint_pos: npt.NDArray[np.float64],
+    ) -> Tuple[int, npt.NDArray[np.float64]]: ...
+    @overload
+    def inverse_kinematics(
+        self,
+        target_pose: PoseSE3,
+        current_joint_pos: npt.NDArray[np.float64],
+    ) -> Tuple[int, npt.NDArray[np.float64]]: ...
+    def manipulability(self, joint_pos: npt.NDArray[np.float64]) -> float: ...
+    def set_weights(self, weights: NullspaceIkWeights) -> None: ...
+    def get_weights(self) -> NullspaceIkWeights: ...
+
+class Arx5DifferentialIk:
+    @overload
+    def __init__(
+        self,
+        urdf_path: str,
+        joint_dof: int,
+        joint_pos_min: npt.NDArray[np.float64],
+        joint_pos_max: npt.NDArray[np.float64],
+    ) -> None: ...
+    @overload
+    def __init__(
+        self,
+        urdf_path: str,
+        joint_dof: int,
+        joint_pos_min: npt.NDArray[np.float64],
+        joint_pos_max: npt.NDArray[np.float64],
+        base_link: str,
+        eef_link: str,
+    ) -> None: ...
+    def inverse_kinematics(
+        self,
+        target_pose: PoseSE3,
+        current_joint_pos: npt.NDArray[np.float64],
+    ) -> Tuple[int, npt.NDArray[np.float64]]: ...
+    def forward_kinematics(self, joint_pos: npt.NDArray[np.float64]) -> PoseSE3: ...
+
+class ReachabilityMap:
+    def __init__(self, map_path: str) -> None: ...
+    @overload
+    def is_reachable(self, pose_6d: npt.NDArray[np.float64]) -> bool: ...
+    @overload
+    def is_reachable(self, pose: PoseSE3) -> bool: ...
+    @overload
+    def get_seed(
+        self, pose_6d: npt.NDArray[np.float64]
+    ) -> Tuple[bool, npt.NDArray[np.float64]]: ...
+    @overload
+    def get_seed(self, pose: PoseSE3) -> Tuple[bool, npt.NDArray[np.float64]]: ...
+    def get_joint_dof(self) -> int: ...
+    def get_path(self) -> str: ...
+    @staticmethod
+    def generate(
+        urdf_path: str,
+        joint_dof: int,
+        joint_pos_min: npt.NDArray[np.float64],
+        joint_pos_max: npt.NDArray[np.float64],
+        base_link: str,
+        eef_link: str,
+        output_path: str,
+        voxel_size: float = 0.03,
+        ori_resolution: int = 2,
+        sample_num: int = 2000000,
+    ) -> None: ...
+
+class Arx5LinkKinematics:
+    @overload
+    def __init__(self, urdf_path: str, joint_dof: int) -> None: ...
+    @overload
+    def __init__(
+        self, urdf_path: str, joint_dof: int, base_link: str, eef_link: str
+    ) -> None: ...
+    def link_transforms(
+        self, joint_pos: npt.NDArray[np.float64]
+    ) -> npt.NDArray[np.float64]:
+        """Returns (link_num, 4, 4) homogeneous transforms in the base frame"""
+        ...
+    def batch_link_transforms(
+        self, joint_pos: npt.NDArray[np.float64]
+    ) -> npt.NDArray[np.float64]:
+        """joint_pos: (N, joint_dof). Returns (N, link_num, 4, 4)"""
+        ...
+    def forward_kinematics(self, joint_pos: npt.NDArray[np.float64]) -> PoseSE3: ...
+    def get_link_names(self) -> list[str]: ...
+    def get_link_num(self) -> int: ...
+    def get_joint_dof(self) -> int: ...
+
+class CollisionCapsule:
+    link_name: str
+    p0: npt.NDArray[np.float64]
+    p1: npt.NDArray[np.float64]
+    radius: float
+
+class CollisionResult:
+    distance: float
+    link_a: str
+    link_b: str
+    point_a: npt.NDArray[np.float64]
+    point_b: npt.NDArray[np.float64]
+
+class Arx5CollisionChecker:
+    @overload
+    def __init__(self, urdf_path: str, joint_dof: int) -> None: ...
+    @overload
+    def __init__(
+        self, urdf_path: str, joint_dof: int, base_link: str, eef_link: str
+    ) -> None: ...
+    def self_distance(self, joint_pos: npt.NDArray[np.float64]) -> CollisionResult: ...
+    def inter_arm_distance(
+        self,
+        joint_pos: npt.NDArray[np.float64],
+        other: Arx5CollisionChecker,
+        other_base_pose: npt.NDArray[np.float64],
+        other_joint_pos: npt.NDArray[np.float64],
+    ) -> CollisionResult: ...
+    def validate_trajectory(
+        self,
+        joint_traj: list[JointState],
+        min_distance: float = 0.0,
+        max_joint_step: float = 0.05,
+    ) -> int: ...
+    def validate_dual_trajectory(
+        self,
+        joint_traj: list[JointState],
+        other: Arx5CollisionChecker,
+        other_base_pose: npt.NDArray[np.float64],
+        other_joint_traj: list[JointState],
+        min_distance: float = 0.0,
+        max_joint_step: float = 0.05,
+    ) -> int: ...
+    def get_capsules(self) -> list[CollisionCapsule]: ...
+    def get_excluded_pairs(self) -> list[Tuple[str, str]]: ...
+    def set_pair_excluded(self, link_a: str, link_b: str, excluded: bool) -> None: ...
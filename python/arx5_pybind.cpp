@@ -1,12 +1,29 @@
 #include "app/cartesian_controller.h"
+#include "app/clock_domain.h"
+#include "app/collision.h"
 #include "app/common.h"
 #include "app/config.h"
 #include "app/controller_base.h"
+#include "app/differential_ik.h"
+#include "app/event_bus.h"
+#include "app/filters.h"
+#include "app/gripper_controller.h"
+#include "app/ik_portfolio.h"
 #include "app/joint_controller.h"
+#include "app/link_kinematics.h"
+#include "app/nullspace_ik.h"
+#include "app/reachability_map.h"
+#include "app/traj_derivative.h"
+#include "app/traj_handle.h"
 #include "hardware/arx_can.h"
 #include "spdlog/spdlog.h"
 #include "utils.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <pybind11/eigen.h>
+#include <pybind11/functional.h>
+#include <pybind11/numpy.h>
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 namespace py = pybind11;
@@ -36,6 +53,55 @@ PYBIND11_MODULE(arx5_interface, m)
         .def("pos", &JointState::get_pos_ref, py::return_value_policy::reference)
         .def("vel", &JointState::get_vel_ref, py::return_value_policy::reference)
         .def("torque", &JointState::get_torque_ref, py::return_value_policy::reference);
+    py::class_<JointStateEstimate>(m, "JointStateEstimate")
+        .def(py::init<int>())
+        .def_readonly("timestamp", &JointStateEstimate::timestamp)
+        .def_readonly("pos", &JointStateEstimate::pos)
+        .def_readonly("vel", &JointStateEstimate::vel)
+        .def_readonly("acc", &JointStateEstimate::acc);
+    // The array properties are views on the trajectory (no copy), assigning an array copies it once
+    py::class_<JointTrajectory>(m, "JointTrajectory")
+        .def(py::init<int, int>(), py::arg("dof"), py::arg("size") = 0)
+        .def(py::init<const std::vector<JointState> &>())
+        .def_property(
+            "timestamps", [](JointTrajectory &self) -> Eigen::VectorXd & { return self.timestamps; },
+            [](JointTrajectory &self, const Eigen::VectorXd &timestamps) { self.timestamps = timestamps; })
+        .def_property(
+            "pos", [](JointTrajectory &self) -> TrajMatrix & { return self.pos; },
+            [](JointTrajectory &self, const TrajMatrix &pos) { self.pos = pos; })
+        .def_property(
+            "vel", [](JointTrajectory &self) -> TrajMatrix & { return self.vel; },
+            [](JointTrajectory &self, const TrajMatrix &vel) { self.vel = vel; })
+        .def_property(
+            "torque", [](JointTrajectory &self) -> TrajMatrix & { return self.torque; },
+            [](JointTrajectory &self, const TrajMatrix &torque) { self.torque = torque; })
+        .def_property(
+            "gripper_pos", [](JointTrajectory &self) -> Eigen::VectorXd & { return self.gripper_pos; },
+            [](JointTrajectory &self, const Eigen::VectorXd &gripper_pos) { self.gripper_pos = gripper_pos; })
+        .def("size", &JointTrajectory::size)
+        .def("dof", &JointTrajectory::dof)
+        .def("get_state", &JointTrajectory::get_state)
+        .def("set_state", &JointTrajectory::set_state)
+        .def("to_states", &JointTrajectory::to_states);
+    py::class_<EEFTrajectory>(m, "EEFTrajectory")
+        .def(py::init<int>(), py::arg("size") = 0)
+        .def(py::init<const std::vector<EEFState> &>())
+        .def_property(
+            "timestamps", [](EEFTrajectory &self) -> Eigen::VectorXd & { return self.timestamps; },
+            [](EEFTrajectory &self, const Eigen::VectorXd &timestamps) { self.timestamps = timestamps; })
+        .def_property(
+            "pose_6d",
+            [](EEFTrajectory &self) -> Eigen::Matrix<double, Eigen::Dynamic, 6, Eigen::RowMajor> & {
+                return self.pose_6d;
+            },
+            [](EEFTrajectory &self, const Eigen::Matrix<double, Eigen::Dynamic, 6, Eigen::RowMajor> &pose_6d) {
+                self.pose_6d = pose_6d;
+            })
+        .def_property(
+            "gripper_pos", [](EEFTrajectory &self) -> Eigen::VectorXd & { return self.gripper_pos; },
+            [](EEFTrajectory &self, const Eigen::VectorXd &gripper_pos) { self.gripper_pos = gripper_pos; })
+        .def("size", &EEFTrajectory::size)
+        .def("get_state", &EEFTrajectory::get_state);
     py::class_<EEFState>(m, "EEFState")
         .def(py::init<>())
         .def(py::init<Pose6d, double>())
@@ -46,6 +112,42 @@ PYBIND11_MODULE(arx5_interface, m)
         .def("__add__", [](const EEFState &self, const EEFState &other) { return self + other; })
         .def("__mul__", [](const EEFState &self, const float &scalar) { return self * scalar; })
         .def("pose_6d", &EEFState::get_pose_6d_ref, py::return_value_policy::reference);
+    // Quaternions are exposed as numpy arrays in (w, x, y, z) order
+    py::class_<PoseSE3>(m, "PoseSE3")
+        .def(py::init<>())
+        .def(py::init([](Eigen::Vector3d pos, Eigen::Vector4d quat_wxyz) {
+                 return PoseSE3(pos, Eigen::Quaterniond(quat_wxyz[0], quat_wxyz[1], quat_wxyz[2], quat_wxyz[3]));
+             }),
+             py::arg("pos"), py::arg("quat"))
+        .def(py::init<Eigen::Vector3d, Eigen::Matrix3d>(), py::arg("pos"), py::arg("rot"))
+        .def_readwrite("pos", &PoseSE3::pos)
+        .def_property(
+            "quat",
+            [](const PoseSE3 &self) {
+                return Eigen::Vector4d(self.quat.w(), self.quat.x(), self.quat.y(), self.quat.z());
+            },
+            [](PoseSE3 &self, Eigen::Vector4d quat_wxyz) {
+                self.quat =
+                    Eigen::Quaterniond(quat_wxyz[0], quat_wxyz[1], quat_wxyz[2], quat_wxyz[3]).normalized();
+            })
+        .def_static("from_pose_6d", &PoseSE3::from_pose_6d)
+        .def_static("from_matrix", &PoseSE3::from_matrix)
+        .def("to_pose_6d", &PoseSE3::to_pose_6d)
+        .def("to_matrix", &PoseSE3::to_matrix)
+        .def("rotation_matrix", &PoseSE3::rotation_matrix)
+        .def("inverse", &PoseSE3::inverse)
+        .def("interpolate", &PoseSE3::interpolate, py::arg("other"), py::arg("alpha"))
+        .def("__mul__", [](const PoseSE3 &self, const PoseSE3 &other) { return self * other; });
+    py::class_<EEFStateSE3>(m, "EEFStateSE3")
+        .def(py::init<>())
+        .def(py::init<PoseSE3, double>())
+        .def(py::init<const EEFState &>())
+        .def_readwrite("timestamp", &EEFStateSE3::timestamp)
+        .def_readwrite("pose", &EEFStateSE3::pose)
+        .def_readwrite("gripper_pos", &EEFStateSE3::gripper_pos)
+        .def_readwrite("gripper_vel", &EEFStateSE3::gripper_vel)
+        .def_readwrite("gripper_torque", &EEFStateSE3::gripper_torque)
+        .def("to_eef_state", &EEFStateSE3::to_eef_state);
     py::class_<Gain>(m, "Gain")
         .def(py::init<int>())
         .def(py::init<VecDoF, VecDoF, double, double>())
@@ -55,17 +157,37 @@ PYBIND11_MODULE(arx5_interface, m)
         .def("__mul__", [](const Gain &self, const float &scalar) { return self * scalar; })
         .def("kp", &Gain::get_kp_ref, py::return_value_policy::reference)
         .def("kd", &Gain::get_kd_ref, py::return_value_policy::reference);
-    py::class_<Arx5JointController>(m, "Arx5JointController")
+    // Only registered so that controllers can be passed to set_collision_peer and set_teleop_leader
+    py::class_<Arx5ControllerBase>(m, "Arx5ControllerBase");
+    py::class_<Arx5JointController, Arx5ControllerBase>(m, "Arx5JointController")
         .def(py::init<const std::string &, const std::string &>())
         .def(py::init<RobotConfig, ControllerConfig, const std::string &>())
         .def("send_recv_once", &Arx5JointController::send_recv_once)
         .def("recv_once", &Arx5JointController::recv_once)
         .def("get_joint_state", &Arx5JointController::get_joint_state)
+        .def("get_joint_state_estimate", &Arx5JointController::get_joint_state_estimate)
+        .def("get_external_torque", &Arx5JointController::get_external_torque)
+        .def("is_contact_detected", &Arx5JointController::is_contact_detected)
         .def("get_timestamp", &Arx5JointController::get_timestamp)
+        .def("get_clock_domain", &Arx5JointController::get_clock_domain)
+        .def("get_event_bus", &Arx5JointController::get_event_bus)
+        .def("get_loop_stats", &Arx5JointController::get_loop_stats)
+        .def("reset_loop_stats", &Arx5JointController::reset_loop_stats)
+        .def("get_load_level", &Arx5JointController::get_load_level)
+        .def("get_task_stats", &Arx5JointController::get_task_stats)
+        .def("reset_task_stats", &Arx5JointController::reset_task_stats)
+        .def("get_diagnostics", &Arx5JointController::get_diagnostics)
         .def("set_joint_cmd", &Arx5JointController::set_joint_cmd)
-        .def("set_joint_traj", &Arx5JointController::set_joint_traj)
+        .def("set_joint_traj", py::overload_cast<std::vector<JointState>>(&Arx5JointController::set_joint_traj))
+        .def("set_joint_traj", py::overload_cast<const JointTrajectory &>(&Arx5JointController::set_joint_traj))
+        .def("set_joint_vel", &Arx5JointController::set_joint_vel, py::arg("joint_vel"), py::arg("timeout") = 0.1,
+             py::arg("gripper_vel") = 0.0)
+        .def("set_joint_torque", &Arx5JointController::set_joint_torque)
+        .def("submit_action_chunk", &Arx5JointController::submit_action_chunk, py::arg("chunk"),
+             py::arg("observation_timestamp"), py::arg("action_dt"))
         .def("get_home_pose", &Arx5JointController::get_home_pose)
         .def("get_eef_state", &Arx5JointController::get_eef_state)
+        .def("get_eef_state_se3", &Arx5JointController::get_eef_state_se3)
         .def("get_joint_cmd", &Arx5JointController::get_joint_cmd)
         .def("set_gain", &Arx5JointController::set_gain)
         .def("get_gain", &Arx5JointController::get_gain)
@@ -73,19 +195,46 @@ PYBIND11_MODULE(arx5_interface, m)
         .def("get_controller_config", &Arx5JointController::get_controller_config)
         .def("reset_to_home", &Arx5JointController::reset_to_home)
         .def("set_to_damping", &Arx5JointController::set_to_damping)
+        .def("grasp", &Arx5JointController::grasp, py::arg("torque"), py::arg("speed") = 0.05)
+        .def("release_grasp", &Arx5JointController::release_grasp)
+        .def("get_grasp_state", &Arx5JointController::get_grasp_state)
+        .def("get_grasp_width", &Arx5JointController::get_grasp_width)
         .def("set_log_level", &Arx5JointController::set_log_level)
         .def("calibrate_joint", &Arx5JointController::calibrate_joint)
-        .def("calibrate_gripper", &Arx5JointController::calibrate_gripper);
-    py::class_<Arx5CartesianController>(m, "Arx5CartesianController")
+        .def("calibrate_gripper", &Arx5JointController::calibrate_gripper)
+        .def("set_collision_peer", &Arx5JointController::set_collision_peer, py::arg("peer"),
+             py::arg("peer_base_pose"), py::keep_alive<1, 2>())
+        .def("set_teleop_leader", &Arx5JointController::set_teleop_leader, py::arg("leader"),
+             py::arg("teleop_config"), py::keep_alive<1, 2>())
+        .def("get_teleop_config", &Arx5JointController::get_teleop_config);
+    py::class_<Arx5CartesianController, Arx5ControllerBase>(m, "Arx5CartesianController")
         .def(py::init<const std::string &, const std::string &>())
         .def(py::init<RobotConfig, ControllerConfig, const std::string &>())
-        .def("set_eef_cmd", &Arx5CartesianController::set_eef_cmd)
-        .def("set_eef_traj", &Arx5CartesianController::set_eef_traj)
+        .def("set_eef_cmd", py::overload_cast<EEFState>(&Arx5CartesianController::set_eef_cmd))
+        .def("set_eef_cmd", py::overload_cast<EEFStateSE3>(&Arx5CartesianController::set_eef_cmd))
+        .def("set_eef_traj", py::overload_cast<std::vector<EEFState>>(&Arx5CartesianController::set_eef_traj))
+        .def("set_eef_traj", py::overload_cast<std::vector<EEFStateSE3>>(&Arx5CartesianController::set_eef_traj))
+        .def("set_eef_traj", py::overload_cast<const EEFTrajectory &>(&Arx5CartesianController::set_eef_traj))
+        .def("set_eef_twist", &Arx5CartesianController::set_eef_twist, py::arg("twist"), py::arg("timeout") = 0.1,
+             py::arg("gripper_vel") = 0.0)
         .def("get_joint_cmd", &Arx5CartesianController::get_joint_cmd)
         .def("get_eef_cmd", &Arx5CartesianController::get_eef_cmd)
+        .def("get_eef_cmd_se3", &Arx5CartesianController::get_eef_cmd_se3)
         .def("get_eef_state", &Arx5CartesianController::get_eef_state)
+        .def("get_eef_state_se3", &Arx5CartesianController::get_eef_state_se3)
         .def("get_joint_state", &Arx5CartesianController::get_joint_state)
+        .def("get_joint_state_estimate", &Arx5CartesianController::get_joint_state_estimate)
+        .def("get_external_torque", &Arx5CartesianController::get_external_torque)
+        .def("is_contact_detected", &Arx5CartesianController::is_contact_detected)
         .def("get_timestamp", &Arx5CartesianController::get_timestamp)
+        .def("get_clock_domain", &Arx5CartesianController::get_clock_domain)
+        .def("get_event_bus", &Arx5CartesianController::get_event_bus)
+        .def("get_loop_stats", &Arx5CartesianController::get_loop_stats)
+        .def("reset_loop_stats", &Arx5CartesianController::reset_loop_stats)
+        .def("get_load_level", &Arx5CartesianController::get_load_level)
+        .def("get_task_stats", &Arx5CartesianController::get_task_stats)
+        .def("reset_task_stats", &Arx5CartesianController::reset_task_stats)
+        .def("get_diagnostics", &Arx5CartesianController::get_diagnostics)
         .def("get_home_pose", &Arx5CartesianController::get_home_pose)
         .def("set_gain", &Arx5CartesianController::set_gain)
         .def("get_gain", &Arx5CartesianController::get_gain)
@@ -94,7 +243,19 @@ PYBIND11_MODULE(arx5_interface, m)
         .def("get_controller_config", &Arx5CartesianController::get_controller_config)
         .def("reset_to_home", &Arx5CartesianController::reset_to_home)
         .def("multi_trial_ik", &Arx5CartesianController::multi_trial_ik)
-        .def("set_to_damping", &Arx5CartesianController::set_to_damping);
+        .def("get_ik_portfolio_stats", &Arx5CartesianController::get_ik_portfolio_stats)
+        .def("is_reachable", py::overload_cast<Pose6d>(&Arx5CartesianController::is_reachable))
+        .def("is_reachable", py::overload_cast<PoseSE3>(&Arx5CartesianController::is_reachable))
+        .def("set_to_damping", &Arx5CartesianController::set_to_damping)
+        .def("grasp", &Arx5CartesianController::grasp, py::arg("torque"), py::arg("speed") = 0.05)
+        .def("release_grasp", &Arx5CartesianController::release_grasp)
+        .def("get_grasp_state", &Arx5CartesianController::get_grasp_state)
+        .def("get_grasp_width", &Arx5CartesianController::get_grasp_width)
+        .def("set_collision_peer", &Arx5CartesianController::set_collision_peer, py::arg("peer"),
+             py::arg("peer_base_pose"), py::keep_alive<1, 2>())
+        .def("set_teleop_leader", &Arx5CartesianController::set_teleop_leader, py::arg("leader"),
+             py::arg("teleop_config"), py::keep_alive<1, 2>())
+        .def("get_teleop_config", &Arx5CartesianController::get_teleop_config);
     py::class_<Arx5Solver>(m, "Arx5Solver")
         .def(py::init<const std::string &, int, Eigen::VectorXd, Eigen::VectorXd>())
         .def(py::init<const std::string &, int, Eigen::VectorXd, Eigen::VectorXd, const std::string &,
@@ -104,6 +265,338 @@ PYBIND11_MODULE(arx5_interface, m)
         .def("inverse_kinematics", &Arx5Solver::inverse_kinematics)
         .def("get_ik_status_name", &Arx5Solver::get_ik_status_name)
         .def("multi_trial_ik", &Arx5Solver::multi_trial_ik);
+    py::class_<TrajDerivative>(m, "TrajDerivative")
+        .def(py::init<int, std::string, double>(), py::arg("dof"), py::arg("method"), py::arg("avg_window_s") = 0.05)
+        .def("reserve", &TrajDerivative::reserve)
+        .def("clear", &TrajDerivative::clear)
+        .def("set_boundary_vel", &TrajDerivative::set_boundary_vel)
+        .def("append", &TrajDerivative::append)
+        .def("assign", py::overload_cast<const Eigen::VectorXd &, const Eigen::MatrixXd &>(&TrajDerivative::assign))
+        .def("size", &TrajDerivative::size)
+        .def("get_timestamps", [](TrajDerivative &self) { return Eigen::VectorXd(self.get_timestamps()); })
+        .def("get_pos", [](TrajDerivative &self) { return Eigen::MatrixXd(self.get_pos()); })
+        .def("get_vel", [](TrajDerivative &self) { return Eigen::MatrixXd(self.get_vel()); })
+        .def("get_acc", [](TrajDerivative &self) { return Eigen::MatrixXd(self.get_acc()); });
+    py::class_<ExponentialFilter<>>(m, "ExponentialFilter")
+        .def(py::init<int, double, double>(), py::arg("channels"), py::arg("dt"), py::arg("cutoff"))
+        .def("filter", [](ExponentialFilter<> &self, Eigen::VectorXd x) { return Eigen::VectorXd(self.filter(x)); })
+        .def("filter_array", &filter_samples<ExponentialFilter<>>)
+        .def("reset", &ExponentialFilter<>::reset)
+        .def("get_channels", &ExponentialFilter<>::get_channels);
+    py::class_<OneEuroFilter<>>(m, "OneEuroFilter")
+        .def(py::init<int, double, double, double, double>(), py::arg("channels"), py::arg("dt"),
+             py::arg("min_cutoff") = 1.0, py::arg("beta") = 0.0, py::arg("derivative_cutoff") = 1.0)
+        .def("filter", [](OneEuroFilter<> &self, Eigen::VectorXd x) { return Eigen::VectorXd(self.filter(x)); })
+        .def("filter_array", &filter_samples<OneEuroFilter<>>)
+        .def("reset", &OneEuroFilter<>::reset)
+        .def("get_channels", &OneEuroFilter<>::get_channels);
+    py::class_<ButterworthFilter<>>(m, "ButterworthFilter")
+        .def(py::init<int, double, double, int>(), py::arg("channels"), py::arg("dt"), py::arg("cutoff"),
+             py::arg("order") = 2)
+        .def("filter", [](ButterworthFilter<> &self, Eigen::VectorXd x) { return Eigen::VectorXd(self.filter(x)); })
+        .def("filter_array", &filter_samples<ButterworthFilter<>>)
+        .def("reset", &ButterworthFilter<>::reset)
+        .def("get_channels", &ButterworthFilter<>::get_channels);
+    py::class_<SavitzkyGolayFilter<>>(m, "SavitzkyGolayFilter")
+        .def(py::init<int, double, int, int, int>(), py::arg("channels"), py::arg("dt"), py::arg("window"),
+             py::arg("poly_order") = 2, py::arg("derivative") = 0)
+        .def("filter", [](SavitzkyGolayFilter<> &self, Eigen::VectorXd x) { return Eigen::VectorXd(self.filter(x)); })
+        .def("filter_array", &filter_samples<SavitzkyGolayFilter<>>)
+        .def("reset", &SavitzkyGolayFilter<>::reset)
+        .def("get_channels", &SavitzkyGolayFilter<>::get_channels);
+    py::class_<LatencyStats>(m, "LatencyStats")
+        .def_readonly("count", &LatencyStats::count)
+        .def_readonly("last", &LatencyStats::last)
+        .def_readonly("mean", &LatencyStats::mean)
+        .def_readonly("max", &LatencyStats::max);
+    py::class_<ClockDomain, std::shared_ptr<ClockDomain>>(m, "ClockDomain")
+        .def("now", &ClockDomain::now)
+        .def("to_controller_time", &ClockDomain::to_controller_time)
+        .def("from_controller_time", &ClockDomain::from_controller_time)
+        .def("get_epoch", &ClockDomain::get_epoch)
+        .def("record_latency", &ClockDomain::record_latency)
+        .def("get_latency_stats", &ClockDomain::get_latency_stats)
+        .def("reset_latency_stats", &ClockDomain::reset_latency_stats);
+    py::enum_<EventType>(m, "EventType")
+        .value("OVER_CURRENT", EventType::OVER_CURRENT)
+        .value("EMERGENCY", EventType::EMERGENCY)
+        .value("GRIPPER_STALL", EventType::GRIPPER_STALL)
+        .value("IK_FAILURE", EventType::IK_FAILURE)
+        .value("EEF_UNTRACKABLE", EventType::EEF_UNTRACKABLE)
+        .value("JOINT_POS_CLIPPED", EventType::JOINT_POS_CLIPPED)
+        .value("JOINT_VEL_CLIPPED", EventType::JOINT_VEL_CLIPPED)
+        .value("TORQUE_CLIPPED", EventType::TORQUE_CLIPPED)
+        .value("COLLISION_BLOCKED", EventType::COLLISION_BLOCKED)
+        .value("CONTACT", EventType::CONTACT)
+        .value("TORQUE_TIMEOUT", EventType::TORQUE_TIMEOUT)
+        .value("TELEOP_LEADER_LOST", EventType::TELEOP_LEADER_LOST)
+        .value("TRAJ_COMPLETE", EventType::TRAJ_COMPLETE)
+        .value("GRASPED", EventType::GRASPED)
+        .value("GRASP_MISSED", EventType::GRASP_MISSED)
+        .value("GRASP_SLIP", EventType::GRASP_SLIP)
+        .value("LOAD_LEVEL_CHANGED", EventType::LOAD_LEVEL_CHANGED)
+        .value("UNREACHABLE", EventType::UNREACHABLE);
+    py::class_<Event>(m, "Event")
+        .def_readonly("type", &Event::type)
+        .def_readonly("seq", &Event::seq)
+        .def_readonly("timestamp", &Event::timestamp)
+        .def_readonly("joint_id", &Event::joint_id)
+        .def_readonly("value", &Event::value)
+        .def("__repr__", [](const Event &event) {
+            return "Event(" + event_type_name(event.type) + ", seq=" + std::to_string(event.seq) +
+                   ", timestamp=" + std::to_string(event.timestamp) + ", joint_id=" + std::to_string(event.joint_id) +
+                   ", value=" + std::to_string(event.value) + ")";
+        });
+    // Waits in slices of 0.1s without the GIL, so that Ctrl-C and other Python threads are served
+    auto listener_next = [](EventListener &listener) -> py::object {
+        Event event;
+        while (true)
+        {
+            bool received;
+            {
+                py::gil_scoped_release release;
+                received = listener.next(event, 0.1);
+            }
+            if (received)
+                return py::cast(event);
+            if (listener.is_closed())
+                return py::none();
+            if (PyErr_CheckSignals() != 0)
+                throw py::error_already_set();
+        }
+    };
+    py::class_<EventListener, std::shared_ptr<EventListener>>(m, "EventListener")
+        .def("next",
+             [](EventListener &listener, double timeout) -> py::object {
+                 Event event;
+                 bool received;
+                 {
+                     py::gil_scoped_release release;
+                     received = listener.next(event, timeout);
+                 }
+                 return received ? py::cast(event) : py::none();
+             })
+        .def("close", &EventListener::close)
+        .def("is_closed", &EventListener::is_closed)
+        .def("get_dropped_count", &EventListener::get_dropped_count)
+        .def("__iter__", [](std::shared_ptr<EventListener> listener) { return listener; })
+        .def("__next__",
+             [listener_next](EventListener &listener) {
+                 py::object event = listener_next(listener);
+                 if (event.is_none())
+                     throw py::stop_iteration();
+                 return event;
+             })
+        .def("__aiter__", [](std::shared_ptr<EventListener> listener) { return listener; })
+        .def("__anext__", [listener_next](std::shared_ptr<EventListener> listener) {
+            // Wait in the default executor of the running event loop
+            py::object loop = py::module::import("asyncio").attr("get_running_loop")();
+            py::cpp_function wait([listener_next, listener]() {
+                py::object event = listener_next(*listener);
+                if (event.is_none())
+                {
+                    PyErr_SetNone(PyExc_StopAsyncIteration);
+                    throw py::error_already_set();
+                }
+                return event;
+            });
+            return loop.attr("run_in_executor")(py::none(), wait);
+        });
+    py::class_<EventBus, std::shared_ptr<EventBus>>(m, "EventBus")
+        .def("publish", &EventBus::publish, py::arg("type"), py::arg("timestamp"), py::arg("joint_id") = -1,
+             py::arg("value") = 0.0)
+        // Without the GIL: the dispatch thread may hold the subscriber lock while it waits for the GIL to copy or
+        // call a Python callback
+        .def("subscribe", &EventBus::subscribe, py::call_guard<py::gil_scoped_release>())
+        .def("unsubscribe", &EventBus::unsubscribe, py::call_guard<py::gil_scoped_release>())
+        .def("listen", &EventBus::listen, py::arg("capacity") = 1024, py::call_guard<py::gil_scoped_release>())
+        .def("get_dropped_count", &EventBus::get_dropped_count);
+    py::enum_<GraspState>(m, "GraspState")
+        .value("IDLE", GraspState::IDLE)
+        .value("CLOSING", GraspState::CLOSING)
+        .value("HOLDING", GraspState::HOLDING)
+        .value("MISSED", GraspState::MISSED);
+    py::enum_<LoadLevel>(m, "LoadLevel")
+        .value("NORMAL", LoadLevel::NORMAL)
+        .value("SHED_OPTIONAL", LoadLevel::SHED_OPTIONAL)
+        .value("REDUCED_RATE", LoadLevel::REDUCED_RATE)
+        .value("HOLD", LoadLevel::HOLD);
+    py::class_<LoopStats>(m, "LoopStats")
+        .def_readonly("count", &LoopStats::count)
+        .def_readonly("overrun_count", &LoopStats::overrun_count)
+        .def_readonly("last", &LoopStats::last)
+        .def_readonly("mean", &LoopStats::mean)
+        .def_readonly("max", &LoopStats::max);
+    py::class_<TaskStats>(m, "TaskStats")
+        .def_readonly("name", &TaskStats::name)
+        .def_readonly("period", &TaskStats::period)
+        .def_readonly("priority", &TaskStats::priority)
+        .def_readonly("count", &TaskStats::count)
+        .def_readonly("deferred_count", &TaskStats::deferred_count)
+        .def_readonly("last", &TaskStats::last)
+        .def_readonly("mean", &TaskStats::mean)
+        .def_readonly("max", &TaskStats::max);
+    py::class_<Diagnostics>(m, "Diagnostics")
+        .def_readonly("timestamp", &Diagnostics::timestamp)
+        .def_readonly("eef_pose", &Diagnostics::eef_pose)
+        .def_readonly("motor_temperature", &Diagnostics::motor_temperature);
+    py::enum_<TrajStatus>(m, "TrajStatus")
+        .value("RUNNING", TrajStatus::RUNNING)
+        .value("COMPLETED", TrajStatus::COMPLETED)
+        .value("OVERRIDDEN", TrajStatus::OVERRIDDEN);
+    py::class_<TrajProgress>(m, "TrajProgress")
+        .def_readonly("status", &TrajProgress::status)
+        .def_readonly("next_waypoint", &TrajProgress::next_waypoint)
+        .def_readonly("waypoint_num", &TrajProgress::waypoint_num)
+        .def_readonly("time_remaining", &TrajProgress::time_remaining)
+        .def_readonly("tracking_error_max", &TrajProgress::tracking_error_max)
+        .def_readonly("tracking_error_rms", &TrajProgress::tracking_error_rms);
+    // Waits in slices of 0.1s without the GIL, so that Ctrl-C and other Python threads are served
+    auto traj_wait = [](TrajHandle &handle, double timeout) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double>(timeout);
+        while (true)
+        {
+            double slice = 0.1;
+            if (timeout >= 0)
+                slice = std::min(
+                    slice, std::chrono::duration<double>(deadline - std::chrono::steady_clock::now()).count());
+            bool done;
+            {
+                py::gil_scoped_release release;
+                done = handle.wait(std::max(slice, 0.0));
+            }
+            if (done || (timeout >= 0 && std::chrono::steady_clock::now() >= deadline))
+                return done;
+            if (PyErr_CheckSignals() != 0)
+                throw py::error_already_set();
+        }
+    };
+    py::class_<TrajHandle, std::shared_ptr<TrajHandle>>(m, "TrajHandle")
+        .def("get_status", &TrajHandle::get_status)
+        .def("get_progress", &TrajHandle::get_progress)
+        .def("is_done", &TrajHandle::is_done)
+        .def("wait", traj_wait, py::arg("timeout") = -1.0)
+        .def("get_end_time", &TrajHandle::get_end_time)
+        .def("__await__", [traj_wait](std::shared_ptr<TrajHandle> handle) {
+            // Wait in the default executor of the running event loop, resolves to the final status
+            py::object loop = py::module::import("asyncio").attr("get_running_loop")();
+            py::cpp_function wait([traj_wait, handle]() {
+                traj_wait(*handle, -1.0);
+                return handle->get_status();
+            });
+            return loop.attr("run_in_executor")(py::none(), wait).attr("__await__")();
+        });
+    py::class_<IkSolverStats>(m, "IkSolverStats")
+        .def_readonly("name", &IkSolverStats::name)
+        .def_readonly("attempts", &IkSolverStats::attempts)
+        .def_readonly("successes", &IkSolverStats::successes)
+        .def_readonly("wins", &IkSolverStats::wins)
+        .def_readonly("avg_latency_ms", &IkSolverStats::avg_latency_ms)
+        .def_readonly("max_latency_ms", &IkSolverStats::max_latency_ms);
+    py::class_<Arx5IkPortfolio>(m, "Arx5IkPortfolio")
+        .def(py::init<const std::string &, int, Eigen::VectorXd, Eigen::VectorXd>())
+        .def(py::init<const std::string &, int, Eigen::VectorXd, Eigen::VectorXd, const std::string &,
+                      const std::string &, std::vector<std::string>>())
+        .def("inverse_kinematics",
+             py::overload_cast<Pose6d, Eigen::VectorXd, double>(&Arx5IkPortfolio::inverse_kinematics),
+             py::arg("target_pose_6d"), py::arg("current_joint_pos"), py::arg("timeout_s") = 0.005,
+             py::call_guard<py::gil_scoped_release>())
+        .def("inverse_kinematics",
+             py::overload_cast<PoseSE3, Eigen::VectorXd, double>(&Arx5IkPortfolio::inverse_kinematics),
+             py::arg("target_pose"), py::arg("current_joint_pos"), py::arg("timeout_s") = 0.005,
+             py::call_guard<py::gil_scoped_release>())
+        .def("get_stats", &Arx5IkPortfolio::get_stats)
+        .def("reset_stats", &Arx5IkPortfolio::reset_stats)
+        .def("get_solver_names", &Arx5IkPortfolio::get_solver_names);
+    py::class_<NullspaceIkWeights>(m, "NullspaceIkWeights")
+        .def(py::init<>())
+        .def(py::init<double, double, double>())
+        .def_readwrite("joint_limit", &NullspaceIkWeights::joint_limit)
+        .def_readwrite("manipulability", &NullspaceIkWeights::manipulability)
+        .def_readwrite("previous", &NullspaceIkWeights::previous);
+    py::class_<Arx5NullspaceIk>(m, "Arx5NullspaceIk")
+        .def(py::init<const std::string &, int, Eigen::VectorXd, Eigen::VectorXd>())
+        .def(py::init<const std::string &, int, Eigen::VectorXd, Eigen::VectorXd, const std::string &,
+                      const std::string &>())
+        .def("inverse_kinematics", py::overload_cast<Pose6d, Eigen::VectorXd>(&Arx5NullspaceIk::inverse_kinematics))
+        .def("inverse_kinematics", py::overload_cast<PoseSE3, Eigen::VectorXd>(&Arx5NullspaceIk::inverse_kinematics))
+        .def("manipulability", &Arx5NullspaceIk::manipulability)
+        .def("set_weights", &Arx5NullspaceIk::set_weights)
+        .def("get_weights", &Arx5NullspaceIk::get_weights);
+    py::class_<Arx5DifferentialIk>(m, "Arx5DifferentialIk")
+        .def(py::init<const std::string &, int, Eigen::VectorXd, Eigen::VectorXd>())
+        .def(py::init<const std::string &, int, Eigen::VectorXd, Eigen::VectorXd, const std::string &,
+                      const std::string &>())
+        .def("inverse_kinematics", &Arx5DifferentialIk::inverse_kinematics)
+        .def("forward_kinematics", &Arx5DifferentialIk::forward_kinematics);
+    py::class_<ReachabilityMap, std::shared_ptr<ReachabilityMap>>(m, "ReachabilityMap")
+        .def(py::init<const std::string &>())
+        .def("is_reachable", py::overload_cast<Pose6d>(&ReachabilityMap::is_reachable))
+        .def("is_reachable", py::overload_cast<PoseSE3>(&ReachabilityMap::is_reachable))
+        .def("get_seed",
+             [](ReachabilityMap &self, Pose6d pose_6d) {
+                 Eigen::VectorXd seed = Eigen::VectorXd::Zero(self.get_joint_dof());
+                 bool reachable = self.get_seed(pose_6d, seed);
+                 return std::make_tuple(reachable, seed);
+             })
+        .def("get_seed",
+             [](ReachabilityMap &self, PoseSE3 pose) {
+                 Eigen::VectorXd seed = Eigen::VectorXd::Zero(self.get_joint_dof());
+                 bool reachable = self.get_seed(pose, seed);
+                 return std::make_tuple(reachable, seed);
+             })
+        .def("get_joint_dof", &ReachabilityMap::get_joint_dof)
+        .def("get_path", &ReachabilityMap::get_path)
+        .def_static("generate", &ReachabilityMap::generate, py::arg("urdf_path"), py::arg("joint_dof"),
+                    py::arg("joint_pos_min"), py::arg("joint_pos_max"), py::arg("base_link"), py::arg("eef_link"),
+                    py::arg("output_path"), py::arg("voxel_size") = 0.03, py::arg("ori_resolution") = 2,
+                    py::arg("sample_num") = 2000000);
+    py::class_<Arx5LinkKinematics>(m, "Arx5LinkKinematics")
+        .def(py::init<const std::string &, int>())
+        .def(py::init<const std::string &, int, const std::string &, const std::string &>())
+        .def("link_transforms",
+             [](Arx5LinkKinematics &self, VecDoF joint_pos) {
+                 auto transforms = self.link_transforms(joint_pos);
+                 py::array_t<double> result(std::vector<py::ssize_t>{py::ssize_t(transforms.rows()), 4, 4});
+                 std::memcpy(result.mutable_data(), transforms.data(), transforms.size() * sizeof(double));
+                 return result;
+             })
+        .def("batch_link_transforms",
+             [](Arx5LinkKinematics &self, Eigen::MatrixXd joint_pos) {
+                 auto transforms = self.batch_link_transforms(joint_pos);
+                 py::array_t<double> result(std::vector<py::ssize_t>{py::ssize_t(joint_pos.rows()),
+                                                                     py::ssize_t(self.get_link_num()), 4, 4});
+                 std::memcpy(result.mutable_data(), transforms.data(), transforms.size() * sizeof(double));
+                 return result;
+             })
+        .def("forward_kinematics", &Arx5LinkKinematics::forward_kinematics)
+        .def("get_link_names", &Arx5LinkKinematics::get_link_names)
+        .def("get_link_num", &Arx5LinkKinematics::get_link_num)
+        .def("get_joint_dof", &Arx5LinkKinematics::get_joint_dof);
+    py::class_<CollisionCapsule>(m, "CollisionCapsule")
+        .def_readonly("link_name", &CollisionCapsule::link_name)
+        .def_readonly("p0", &CollisionCapsule::p0)
+        .def_readonly("p1", &CollisionCapsule::p1)
+        .def_readonly("radius", &CollisionCapsule::radius);
+    py::class_<CollisionResult>(m, "CollisionResult")
+        .def_readonly("distance", &CollisionResult::distance)
+        .def_readonly("link_a", &CollisionResult::link_a)
+        .def_readonly("link_b", &CollisionResult::link_b)
+        .def_readonly("point_a", &CollisionResult::point_a)
+        .def_readonly("point_b", &CollisionResult::point_b);
+    py::class_<Arx5CollisionChecker, std::shared_ptr<Arx5CollisionChecker>>(m, "Arx5CollisionChecker")
+        .def(py::init<const std::string &, int>())
+        .def(py::init<const std::string &, int, const std::string &, const std::string &>())
+        .def("self_distance", &Arx5CollisionChecker::self_distance)
+        .def("inter_arm_distance", &Arx5CollisionChecker::inter_arm_distance)
+        .def("validate_trajectory", &Arx5CollisionChecker::validate_trajectory, py::arg("joint_traj"),
+             py::arg("min_distance") = 0.0, py::arg("max_joint_step") = 0.05)
+        .def("validate_dual_trajectory", &Arx5CollisionChecker::validate_dual_trajectory, py::arg("joint_traj"),
+             py::arg("other"), py::arg("other_base_pose"), py::arg("other_joint_traj"), py::arg("min_distance") = 0.0,
+             py::arg("max_joint_step") = 0.05)
+        .def("get_capsules", &Arx5CollisionChecker::get_capsules)
+        .def("get_excluded_pairs", &Arx5CollisionChecker::get_excluded_pairs)
+        .def("set_pair_excluded", &Arx5CollisionChecker::set_pair_excluded);
     py::class_<RobotConfig>(m, "RobotConfig")
         .def_readwrite("robot_model", &RobotConfig::robot_model)
         .def_readwrite("joint_pos_min", &RobotConfig::joint_pos_min)
@@ -123,7 +616,8 @@ PYBIND11_MODULE(arx5_interface, m)
         .def_readwrite("gravity_vector", &RobotConfig::gravity_vector)
         .def_readwrite("base_link_name", &RobotConfig::base_link_name)
         .def_readwrite("eef_link_name", &RobotConfig::eef_link_name)
-        .def_readwrite("urdf_path", &RobotConfig::urdf_path);
+        .def_readwrite("urdf_path", &RobotConfig::urdf_path)
+        .def_readwrite("reachability_map_path", &RobotConfig::reachability_map_path);
 
     py::class_<ControllerConfig>(m, "ControllerConfig")
         .def_readwrite("controller_type", &ControllerConfig::controller_type)
@@ -137,7 +631,56 @@ PYBIND11_MODULE(arx5_interface, m)
         .def_readwrite("shutdown_to_passive", &ControllerConfig::shutdown_to_passive)
         .def_readwrite("interpolation_method", &ControllerConfig::interpolation_method)
         .def_readwrite("default_preview_time", &ControllerConfig::default_preview_time)
+        .def_readwrite("override_blend_time", &ControllerConfig::override_blend_time)
+        .def_readwrite("command_clock", &ControllerConfig::command_clock)
+        .def_readwrite("traj_vel_method", &ControllerConfig::traj_vel_method)
+        .def_readwrite("estimator_pos_noise", &ControllerConfig::estimator_pos_noise)
+        .def_readwrite("estimator_vel_noise", &ControllerConfig::estimator_vel_noise)
+        .def_readwrite("estimator_jerk_noise", &ControllerConfig::estimator_jerk_noise)
+        .def_readwrite("ik_method", &ControllerConfig::ik_method)
+        .def_readwrite("ik_timeout", &ControllerConfig::ik_timeout)
+        .def_readwrite("reachability_reject", &ControllerConfig::reachability_reject)
+        .def_readwrite("eef_interpolation", &ControllerConfig::eef_interpolation)
+        .def_readwrite("joint_acc_max", &ControllerConfig::joint_acc_max)
+        .def_readwrite("eef_twist_lin_acc_max", &ControllerConfig::eef_twist_lin_acc_max)
+        .def_readwrite("eef_twist_ang_acc_max", &ControllerConfig::eef_twist_ang_acc_max)
+        .def_readwrite("joint_torque_timeout", &ControllerConfig::joint_torque_timeout)
+        .def_readwrite("chunk_ensemble_decay", &ControllerConfig::chunk_ensemble_decay)
+        .def_readwrite("chunk_fade_time", &ControllerConfig::chunk_fade_time)
+        .def_readwrite("chunk_max_num", &ControllerConfig::chunk_max_num)
+        .def_readwrite("collision_check", &ControllerConfig::collision_check)
+        .def_readwrite("collision_min_distance", &ControllerConfig::collision_min_distance)
+        .def_readwrite("contact_detection", &ControllerConfig::contact_detection)
+        .def_readwrite("momentum_observer_gain", &ControllerConfig::momentum_observer_gain)
+        .def_readwrite("contact_torque_threshold", &ControllerConfig::contact_torque_threshold)
+        .def_readwrite("contact_reaction", &ControllerConfig::contact_reaction)
+        .def_readwrite("contact_retract_distance", &ControllerConfig::contact_retract_distance)
+        .def_readwrite("contact_retract_time", &ControllerConfig::contact_retract_time)
+        .def_readwrite("grasp_contact_vel", &ControllerConfig::grasp_contact_vel)
+        .def_readwrite("grasp_contact_ratio", &ControllerConfig::grasp_contact_ratio)
+        .def_readwrite("grasp_contact_time", &ControllerConfig::grasp_contact_time)
+        .def_readwrite("grasp_min_width", &ControllerConfig::grasp_min_width)
+        .def_readwrite("grasp_slip_distance", &ControllerConfig::grasp_slip_distance)
+        .def_readwrite("load_shedding_max_level", &ControllerConfig::load_shedding_max_level)
+        .def_readwrite("overrun_tolerance", &ControllerConfig::overrun_tolerance)
+        .def_readwrite("overrun_escalate_cnt", &ControllerConfig::overrun_escalate_cnt)
+        .def_readwrite("overrun_recover_cnt", &ControllerConfig::overrun_recover_cnt)
+        .def_readwrite("gravity_comp_period", &ControllerConfig::gravity_comp_period)
+        .def_readwrite("diagnostics_period", &ControllerConfig::diagnostics_period)
+        .def_readwrite("task_budget_ratio", &ControllerConfig::task_budget_ratio)
         .def_readwrite("controller_dt", &ControllerConfig::controller_dt);
+    py::class_<TeleopConfig>(m, "TeleopConfig")
+        .def(py::init<int>())
+        .def_readwrite("joint_scale", &TeleopConfig::joint_scale)
+        .def_readwrite("joint_offset", &TeleopConfig::joint_offset)
+        .def_readwrite("vel_feedforward", &TeleopConfig::vel_feedforward)
+        .def_readwrite("gripper_scale", &TeleopConfig::gripper_scale)
+        .def_readwrite("gripper_offset", &TeleopConfig::gripper_offset)
+        .def_readwrite("leader_state_timeout", &TeleopConfig::leader_state_timeout)
+        .def_readwrite("force_feedback_scale", &TeleopConfig::force_feedback_scale)
+        .def_readwrite("gripper_force_feedback_scale", &TeleopConfig::gripper_force_feedback_scale)
+        .def_readwrite("force_feedback_damping_max", &TeleopConfig::force_feedback_damping_max)
+        .def_readwrite("force_feedback_energy_max", &TeleopConfig::force_feedback_energy_max);
     py::class_<RobotConfigFactory>(m, "RobotConfigFactory")
         .def_static("get_instance", &RobotConfigFactory::get_instance, py::return_value_policy::reference)
         .def("get_config", &RobotConfigFactory::get_config);
@@ -25,7 +25,6 @@ def main(master_model: str, master_interface: str, slave_model: str, slave_inter
     slave = arx5.Arx5JointController(slave_model, slave_interface)
     robot_config = master.get_robot_config()
     assert robot_config.joint_dof == slave.get_robot_config().joint_dof
-    controller_config = master.get_controller_config()
 
     master.reset_to_home()
     slave.reset_to_home()
@@ -33,22 +32,21 @@ def main(master_model: str, master_interface: str, slave_model: str, slave_inter
     gain = arx5.Gain(robot_config.joint_dof)
     gain.kd()[:] = 0.01
     master.set_gain(gain)
+    # The slave mirrors the master inside its own control loop (controller_dt), no python loop is needed
+    teleop_config = arx5.TeleopConfig(robot_config.joint_dof)
+    # If you want to decrease the delay of teleoperation, you can increase vel_feedforward (e.g. 0.3).
+    # This will partially include the master velocity in the command of the slave.
+    teleop_config.vel_feedforward = 0.0
+    # Set these to feel the contacts of the slave on the master (bilateral teleoperation), e.g. 0.3
+    teleop_config.force_feedback_scale = 0.0
+    teleop_config.gripper_force_feedback_scale = 0.0
+    slave.set_teleop_leader(master, teleop_config)
     try:
         while True:
-            master_joint_state = master.get_joint_state()
-            slave_joint_cmd = arx5.JointState(robot_config.joint_dof)
-            slave_joint_cmd.pos()[:] = master_joint_state.pos()
-            slave_joint_cmd.gripper_pos = master_joint_state.gripper_pos
-            
-            # If you want to decrease the delay of teleoperation , you can uncomment the following line
-            # This will partially include the velocity to the command, and you will need to pass these velocities
-            # into the policy layout
-            # slave_joint_cmd.vel()[:] = master_joint_state.vel()* 0.3 
-            
-            slave.set_joint_cmd(slave_joint_cmd)
-            time.sleep(controller_config.controller_dt)
+            time.sleep(1.0)
     except KeyboardInterrupt:
         print("\nKeyboard interrupt detected. Resetting arms to home position...")
+        slave.set_teleop_leader(None, teleop_config)
         slave.reset_to_home()
         master.reset_to_home()
         print("Arms reset to home position. Exiting.")
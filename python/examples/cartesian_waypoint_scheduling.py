@@ -69,13 +69,10 @@ def main(model: str, interface: str):
         eef_cmd = arx5.EEFState(waypoint, 0.0)
         eef_cmd.timestamp = current_timestamp + interpolate_interval_s * (k + 1)
         eef_traj.append(eef_cmd)
-    controller.set_eef_traj(eef_traj)
+    traj_handle = controller.set_eef_traj(eef_traj)
     pose_error = np.zeros(6)
     pose_error_cnt = 0
-    current_time = time.time()
-    while time.time() < current_time + interpolate_interval_s * len(
-        interpolated_waypoints
-    ):
+    while not traj_handle.is_done():
         # You can do whatever you want here while the robot is moving
         eef_state = controller.get_eef_state()
         eef_cmd = controller.get_eef_cmd()
@@ -39,8 +39,12 @@ def main(model: str, interface: str):
         joint_traj[-1].timestamp = init_timestamp + waypoint_interval_s * len(
             joint_traj
         )
-    controller.set_joint_traj(joint_traj)
-    time.sleep(waypoint_interval_s * len(joint_traj))
+    traj_handle = controller.set_joint_traj(joint_traj)
+    traj_handle.wait()
+    progress = traj_handle.get_progress()
+    print(
+        f"Trajectory {progress.status}, tracking error max: {progress.tracking_error_max:.4f} rad"
+    )
 
     time.sleep(1.0)
     controller.reset_to_home()
@@ -15,6 +15,55 @@ Arx5CartesianController::Arx5CartesianController(RobotConfig robot_config, Contr
     if (!controller_config.background_send_recv)
         throw std::runtime_error(
             "controller_config.background_send_recv should be set to true when running cartesian controller.");
+    if (controller_config_.ik_method == "portfolio")
+    {
+        ik_portfolio_ = std::make_shared<Arx5IkPortfolio>(robot_config_.urdf_path, robot_config_.joint_dof,
+                                                          robot_config_.joint_pos_min, robot_config_.joint_pos_max,
+                                                          robot_config_.base_link_name, robot_config_.eef_link_name);
+    }
+    else if (controller_config_.ik_method == "nullspace")
+    {
+        nullspace_ik_ = std::make_shared<Arx5NullspaceIk>(robot_config_.urdf_path, robot_config_.joint_dof,
+                                                          robot_config_.joint_pos_min, robot_config_.joint_pos_max,
+                                                          robot_config_.base_link_name, robot_config_.eef_link_name);
+    }
+    else if (controller_config_.ik_method != "multi_trial")
+    {
+        throw std::invalid_argument("Invalid ik method: " + controller_config_.ik_method +
+                                    ". Currently available: 'multi_trial', 'portfolio' or 'nullspace'");
+    }
+    if (controller_config_.eef_interpolation != "joint" && controller_config_.eef_interpolation != "cartesian")
+    {
+        throw std::invalid_argument("Invalid eef interpolation: " + controller_config_.eef_interpolation +
+                                    ". Currently available: 'joint' or 'cartesian'");
+    }
+    {
+        // Also used by set_eef_twist, whatever the eef interpolation is
+        std::lock_guard<std::mutex> guard(cmd_mutex_);
+        differential_ik_ = std::make_shared<Arx5DifferentialIk>(
+            robot_config_.urdf_path, robot_config_.joint_dof, robot_config_.joint_pos_min, robot_config_.joint_pos_max,
+            robot_config_.base_link_name, robot_config_.eef_link_name);
+    }
+    if (!robot_config_.reachability_map_path.empty())
+    {
+        if (access(robot_config_.reachability_map_path.c_str(), R_OK) == 0)
+        {
+            reachability_map_ = std::make_shared<ReachabilityMap>(robot_config_.reachability_map_path);
+            if (reachability_map_->get_joint_dof() != robot_config_.joint_dof)
+            {
+                logger_->warn("Reachability map {} does not match the robot dof and is ignored",
+                              robot_config_.reachability_map_path);
+                reachability_map_.reset();
+            }
+            else
+                logger_->info("Reachability map loaded from {}", robot_config_.reachability_map_path);
+        }
+        else
+        {
+            logger_->info("Reachability map {} not found. Run `make reachability_maps` to generate it.",
+                          robot_config_.reachability_map_path);
+        }
+    }
 }
 
 Arx5CartesianController::Arx5CartesianController(std::string model, std::string interface_name)
@@ -28,18 +77,47 @@ Arx5CartesianController::Arx5CartesianController(std::string model, std::string
 
 void Arx5CartesianController::set_eef_cmd(EEFState new_cmd)
 {
+    set_eef_cmd_(EEFStateSE3(new_cmd), new_cmd.pose_6d);
+}
+
+void Arx5CartesianController::set_eef_cmd(EEFStateSE3 new_cmd)
+{
+    set_eef_cmd_(new_cmd, new_cmd.pose.to_pose_6d());
+}
+
+void Arx5CartesianController::set_eef_cmd_(EEFStateSE3 new_cmd, const Pose6d &target_pose_6d)
+{
+    new_cmd.timestamp = to_controller_time_(new_cmd.timestamp);
+    if (controller_config_.reachability_reject && !is_reachable(new_cmd.pose))
+    {
+        logger_->warn("Target pose {} is out of the reachability map, command is ignored",
+                      vec2str(new_cmd.pose.to_pose_6d()));
+        event_bus_->publish(EventType::UNREACHABLE, get_timestamp(), -1, new_cmd.timestamp);
+        return;
+    }
+    if (new_cmd.timestamp == 0)
+        new_cmd.timestamp = get_timestamp() + controller_config_.default_preview_time;
+    if (controller_config_.eef_interpolation == "cartesian")
+    {
+        // IK runs in the control loop
+        double current_time = get_timestamp();
+        std::lock_guard<std::mutex> guard(cmd_mutex_);
+        restart_eef_interpolation_(current_time);
+        if (new_cmd.timestamp > current_time)
+            eef_interpolator_.override_waypoint(current_time, new_cmd);
+        else
+            eef_interpolator_.init_fixed(new_cmd); // The speed limit still applies
+        return;
+    }
     JointState current_joint_state = get_joint_state();
 
     // The following line only works under c++17
     // auto [success, target_joint_pos] = solver_->inverse_kinematics(new_cmd.pose_6d, current_joint_state.pos);
 
     std::tuple<int, VecDoF> ik_results;
-    ik_results = multi_trial_ik(new_cmd.pose_6d, joint_state_.pos);
+    ik_results = solve_ik_(new_cmd.pose, target_pose_6d, current_joint_state.pos);
     int ik_status = std::get<0>(ik_results);
 
-    if (new_cmd.timestamp == 0)
-        new_cmd.timestamp = get_timestamp() + controller_config_.default_preview_time;
-
     JointState target_joint_state{robot_config_.joint_dof};
     target_joint_state.pos = std::get<1>(ik_results);
     target_joint_state.gripper_pos = new_cmd.gripper_pos;
@@ -48,65 +126,180 @@ void Arx5CartesianController::set_eef_cmd(EEFState new_cmd)
     double current_time = get_timestamp();
     // TODO: include velocity
     std::lock_guard<std::mutex> guard(cmd_mutex_);
+    resume_interpolator_();
     interpolator_.override_waypoint(get_timestamp(), target_joint_state);
 
     if (ik_status != 0)
     {
         logger_->warn("Inverse kinematics failed: {} ({})", solver_->get_ik_status_name(ik_status), ik_status);
+        event_bus_->publish(EventType::IK_FAILURE, current_time, -1, ik_status);
     }
 }
 
-void Arx5CartesianController::set_eef_traj(std::vector<EEFState> new_traj)
+std::shared_ptr<TrajHandle> Arx5CartesianController::set_eef_traj(std::vector<EEFState> new_traj)
 {
+    std::vector<EEFStateSE3> new_traj_se3(new_traj.begin(), new_traj.end());
+    Eigen::MatrixXd target_poses_6d(new_traj.size(), 6);
+    for (int i = 0; i < int(new_traj.size()); i++)
+        target_poses_6d.row(i) = new_traj[i].pose_6d.transpose();
+    return set_eef_traj_(new_traj_se3, target_poses_6d);
+}
+
+std::shared_ptr<TrajHandle> Arx5CartesianController::set_eef_traj(const EEFTrajectory &new_traj)
+{
+    new_traj.check();
+    std::vector<EEFStateSE3> new_traj_se3;
+    new_traj_se3.reserve(new_traj.size());
+    for (int i = 0; i < new_traj.size(); i++)
+        new_traj_se3.push_back(new_traj.get_state(i));
+    return set_eef_traj_(new_traj_se3, new_traj.pose_6d);
+}
+
+std::shared_ptr<TrajHandle> Arx5CartesianController::set_eef_traj(std::vector<EEFStateSE3> new_traj)
+{
+    Eigen::MatrixXd target_poses_6d(new_traj.size(), 6);
+    for (int i = 0; i < int(new_traj.size()); i++)
+        target_poses_6d.row(i) = new_traj[i].pose.to_pose_6d().transpose();
+    return set_eef_traj_(new_traj, target_poses_6d);
+}
+
+std::shared_ptr<TrajHandle> Arx5CartesianController::set_eef_traj_(std::vector<EEFStateSE3> new_traj,
+                                                                   const Eigen::MatrixXd &target_poses_6d)
+{
+    for (auto &eef_state : new_traj)
+        eef_state.timestamp = to_controller_time_(eef_state.timestamp);
     double start_time = get_timestamp();
-    std::vector<JointState> joint_traj;
+    if (controller_config_.eef_interpolation == "cartesian")
+    {
+        std::vector<EEFStateSE3> eef_traj;
+        double prev_timestamp = 0;
+        int unreachable_cnt = 0;
+        for (auto eef_state : new_traj)
+        {
+            if (eef_state.timestamp <= start_time)
+                continue;
+            if (eef_state.timestamp <= prev_timestamp)
+                throw std::invalid_argument("EEFState timestamps must be in ascending order");
+            if (controller_config_.reachability_reject && !is_reachable(eef_state.pose))
+            {
+                unreachable_cnt++;
+                event_bus_->publish(EventType::UNREACHABLE, start_time, -1, eef_state.timestamp);
+                continue;
+            }
+            eef_traj.push_back(eef_state);
+            prev_timestamp = eef_state.timestamp;
+        }
+        if (unreachable_cnt > 0)
+            logger_->warn("{} waypoints are out of the reachability map and skipped", unreachable_cnt);
+        std::vector<double> waypoint_times;
+        for (const EEFStateSE3 &eef_state : eef_traj)
+            waypoint_times.push_back(eef_state.timestamp);
+        std::shared_ptr<TrajHandle> handle = std::make_shared<TrajHandle>(waypoint_times);
+        if (eef_traj.empty())
+        {
+            handle->finish(TrajStatus::COMPLETED); // Nothing to do, the current command is kept
+            return handle;
+        }
+        double current_time = get_timestamp();
+        std::lock_guard<std::mutex> guard(cmd_mutex_);
+        restart_eef_interpolation_(current_time);
+        eef_interpolator_.override_traj(current_time, eef_traj);
+        start_traj_handle_(handle, true);
+        return handle;
+    }
+    {
+        std::lock_guard<std::mutex> guard(cmd_mutex_);
+        resume_interpolator_();
+    }
+    // The IK results are written in place, the rows of the skipped waypoints are dropped at the end
     double avg_window_s = 0.05;
-    joint_traj.push_back(interpolator_.interpolate(start_time - 2 * avg_window_s));
-    joint_traj.push_back(interpolator_.interpolate(start_time - avg_window_s));
-    joint_traj.push_back(interpolator_.interpolate(start_time));
+    JointTrajectory joint_traj{robot_config_.joint_dof, 3 + int(new_traj.size())};
+    joint_traj.set_state(0, interpolator_.interpolate(start_time - 2 * avg_window_s));
+    joint_traj.set_state(1, interpolator_.interpolate(start_time - avg_window_s));
+    joint_traj.set_state(2, interpolator_.interpolate(start_time));
 
+    int waypoint_num = 3;
     double prev_timestamp = 0;
-    for (auto eef_state : new_traj)
+    VecDoF prev_joint_pos = get_joint_state().pos;
+    int unreachable_cnt = 0;
+    for (int i = 0; i < int(new_traj.size()); i++)
     {
+        EEFStateSE3 eef_state = new_traj[i];
         if (eef_state.timestamp <= start_time)
             continue;
         if (eef_state.timestamp == 0)
             throw std::invalid_argument("EEFState timestamp must be set for all waypoints");
         if (eef_state.timestamp <= prev_timestamp)
             throw std::invalid_argument("EEFState timestamps must be in ascending order");
+        // Skip the full multi-trial IK for waypoints that are out of the map
+        if (controller_config_.reachability_reject && !is_reachable(eef_state.pose))
+        {
+            unreachable_cnt++;
+            event_bus_->publish(EventType::UNREACHABLE, start_time, -1, eef_state.timestamp);
+            continue;
+        }
         JointState current_joint_state = get_joint_state();
         std::tuple<int, VecDoF> ik_results;
-        ik_results = multi_trial_ik(eef_state.pose_6d, current_joint_state.pos);
+        // The nullspace IK stays close to its reference, so chain the waypoints to keep the redundancy continuous
+        Pose6d target_pose_6d = target_poses_6d.row(i).transpose();
+        if (nullspace_ik_ != nullptr)
+            ik_results = solve_ik_(eef_state.pose, target_pose_6d, prev_joint_pos);
+        else
+            ik_results = solve_ik_(eef_state.pose, target_pose_6d, current_joint_state.pos);
         int ik_status = std::get<0>(ik_results);
 
-        JointState target_joint_state{robot_config_.joint_dof};
-        target_joint_state.pos = std::get<1>(ik_results);
-        target_joint_state.gripper_pos = eef_state.gripper_pos;
-        target_joint_state.timestamp = eef_state.timestamp;
-
-        joint_traj.push_back(target_joint_state);
+        joint_traj.timestamps[waypoint_num] = eef_state.timestamp;
+        joint_traj.pos.row(waypoint_num) = std::get<1>(ik_results).transpose();
+        joint_traj.gripper_pos[waypoint_num] = eef_state.gripper_pos;
+        waypoint_num++;
         prev_timestamp = eef_state.timestamp;
+        prev_joint_pos = std::get<1>(ik_results);
 
         if (ik_status != 0)
         {
             logger_->warn("Inverse kinematics failed: {} ({})", solver_->get_ik_status_name(ik_status), ik_status);
+            event_bus_->publish(EventType::IK_FAILURE, get_timestamp(), -1, ik_status);
         }
     }
 
+    if (unreachable_cnt > 0)
+        logger_->warn("{} waypoints are out of the reachability map and skipped", unreachable_cnt);
+
     double ik_end_time = get_timestamp();
+    joint_traj.resize(waypoint_num);
+    std::shared_ptr<TrajHandle> handle = std::make_shared<TrajHandle>(
+        std::vector<double>(joint_traj.timestamps.data() + 3, joint_traj.timestamps.data() + waypoint_num));
 
     // Include velocity: first and last point based on current state, others based on neighboring points
-    calc_joint_vel(joint_traj, avg_window_s);
+    calc_traj_vel_(joint_traj, 2, avg_window_s);
 
     double current_time = get_timestamp();
     std::lock_guard<std::mutex> guard(cmd_mutex_);
 
     interpolator_.override_traj(current_time, joint_traj);
+    start_traj_handle_(handle, false);
 
     double end_override_traj_time = get_timestamp();
     // logger_->debug("IK time: {:.3f}ms, calc vel time: {:.3f}ms, override_traj time: {:.3f}ms",
     //                (ik_end_time - start_time) * 1000, (current_time - ik_end_time) * 1000,
     //                (end_override_traj_time - ik_end_time) * 1000);
+    return handle;
+}
+
+void Arx5CartesianController::set_eef_twist(Pose6d twist, double timeout, double gripper_vel)
+{
+    if (timeout <= 0)
+        throw std::invalid_argument("Twist timeout must be positive");
+    double current_time = get_timestamp();
+    std::lock_guard<std::mutex> guard(cmd_mutex_);
+    // Another command source may have taken over since the last twist (e.g. a joint space eef command)
+    if (!eef_twist_active_ || cmd_source_ != CmdSource::EEF)
+        restart_eef_interpolation_(current_time);
+    eef_twist_active_ = true;
+    eef_twist_ = twist;
+    eef_twist_gripper_vel_ =
+        std::max(-robot_config_.gripper_vel_max, std::min(robot_config_.gripper_vel_max, gripper_vel));
+    eef_twist_deadline_ = current_time + timeout;
 }
 
 EEFState Arx5CartesianController::get_eef_cmd()
@@ -119,6 +312,16 @@ EEFState Arx5CartesianController::get_eef_cmd()
     return eef_cmd;
 }
 
+EEFStateSE3 Arx5CartesianController::get_eef_cmd_se3()
+{
+    JointState joint_cmd = get_joint_cmd();
+    EEFStateSE3 eef_cmd;
+    eef_cmd.pose = forward_kinematics_se3_(joint_cmd.pos);
+    eef_cmd.gripper_pos = joint_cmd.gripper_pos;
+    eef_cmd.timestamp = joint_cmd.timestamp;
+    return eef_cmd;
+}
+
 std::tuple<int, Eigen::VectorXd> Arx5CartesianController::multi_trial_ik(Eigen::Matrix<double, 6, 1> target_pose_6d,
                                                                          Eigen::VectorXd current_joint_pos,
                                                                          int additional_trial_num)
@@ -144,6 +347,11 @@ std::tuple<int, Eigen::VectorXd> Arx5CartesianController::multi_trial_ik(Eigen::
                                                      (robot_config_.joint_pos_max[j] - robot_config_.joint_pos_min[j]);
         }
     }
+    // Replace the first random trial with the seed stored in the reachability map
+    Eigen::VectorXd map_seed;
+    if (additional_trial_num > 0 && reachability_map_ != nullptr &&
+        reachability_map_->get_seed(target_pose_6d, map_seed))
+        init_joint_positions.row(2) = map_seed;
     Eigen::MatrixXd target_joint_positions = Eigen::MatrixXd::Zero(additional_trial_num + 2, robot_config_.joint_dof);
     std::vector<int> all_ik_status(additional_trial_num + 2, 0);
     std::vector<double> distances(additional_trial_num + 2, 100000); // L2 distances, initialize to infinity
@@ -177,3 +385,57 @@ std::tuple<int, Eigen::VectorXd> Arx5CartesianController::multi_trial_ik(Eigen::
     }
     return std::make_tuple(min_ik_status, min_target_joint_pos);
 }
+
+std::vector<IkSolverStats> Arx5CartesianController::get_ik_portfolio_stats()
+{
+    if (ik_portfolio_ == nullptr)
+        return std::vector<IkSolverStats>();
+    return ik_portfolio_->get_stats();
+}
+
+std::tuple<int, Eigen::VectorXd> Arx5CartesianController::solve_ik_(const PoseSE3 &target_pose,
+                                                                    const Pose6d &target_pose_6d,
+                                                                    Eigen::VectorXd current_joint_pos)
+{
+    if (ik_portfolio_ != nullptr)
+        return ik_portfolio_->inverse_kinematics(target_pose, current_joint_pos, controller_config_.ik_timeout);
+    if (nullspace_ik_ != nullptr)
+    {
+        std::tuple<int, Eigen::VectorXd> result = nullspace_ik_->inverse_kinematics(target_pose, current_joint_pos);
+        if (std::get<0>(result) == 0)
+            return result;
+        // Only fall back to random restarts if the single solve fails
+        return multi_trial_ik(target_pose_6d, current_joint_pos);
+    }
+    // Arx5Solver only takes Pose6d
+    return multi_trial_ik(target_pose_6d, current_joint_pos);
+}
+
+void Arx5CartesianController::restart_eef_interpolation_(double current_time)
+{
+    // eef_cmd_ may lag behind the interpolated pose because of ee_vel_max, so always restart from it
+    if (cmd_source_ != CmdSource::EEF)
+    {
+        eef_cmd_.pose = differential_ik_->forward_kinematics(output_joint_cmd_.pos);
+        eef_cmd_.gripper_pos = output_joint_cmd_.gripper_pos;
+        cmd_source_ = CmdSource::EEF;
+    }
+    eef_twist_active_ = false;
+    eef_twist_vel_ = Pose6d::Zero();
+    eef_cmd_.timestamp = current_time;
+    eef_interpolator_.init_fixed(eef_cmd_);
+}
+
+bool Arx5CartesianController::is_reachable(Pose6d pose_6d)
+{
+    if (reachability_map_ == nullptr)
+        return true;
+    return reachability_map_->is_reachable(pose_6d);
+}
+
+bool Arx5CartesianController::is_reachable(PoseSE3 pose)
+{
+    if (reachability_map_ == nullptr)
+        return true;
+    return reachability_map_->is_reachable(pose);
+}
@@ -0,0 +1,112 @@
+#include "app/clock_domain.h"
+#include <algorithm>
+#include <stdexcept>
+#include <time.h>
+
+namespace arx
+{
+
+namespace
+{
+double clock_seconds(clockid_t clock_id)
+{
+    timespec ts;
+    clock_gettime(clock_id, &ts);
+    return double(ts.tv_sec) + double(ts.tv_nsec) / 1e9;
+}
+
+// Offset of `clock_id` to CLOCK_MONOTONIC. The clock is read between two monotonic reads, and the tightest of a few
+// brackets is kept so that a preemption in between does not bias the offset.
+double clock_offset(clockid_t clock_id)
+{
+    double best_width = 1e9;
+    double best_offset = 0.0;
+    for (int i = 0; i < 3; i++)
+    {
+        double before = clock_seconds(CLOCK_MONOTONIC);
+        double time = clock_seconds(clock_id);
+        double after = clock_seconds(CLOCK_MONOTONIC);
+        if (after - before < best_width)
+        {
+            best_width = after - before;
+            best_offset = time - (before + after) / 2;
+        }
+    }
+    return best_offset;
+}
+} // namespace
+
+ClockDomain::ClockDomain(long int start_time_us) : start_time_us_(start_time_us)
+{
+}
+
+void ClockDomain::check_clock(std::string clock)
+{
+    if (clock != "controller" && clock != "monotonic" && clock != "realtime" && clock != "tai")
+        throw std::invalid_argument("Invalid clock: " + clock +
+                                    ". Currently available: 'controller', 'monotonic', 'realtime' or 'tai'");
+}
+
+double ClockDomain::get_epoch(std::string clock)
+{
+    check_clock(clock);
+    if (clock == "controller")
+        return 0.0;
+    // get_time_us() reads std::chrono::steady_clock, which is CLOCK_MONOTONIC on Linux
+    double monotonic_epoch = double(start_time_us_) / 1e6;
+    if (clock == "monotonic")
+        return monotonic_epoch;
+    return monotonic_epoch + clock_offset(clock == "realtime" ? CLOCK_REALTIME : CLOCK_TAI);
+}
+
+double ClockDomain::now(std::string clock)
+{
+    check_clock(clock);
+    if (clock == "realtime")
+        return clock_seconds(CLOCK_REALTIME);
+    if (clock == "tai")
+        return clock_seconds(CLOCK_TAI);
+    return clock_seconds(CLOCK_MONOTONIC) - get_epoch("monotonic") + get_epoch(clock);
+}
+
+double ClockDomain::to_controller_time(double time, std::string clock)
+{
+    return time - get_epoch(clock);
+}
+
+double ClockDomain::from_controller_time(double controller_time, std::string clock)
+{
+    return controller_time + get_epoch(clock);
+}
+
+void ClockDomain::record_latency(double client_time, std::string clock)
+{
+    double latency = now(clock) - client_time;
+    std::lock_guard<std::mutex> guard(latency_mutex_);
+    if (latency_stats_.count == 0)
+    {
+        latency_stats_.mean = latency;
+        latency_stats_.max = latency;
+    }
+    else
+    {
+        latency_stats_.mean = (1 - LATENCY_EMA_ALPHA_) * latency_stats_.mean + LATENCY_EMA_ALPHA_ * latency;
+        latency_stats_.max = std::max(latency_stats_.max, latency);
+    }
+    latency_stats_.last = latency;
+    latency_stats_.count++;
+}
+
+LatencyStats ClockDomain::get_latency_stats()
+{
+    std::lock_guard<std::mutex> guard(latency_mutex_);
+    return latency_stats_;
+}
+
+void ClockDomain::reset_latency_stats()
+{
+    std::lock_guard<std::mutex> guard(latency_mutex_);
+    latency_stats_ = LatencyStats();
+}
+
+} // namespace arx
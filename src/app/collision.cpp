@@ -0,0 +1,616 @@
+#include "app/collision.h"
+#include "app/kdl_utils.h"
+#include <urdf_parser/urdf_parser.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+namespace arx
+{
+
+namespace
+{
+const double INF = std::numeric_limits<double>::infinity();
+
+std::string read_file(const std::string &path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return "";
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    return buffer.str();
+}
+
+// Transform of the origin of a visual/collision element
+Eigen::Isometry3d element_origin(const urdf::Pose &pose)
+{
+    Eigen::Isometry3d origin = Eigen::Isometry3d::Identity();
+    origin.translate(Eigen::Vector3d(pose.position.x, pose.position.y, pose.position.z));
+    origin.rotate(Eigen::Quaterniond(pose.rotation.w, pose.rotation.x, pose.rotation.y, pose.rotation.z));
+    return origin;
+}
+
+// "package://pkg/meshes/a.STL" and "./meshes/a.STL" are both resolved relative to the urdf directory.
+// The package name is dropped if the path with it does not exist.
+std::string resolve_mesh_path(const std::string &filename, const std::string &urdf_dir)
+{
+    std::vector<std::string> candidates;
+    if (filename.compare(0, 10, "package://") == 0)
+    {
+        std::string relative = filename.substr(10);
+        candidates.push_back(urdf_dir + "/" + relative);
+        size_t slash = relative.find('/');
+        if (slash != std::string::npos)
+            candidates.push_back(urdf_dir + "/" + relative.substr(slash + 1));
+    }
+    else if (!filename.empty() && filename[0] == '/')
+        candidates.push_back(filename);
+    else
+        candidates.push_back(urdf_dir + "/" + filename);
+    for (const std::string &candidate : candidates)
+    {
+        if (std::ifstream(candidate).good())
+            return candidate;
+    }
+    return "";
+}
+
+// Vertices of a binary or ASCII STL file, empty if the file cannot be read
+std::vector<Eigen::Vector3d> load_stl_vertices(const std::string &path)
+{
+    std::vector<Eigen::Vector3d> vertices;
+    std::string data = read_file(path);
+    if (data.size() >= 84)
+    {
+        uint32_t triangle_num;
+        std::memcpy(&triangle_num, data.data() + 80, sizeof(triangle_num));
+        if (data.size() == 84 + size_t(triangle_num) * 50)
+        {
+            vertices.reserve(triangle_num * 3);
+            for (uint32_t i = 0; i < triangle_num; i++)
+            {
+                // 12 bytes normal, 3 * 12 bytes vertices, 2 bytes attribute
+                const char *triangle = data.data() + 84 + size_t(i) * 50 + 12;
+                for (int v = 0; v < 3; v++)
+                {
+                    float xyz[3];
+                    std::memcpy(xyz, triangle + v * 12, sizeof(xyz));
+                    vertices.emplace_back(xyz[0], xyz[1], xyz[2]);
+                }
+            }
+            return vertices;
+        }
+    }
+    // ASCII: "vertex x y z"
+    std::istringstream stream(data);
+    std::string token;
+    while (stream >> token)
+    {
+        if (token != "vertex")
+            continue;
+        Eigen::Vector3d vertex;
+        stream >> vertex[0] >> vertex[1] >> vertex[2];
+        vertices.push_back(vertex);
+    }
+    return vertices;
+}
+
+// Surface samples of a primitive geometry, enough for the capsule fitting to enclose it
+std::vector<Eigen::Vector3d> primitive_points(const urdf::Geometry &geometry)
+{
+    std::vector<Eigen::Vector3d> points;
+    if (geometry.type == urdf::Geometry::CYLINDER)
+    {
+        const urdf::Cylinder &cylinder = static_cast<const urdf::Cylinder &>(geometry);
+        for (int i = 0; i < 16; i++)
+        {
+            double angle = 2 * M_PI * i / 16;
+            // A polygon circumscribing the circle
+            double r = cylinder.radius / std::cos(M_PI / 16);
+            points.emplace_back(r * std::cos(angle), r * std::sin(angle), -cylinder.length / 2);
+            points.emplace_back(r * std::cos(angle), r * std::sin(angle), cylinder.length / 2);
+        }
+    }
+    else if (geometry.type == urdf::Geometry::SPHERE)
+    {
+        double radius = static_cast<const urdf::Sphere &>(geometry).radius;
+        for (int x = -1; x <= 1; x++)
+            for (int y = -1; y <= 1; y++)
+                for (int z = -1; z <= 1; z++)
+                    if (x != 0 || y != 0 || z != 0)
+                        points.push_back(Eigen::Vector3d(x, y, z).normalized() * radius);
+    }
+    else if (geometry.type == urdf::Geometry::BOX)
+    {
+        const urdf::Vector3 &size = static_cast<const urdf::Box &>(geometry).dim;
+        for (int i = 0; i < 8; i++)
+            points.emplace_back((i & 1 ? 0.5 : -0.5) * size.x, (i & 2 ? 0.5 : -0.5) * size.y,
+                                (i & 4 ? 0.5 : -0.5) * size.z);
+    }
+    return points;
+}
+
+double capsule_volume(const CollisionCapsule &capsule)
+{
+    return M_PI * capsule.radius * capsule.radius * ((capsule.p1 - capsule.p0).norm() + 4.0 / 3.0 * capsule.radius);
+}
+
+// Smallest-radius capsule along the principal axis that encloses all points
+bool fit_capsule(const std::vector<Eigen::Vector3d> &points, CollisionCapsule &capsule, Eigen::Vector3d &axis)
+{
+    if (points.size() < 2)
+        return false;
+    Eigen::Vector3d centroid = Eigen::Vector3d::Zero();
+    for (const Eigen::Vector3d &p : points)
+        centroid += p;
+    centroid /= points.size();
+    Eigen::Matrix3d covariance = Eigen::Matrix3d::Zero();
+    for (const Eigen::Vector3d &p : points)
+        covariance += (p - centroid) * (p - centroid).transpose();
+    Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> eigen_solver(covariance);
+    axis = eigen_solver.eigenvectors().col(2); // largest eigenvalue
+
+    double radius_sq = 0;
+    for (const Eigen::Vector3d &p : points)
+    {
+        Eigen::Vector3d d = p - centroid;
+        radius_sq = std::max(radius_sq, (d - d.dot(axis) * axis).squaredNorm());
+    }
+    // Every point has to be within the end spheres: t_begin <= t + s and t_end >= t - s
+    double t_begin = INF, t_end = -INF;
+    for (const Eigen::Vector3d &p : points)
+    {
+        Eigen::Vector3d d = p - centroid;
+        double t = d.dot(axis);
+        double s = std::sqrt(std::max(radius_sq - (d - t * axis).squaredNorm(), 0.0));
+        t_begin = std::min(t_begin, t + s);
+        t_end = std::max(t_end, t - s);
+    }
+    if (t_begin > t_end) // A sphere is enough
+        t_begin = t_end = (t_begin + t_end) / 2;
+    capsule.p0 = centroid + t_begin * axis;
+    capsule.p1 = centroid + t_end * axis;
+    capsule.radius = std::sqrt(radius_sq);
+    return true;
+}
+
+// Split the points in halves along the principal axis as long as it makes the capsules noticeably tighter
+void fit_capsules(const std::vector<Eigen::Vector3d> &points, int max_depth, std::vector<CollisionCapsule> &capsules)
+{
+    CollisionCapsule capsule;
+    Eigen::Vector3d axis;
+    if (!fit_capsule(points, capsule, axis))
+        return;
+    if (max_depth > 0 && points.size() >= 8)
+    {
+        std::vector<double> projections(points.size());
+        for (size_t i = 0; i < points.size(); i++)
+            projections[i] = points[i].dot(axis);
+        std::vector<double> sorted_projections = projections;
+        std::nth_element(sorted_projections.begin(), sorted_projections.begin() + sorted_projections.size() / 2,
+                         sorted_projections.end());
+        double median = sorted_projections[sorted_projections.size() / 2];
+        std::vector<Eigen::Vector3d> lower, upper;
+        for (size_t i = 0; i < points.size(); i++)
+            (projections[i] < median ? lower : upper).push_back(points[i]);
+        std::vector<CollisionCapsule> children;
+        fit_capsules(lower, max_depth - 1, children);
+        fit_capsules(upper, max_depth - 1, children);
+        double children_volume = 0;
+        for (const CollisionCapsule &child : children)
+            children_volume += capsule_volume(child);
+        if (!lower.empty() && !upper.empty() && children_volume < 0.7 * capsule_volume(capsule))
+        {
+            capsules.insert(capsules.end(), children.begin(), children.end());
+            return;
+        }
+    }
+    capsules.push_back(capsule);
+}
+
+// Closest points between segments p0-p1 and q0-q1, returns the squared distance
+double segment_distance_sq(const Eigen::Vector3d &p0, const Eigen::Vector3d &p1, const Eigen::Vector3d &q0,
+                           const Eigen::Vector3d &q1, Eigen::Vector3d &closest_p, Eigen::Vector3d &closest_q)
+{
+    const double eps = 1E-12;
+    Eigen::Vector3d d1 = p1 - p0;
+    Eigen::Vector3d d2 = q1 - q0;
+    Eigen::Vector3d r = p0 - q0;
+    double a = d1.squaredNorm();
+    double e = d2.squaredNorm();
+    double f = d2.dot(r);
+    double s = 0, t = 0;
+    if (a <= eps && e > eps)
+        t = std::min(std::max(f / e, 0.0), 1.0);
+    else if (a > eps)
+    {
+        double c = d1.dot(r);
+        if (e <= eps)
+            s = std::min(std::max(-c / a, 0.0), 1.0);
+        else
+        {
+            double b = d1.dot(d2);
+            double denom = a * e - b * b;
+            s = denom > eps ? std::min(std::max((b * f - c * e) / denom, 0.0), 1.0) : 0.0;
+            t = (b * s + f) / e;
+            if (t < 0)
+            {
+                t = 0;
+                s = std::min(std::max(-c / a, 0.0), 1.0);
+            }
+            else if (t > 1)
+            {
+                t = 1;
+                s = std::min(std::max((b - c) / a, 0.0), 1.0);
+            }
+        }
+    }
+    closest_p = p0 + s * d1;
+    closest_q = q0 + t * d2;
+    return (closest_p - closest_q).squaredNorm();
+}
+
+double aabb_distance(const Eigen::Vector3d &min_a, const Eigen::Vector3d &max_a, const Eigen::Vector3d &min_b,
+                     const Eigen::Vector3d &max_b)
+{
+    Eigen::Vector3d gap = (min_a - max_b).cwiseMax(min_b - max_a).cwiseMax(0.0);
+    return gap.norm();
+}
+} // namespace
+
+Arx5CollisionChecker::Arx5CollisionChecker(std::string urdf_path, int joint_dof, std::string base_link,
+                                           std::string eef_link)
+    : JOINT_DOF_(joint_dof), link_kinematics_(urdf_path, joint_dof, base_link, eef_link)
+{
+    fit_link_capsules_(urdf_path, base_link);
+    if (capsules_.size() < 1)
+        throw std::runtime_error("No collision or visual geometry found for the links from " + base_link + " to " +
+                                 eef_link + " in " + urdf_path);
+
+    // Adjacent links, and links whose capsules already overlap at the home position
+    int link_num = link_names_.size();
+    excluded_.assign(link_num, std::vector<bool>(link_num, false));
+    for (int i = 0; i + 1 < link_num; i++)
+        excluded_[i][i + 1] = excluded_[i + 1][i] = true;
+    Bvh bvh;
+    build_bvh_(VecDoF::Zero(JOINT_DOF_), KDL::Frame::Identity(), bvh);
+    for (int i = 0; i < int(capsules_.size()); i++)
+    {
+        for (int j = i + 1; j < int(capsules_.size()); j++)
+        {
+            Eigen::Vector3d closest_i, closest_j;
+            double distance_sq = segment_distance_sq(bvh.capsules[i].p0, bvh.capsules[i].p1, bvh.capsules[j].p0,
+                                                     bvh.capsules[j].p1, closest_i, closest_j);
+            int link_i = capsule_links_[i], link_j = capsule_links_[j];
+            if (std::sqrt(distance_sq) <= capsules_[i].radius + capsules_[j].radius)
+                excluded_[link_i][link_j] = excluded_[link_j][link_i] = true;
+        }
+    }
+}
+
+void Arx5CollisionChecker::fit_link_capsules_(std::string urdf_path, std::string base_link)
+{
+    urdf::ModelInterfaceSharedPtr model = urdf::parseURDFFile(urdf_path);
+    if (model == nullptr)
+        throw std::runtime_error("Failed to parse urdf file: " + urdf_path);
+    size_t slash = urdf_path.rfind('/');
+    std::string urdf_dir = slash == std::string::npos ? "." : urdf_path.substr(0, slash);
+
+    // Meshes are preferred over the primitives, which are only coarse approximations in the shipped urdfs
+    auto link_points = [&](const urdf::Link &link) {
+        // Collision elements first, then visual elements
+        std::vector<std::vector<std::pair<urdf::Pose, urdf::GeometrySharedPtr>>> element_lists(2);
+        for (const urdf::CollisionSharedPtr &collision : link.collision_array)
+            element_lists[0].emplace_back(collision->origin, collision->geometry);
+        for (const urdf::VisualSharedPtr &visual : link.visual_array)
+            element_lists[1].emplace_back(visual->origin, visual->geometry);
+        for (bool use_mesh : {true, false})
+        {
+            for (const auto &elements : element_lists)
+            {
+                std::vector<Eigen::Vector3d> points;
+                for (const auto &element : elements)
+                {
+                    if (element.second == nullptr)
+                        continue;
+                    Eigen::Isometry3d origin = element_origin(element.first);
+                    std::vector<Eigen::Vector3d> geometry_points;
+                    if (use_mesh && element.second->type == urdf::Geometry::MESH)
+                    {
+                        const urdf::Mesh &mesh = static_cast<const urdf::Mesh &>(*element.second);
+                        std::string mesh_path = resolve_mesh_path(mesh.filename, urdf_dir);
+                        if (!mesh_path.empty())
+                            geometry_points = load_stl_vertices(mesh_path);
+                        Eigen::Vector3d scale(mesh.scale.x, mesh.scale.y, mesh.scale.z);
+                        for (Eigen::Vector3d &p : geometry_points)
+                            p = p.cwiseProduct(scale);
+                    }
+                    else if (!use_mesh)
+                        geometry_points = primitive_points(*element.second);
+                    for (const Eigen::Vector3d &p : geometry_points)
+                        points.push_back(origin * p);
+                }
+                if (!points.empty())
+                    return points;
+            }
+        }
+        return std::vector<Eigen::Vector3d>();
+    };
+
+    auto add_link = [&](const std::string &link_name, int segment) {
+        urdf::LinkConstSharedPtr link = model->getLink(link_name);
+        if (link == nullptr)
+            return;
+        std::vector<CollisionCapsule> capsules;
+        fit_capsules(link_points(*link), MAX_SPLIT_DEPTH_, capsules);
+        if (capsules.empty())
+            return;
+        for (CollisionCapsule &capsule : capsules)
+        {
+            capsule.link_name = link_name;
+            capsules_.push_back(capsule);
+            capsule_links_.push_back(link_names_.size());
+        }
+        link_names_.push_back(link_name);
+        link_segments_.push_back(segment);
+    };
+    add_link(base_link, -1);
+    std::vector<std::string> chain_link_names = link_kinematics_.get_link_names();
+    for (int l = 0; l < int(chain_link_names.size()); l++)
+        add_link(chain_link_names[l], l);
+}
+
+void Arx5CollisionChecker::build_bvh_(const VecDoF &joint_pos, const KDL::Frame &base_frame, Bvh &bvh)
+{
+    const std::vector<KDL::Frame> &frames = link_kinematics_.link_frames(joint_pos);
+    bvh.capsules.resize(capsules_.size());
+    for (int i = 0; i < int(capsules_.size()); i++)
+    {
+        int segment = link_segments_[capsule_links_[i]];
+        KDL::Frame frame = segment < 0 ? base_frame : base_frame * frames[segment];
+        WorldCapsule &world = bvh.capsules[i];
+        KDL::Vector p0 = frame * KDL::Vector(capsules_[i].p0[0], capsules_[i].p0[1], capsules_[i].p0[2]);
+        KDL::Vector p1 = frame * KDL::Vector(capsules_[i].p1[0], capsules_[i].p1[1], capsules_[i].p1[2]);
+        world.p0 = Eigen::Vector3d(p0.x(), p0.y(), p0.z());
+        world.p1 = Eigen::Vector3d(p1.x(), p1.y(), p1.z());
+        world.radius = capsules_[i].radius;
+        world.index = i;
+        world.aabb_min = world.p0.cwiseMin(world.p1).array() - world.radius;
+        world.aabb_max = world.p0.cwiseMax(world.p1).array() + world.radius;
+    }
+    bvh.nodes.clear();
+    capsule_ids_.resize(capsules_.size());
+    for (int i = 0; i < int(capsules_.size()); i++)
+        capsule_ids_[i] = i;
+    build_bvh_nodes_(bvh, capsule_ids_, 0, capsule_ids_.size());
+}
+
+int Arx5CollisionChecker::build_bvh_nodes_(Bvh &bvh, std::vector<int> &capsule_ids, int begin, int end)
+{
+    int node_id = bvh.nodes.size();
+    bvh.nodes.emplace_back();
+    BvhNode node;
+    node.aabb_min = Eigen::Vector3d::Constant(INF);
+    node.aabb_max = Eigen::Vector3d::Constant(-INF);
+    Eigen::Vector3d center_min = Eigen::Vector3d::Constant(INF);
+    Eigen::Vector3d center_max = Eigen::Vector3d::Constant(-INF);
+    for (int i = begin; i < end; i++)
+    {
+        const WorldCapsule &capsule = bvh.capsules[capsule_ids[i]];
+        node.aabb_min = node.aabb_min.cwiseMin(capsule.aabb_min);
+        node.aabb_max = node.aabb_max.cwiseMax(capsule.aabb_max);
+        center_min = center_min.cwiseMin((capsule.p0 + capsule.p1) / 2);
+        center_max = center_max.cwiseMax((capsule.p0 + capsule.p1) / 2);
+    }
+    if (end - begin == 1)
+    {
+        node.left = node.right = -1;
+        node.capsule = capsule_ids[begin];
+    }
+    else
+    {
+        // Median split along the longest axis of the capsule centers
+        int axis;
+        (center_max - center_min).maxCoeff(&axis);
+        int mid = (begin + end) / 2;
+        std::nth_element(capsule_ids.begin() + begin, capsule_ids.begin() + mid, capsule_ids.begin() + end,
+                         [&](int a, int b) {
+                             return bvh.capsules[a].p0[axis] + bvh.capsules[a].p1[axis] <
+                                    bvh.capsules[b].p0[axis] + bvh.capsules[b].p1[axis];
+                         });
+        node.capsule = -1;
+        node.left = build_bvh_nodes_(bvh, capsule_ids, begin, mid);
+        node.right = build_bvh_nodes_(bvh, capsule_ids, mid, end);
+    }
+    bvh.nodes[node_id] = node;
+    return node_id;
+}
+
+void Arx5CollisionChecker::bvh_distance_(const Bvh &bvh_a, int node_a, const Bvh &bvh_b, int node_b, bool self,
+                                         CollisionResult &result, int &best_a, int &best_b)
+{
+    const BvhNode &a = bvh_a.nodes[node_a];
+    const BvhNode &b = bvh_b.nodes[node_b];
+    if (self && node_a == node_b)
+    {
+        if (a.capsule >= 0)
+            return;
+        bvh_distance_(bvh_a, a.left, bvh_b, a.left, self, result, best_a, best_b);
+        bvh_distance_(bvh_a, a.right, bvh_b, a.right, self, result, best_a, best_b);
+        bvh_distance_(bvh_a, a.left, bvh_b, a.right, self, result, best_a, best_b);
+        return;
+    }
+    if (aabb_distance(a.aabb_min, a.aabb_max, b.aabb_min, b.aabb_max) >= result.distance)
+        return;
+    if (a.capsule >= 0 && b.capsule >= 0)
+    {
+        const WorldCapsule &capsule_a = bvh_a.capsules[a.capsule];
+        const WorldCapsule &capsule_b = bvh_b.capsules[b.capsule];
+        if (self)
+        {
+            // Only valid for the capsules of this checker, the ones of another arm index into its own list
+            int link_a = capsule_links_[capsule_a.index];
+            int link_b = capsule_links_[capsule_b.index];
+            if (link_a == link_b || excluded_[link_a][link_b])
+                return;
+        }
+        Eigen::Vector3d closest_a, closest_b;
+        double distance_sq =
+            segment_distance_sq(capsule_a.p0, capsule_a.p1, capsule_b.p0, capsule_b.p1, closest_a, closest_b);
+        double distance = std::sqrt(distance_sq) - capsule_a.radius - capsule_b.radius;
+        if (distance < result.distance)
+        {
+            result.distance = distance;
+            Eigen::Vector3d direction = closest_b - closest_a;
+            if (direction.norm() > 1E-12)
+                direction.normalize();
+            result.point_a = closest_a + capsule_a.radius * direction;
+            result.point_b = closest_b - capsule_b.radius * direction;
+            best_a = capsule_a.index;
+            best_b = capsule_b.index;
+        }
+        return;
+    }
+    // Descend into the larger node first
+    bool split_a = b.capsule >= 0 || (a.capsule < 0 && (a.aabb_max - a.aabb_min).squaredNorm() >
+                                                           (b.aabb_max - b.aabb_min).squaredNorm());
+    if (split_a)
+    {
+        bvh_distance_(bvh_a, a.left, bvh_b, node_b, self, result, best_a, best_b);
+        bvh_distance_(bvh_a, a.right, bvh_b, node_b, self, result, best_a, best_b);
+    }
+    else
+    {
+        bvh_distance_(bvh_a, node_a, bvh_b, b.left, self, result, best_a, best_b);
+        bvh_distance_(bvh_a, node_a, bvh_b, b.right, self, result, best_a, best_b);
+    }
+}
+
+CollisionResult Arx5CollisionChecker::self_distance(VecDoF joint_pos)
+{
+    build_bvh_(joint_pos, KDL::Frame::Identity(), bvh_a_);
+    CollisionResult result;
+    result.distance = INF;
+    result.point_a = result.point_b = Eigen::Vector3d::Zero();
+    int best_a = -1, best_b = -1;
+    bvh_distance_(bvh_a_, 0, bvh_a_, 0, true, result, best_a, best_b);
+    if (best_a >= 0)
+    {
+        result.link_a = capsules_[best_a].link_name;
+        result.link_b = capsules_[best_b].link_name;
+    }
+    return result;
+}
+
+CollisionResult Arx5CollisionChecker::inter_arm_distance(VecDoF joint_pos, std::shared_ptr<Arx5CollisionChecker> other,
+                                                         Pose6d other_base_pose, VecDoF other_joint_pos)
+{
+    if (other == nullptr)
+        throw std::invalid_argument("The collision checker of the other arm must not be null");
+    build_bvh_(joint_pos, KDL::Frame::Identity(), bvh_a_);
+    other->build_bvh_(other_joint_pos, pose6d2frame(other_base_pose), bvh_b_);
+    CollisionResult result;
+    result.distance = INF;
+    result.point_a = result.point_b = Eigen::Vector3d::Zero();
+    int best_a = -1, best_b = -1;
+    bvh_distance_(bvh_a_, 0, bvh_b_, 0, false, result, best_a, best_b);
+    if (best_a >= 0)
+    {
+        result.link_a = capsules_[best_a].link_name;
+        result.link_b = other->capsules_[best_b].link_name;
+    }
+    return result;
+}
+
+int Arx5CollisionChecker::validate_trajectory(std::vector<JointState> joint_traj, double min_distance,
+                                              double max_joint_step)
+{
+    if (max_joint_step <= 0)
+        throw std::invalid_argument("max_joint_step must be positive");
+    for (int k = 0; k < int(joint_traj.size()); k++)
+    {
+        VecDoF prev_pos = k == 0 ? joint_traj[0].pos : joint_traj[k - 1].pos;
+        double max_delta = (joint_traj[k].pos - prev_pos).cwiseAbs().maxCoeff();
+        int step_num = std::max(int(std::ceil(max_delta / max_joint_step)), 1);
+        for (int i = 1; i <= step_num; i++)
+        {
+            double alpha = double(i) / step_num;
+            if (self_distance(prev_pos * (1 - alpha) + joint_traj[k].pos * alpha).distance < min_distance)
+                return k;
+        }
+    }
+    return -1;
+}
+
+int Arx5CollisionChecker::validate_dual_trajectory(std::vector<JointState> joint_traj,
+                                                   std::shared_ptr<Arx5CollisionChecker> other, Pose6d other_base_pose,
+                                                   std::vector<JointState> other_joint_traj, double min_distance,
+                                                   double max_joint_step)
+{
+    if (other == nullptr)
+        throw std::invalid_argument("The collision checker of the other arm must not be null");
+    if (max_joint_step <= 0)
+        throw std::invalid_argument("max_joint_step must be positive");
+    if (joint_traj.size() != other_joint_traj.size())
+        throw std::invalid_argument("Both trajectories should have the same length, got " +
+                                    std::to_string(joint_traj.size()) + " and " +
+                                    std::to_string(other_joint_traj.size()));
+    for (int k = 0; k < int(joint_traj.size()); k++)
+    {
+        VecDoF prev_pos = k == 0 ? joint_traj[0].pos : joint_traj[k - 1].pos;
+        VecDoF other_prev_pos = k == 0 ? other_joint_traj[0].pos : other_joint_traj[k - 1].pos;
+        double max_delta = std::max((joint_traj[k].pos - prev_pos).cwiseAbs().maxCoeff(),
+                                    (other_joint_traj[k].pos - other_prev_pos).cwiseAbs().maxCoeff());
+        int step_num = std::max(int(std::ceil(max_delta / max_joint_step)), 1);
+        for (int i = 1; i <= step_num; i++)
+        {
+            double alpha = double(i) / step_num;
+            VecDoF pos = prev_pos * (1 - alpha) + joint_traj[k].pos * alpha;
+            VecDoF other_pos = other_prev_pos * (1 - alpha) + other_joint_traj[k].pos * alpha;
+            if (self_distance(pos).distance < min_distance || other->self_distance(other_pos).distance < min_distance ||
+                inter_arm_distance(pos, other, other_base_pose, other_pos).distance < min_distance)
+                return k;
+        }
+    }
+    return -1;
+}
+
+std::vector<CollisionCapsule> Arx5CollisionChecker::get_capsules()
+{
+    return capsules_;
+}
+
+std::vector<std::pair<std::string, std::string>> Arx5CollisionChecker::get_excluded_pairs()
+{
+    std::vector<std::pair<std::string, std::string>> pairs;
+    for (int i = 0; i < int(link_names_.size()); i++)
+    {
+        for (int j = i + 1; j < int(link_names_.size()); j++)
+        {
+            if (excluded_[i][j])
+                pairs.emplace_back(link_names_[i], link_names_[j]);
+        }
+    }
+    return pairs;
+}
+
+void Arx5CollisionChecker::set_pair_excluded(std::string link_a, std::string link_b, bool excluded)
+{
+    auto link_index = [&](const std::string &link_name) {
+        auto it = std::find(link_names_.begin(), link_names_.end(), link_name);
+        if (it == link_names_.end())
+            throw std::invalid_argument("No collision capsule for link " + link_name);
+        return int(it - link_names_.begin());
+    };
+    int index_a = link_index(link_a);
+    int index_b = link_index(link_b);
+    excluded_[index_a][index_b] = excluded_[index_b][index_a] = excluded;
+}
+
+} // namespace arx
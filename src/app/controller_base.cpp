@@ -1,7 +1,9 @@
 #include "app/controller_base.h"
 #include "app/common.h"
 #include "utils.h"
+#include <algorithm>
 #include <array>
+#include <cmath>
 #include <stdexcept>
 #include <sys/syscall.h>
 #include <sys/types.h>
@@ -14,16 +16,73 @@ Arx5ControllerBase::Arx5ControllerBase(RobotConfig robot_config, ControllerConfi
       robot_config_(robot_config), controller_config_(controller_config)
 {
     start_time_us_ = get_time_us();
+    clock_domain_ = std::make_shared<ClockDomain>(start_time_us_);
+    event_bus_ = std::make_shared<EventBus>(logger_);
+    gripper_controller_ = std::make_shared<GripperController>(robot_config_, controller_config_, event_bus_);
+    ClockDomain::check_clock(controller_config_.command_clock);
+    TrajDerivative::check_method(controller_config_.traj_vel_method);
+    if (controller_config_.contact_reaction != "none" && controller_config_.contact_reaction != "stop" &&
+        controller_config_.contact_reaction != "retract" && controller_config_.contact_reaction != "damping")
+        throw std::invalid_argument("Invalid contact reaction: " + controller_config_.contact_reaction +
+                                    ". Currently available: 'none', 'stop', 'retract' or 'damping'");
+    if (controller_config_.contact_detection && controller_config_.momentum_observer_gain <= 0)
+        throw std::invalid_argument("Contact detection requires a positive momentum_observer_gain");
+    if (controller_config_.contact_retract_time <= 0)
+        throw std::invalid_argument("Contact retract time must be positive");
+    if (controller_config_.load_shedding_max_level < 0 || controller_config_.load_shedding_max_level > 3)
+        throw std::invalid_argument("Load shedding max level must be between 0 (disabled) and 3 (HOLD)");
+    if (controller_config_.overrun_escalate_cnt <= 0 || controller_config_.overrun_recover_cnt <= 0)
+        throw std::invalid_argument("Overrun escalate and recover counts must be positive");
+    if (controller_config_.overrun_tolerance < 0)
+        throw std::invalid_argument("Overrun tolerance must be non-negative");
+    if (controller_config_.gravity_comp_period < 0 || controller_config_.diagnostics_period <= 0)
+        throw std::invalid_argument("Gravity compensation period must be non-negative and diagnostics period positive");
+    contact_torque_threshold_ = controller_config_.contact_torque_threshold;
+    if (contact_torque_threshold_.size() == 0)
+        contact_torque_threshold_ = 0.3 * robot_config_.joint_torque_max;
+    else if (contact_torque_threshold_.size() != robot_config_.joint_dof)
+        throw std::invalid_argument("Contact torque threshold expected size " +
+                                    std::to_string(robot_config_.joint_dof) + " but got " +
+                                    std::to_string(contact_torque_threshold_.size()));
     logger_->set_pattern("[%H:%M:%S %n %^%l%$] %v");
     solver_ = std::make_shared<Arx5Solver>(
         robot_config_.urdf_path, robot_config_.joint_dof, robot_config_.joint_pos_min, robot_config_.joint_pos_max,
         robot_config_.base_link_name, robot_config_.eef_link_name, robot_config_.gravity_vector);
+    link_kinematics_ = std::make_shared<Arx5LinkKinematics>(robot_config_.urdf_path, robot_config_.joint_dof,
+                                                            robot_config_.base_link_name, robot_config_.eef_link_name);
+    diagnostics_kinematics_ = std::make_shared<Arx5LinkKinematics>(
+        robot_config_.urdf_path, robot_config_.joint_dof, robot_config_.base_link_name, robot_config_.eef_link_name);
+    // The observer only runs for contact detection, so that it costs nothing otherwise
+    if (controller_config_.contact_detection)
+        momentum_observer_ = std::make_shared<Arx5MomentumObserver>(
+            robot_config_.urdf_path, robot_config_.joint_dof, robot_config_.base_link_name,
+            robot_config_.eef_link_name, robot_config_.gravity_vector, controller_config_.momentum_observer_gain);
+    if (controller_config_.collision_check)
+    {
+        collision_checker_ =
+            std::make_shared<Arx5CollisionChecker>(robot_config_.urdf_path, robot_config_.joint_dof,
+                                                   robot_config_.base_link_name, robot_config_.eef_link_name);
+        logger_->info("Collision guard enabled with {} link capsules, min distance: {:.3f}m",
+                      collision_checker_->get_capsules().size(), controller_config_.collision_min_distance);
+    }
     if (robot_config_.robot_model == "X5" && !controller_config_.shutdown_to_passive)
     {
         logger_->warn("When shutting down X5 robot arms, the motors have to be set to passive. "
                       "controller_config_.shutdown_to_passive is set to `true`");
         controller_config_.shutdown_to_passive = true;
     }
+    diagnostics_.motor_temperature = Eigen::VectorXd::Zero(robot_config_.joint_dof + 1);
+    diagnostics_buffer_ = diagnostics_;
+    double dt = controller_config_.controller_dt;
+    task_scheduler_ = std::make_shared<TaskScheduler>(dt, controller_config_.task_budget_ratio * dt);
+    if (controller_config_.gravity_compensation)
+    {
+        task_scheduler_->add_task("gravity_compensation", controller_config_.gravity_comp_period, 0,
+                                  [this](double timestamp) { update_gravity_torque_(timestamp); });
+        gravity_period_ = std::max(1.0, std::round(controller_config_.gravity_comp_period / dt)) * dt;
+    }
+    task_scheduler_->add_task("diagnostics", controller_config_.diagnostics_period, 1,
+                              [this](double timestamp) { update_diagnostics_(timestamp); });
     init_robot_();
     background_send_recv_thread_ = std::thread(&Arx5ControllerBase::background_send_recv_, this);
     background_send_recv_running_ = controller_config_.background_send_recv;
@@ -32,6 +91,28 @@ Arx5ControllerBase::Arx5ControllerBase(RobotConfig robot_config, ControllerConfi
 
 Arx5ControllerBase::~Arx5ControllerBase()
 {
+    Arx5ControllerBase *collision_peer;
+    {
+        // The leader and the collision peer may be destroyed right after this arm, stop reading them and sending
+        // feedback first
+        std::lock_guard<std::mutex> guard(cmd_mutex_);
+        teleop_leader_ = nullptr;
+        resume_interpolator_();
+        collision_peer = collision_peer_;
+        collision_peer_ = nullptr;
+        collision_peer_checker_ = nullptr;
+    }
+    if (collision_peer != nullptr)
+    {
+        // A mutual pairing would otherwise leave the peer reading this arm. Locked separately, so that two arms
+        // destroyed at the same time do not wait for each other.
+        std::lock_guard<std::mutex> guard(collision_peer->cmd_mutex_);
+        if (collision_peer->collision_peer_ == this)
+        {
+            collision_peer->collision_peer_ = nullptr;
+            collision_peer->collision_peer_checker_ = nullptr;
+        }
+    }
     if (controller_config_.shutdown_to_passive)
     {
         logger_->info("Set to damping before exit");
@@ -50,6 +131,7 @@ Arx5ControllerBase::~Arx5ControllerBase()
             output_joint_cmd_.vel = VecDoF::Zero(robot_config_.joint_dof);
             output_joint_cmd_.torque = VecDoF::Zero(robot_config_.joint_dof);
             interpolator_.init_fixed(output_joint_cmd_);
+            cmd_source_ = CmdSource::INTERPOLATOR;
         }
         background_send_recv_running_ = true;
         controller_config_.gravity_compensation = false;
@@ -63,6 +145,8 @@ Arx5ControllerBase::~Arx5ControllerBase()
     destroy_background_threads_ = true;
     background_send_recv_thread_.join();
     logger_->info("background send_recv task joined");
+    if (traj_handle_ != nullptr)
+        traj_handle_->finish(TrajStatus::OVERRIDDEN);
     spdlog::drop(logger_->name());
     logger_.reset();
     solver_.reset();
@@ -80,6 +164,24 @@ JointState Arx5ControllerBase::get_joint_state()
     return joint_state_;
 }
 
+JointStateEstimate Arx5ControllerBase::get_joint_state_estimate()
+{
+    std::lock_guard<std::mutex> guard(state_mutex_);
+    return joint_state_estimate_;
+}
+
+VecDoF Arx5ControllerBase::get_external_torque()
+{
+    std::lock_guard<std::mutex> guard(state_mutex_);
+    return external_torque_;
+}
+
+bool Arx5ControllerBase::is_contact_detected()
+{
+    std::lock_guard<std::mutex> guard(state_mutex_);
+    return contact_detected_;
+}
+
 EEFState Arx5ControllerBase::get_eef_state()
 {
     EEFState eef_state;
@@ -93,6 +195,18 @@ EEFState Arx5ControllerBase::get_eef_state()
     return eef_state;
 }
 
+EEFStateSE3 Arx5ControllerBase::get_eef_state_se3()
+{
+    EEFStateSE3 eef_state;
+    JointState joint_state = get_joint_state();
+    eef_state.pose = forward_kinematics_se3_(joint_state.pos);
+    eef_state.timestamp = joint_state.timestamp;
+    eef_state.gripper_pos = joint_state.gripper_pos;
+    eef_state.gripper_vel = joint_state.gripper_vel;
+    eef_state.gripper_torque = joint_state.gripper_torque;
+    return eef_state;
+}
+
 void Arx5ControllerBase::set_gain(Gain new_gain)
 {
     // Make sure the robot doesn't jump when setting kp to non-zero
@@ -130,6 +244,72 @@ double Arx5ControllerBase::get_timestamp()
 {
     return double(get_time_us() - start_time_us_) / 1e6;
 }
+
+std::shared_ptr<ClockDomain> Arx5ControllerBase::get_clock_domain()
+{
+    return clock_domain_;
+}
+
+std::shared_ptr<EventBus> Arx5ControllerBase::get_event_bus()
+{
+    return event_bus_;
+}
+
+LoopStats Arx5ControllerBase::get_loop_stats()
+{
+    std::lock_guard<std::mutex> guard(state_mutex_);
+    return loop_stats_;
+}
+
+void Arx5ControllerBase::reset_loop_stats()
+{
+    std::lock_guard<std::mutex> guard(state_mutex_);
+    loop_stats_ = LoopStats();
+}
+
+LoadLevel Arx5ControllerBase::get_load_level()
+{
+    return load_level_;
+}
+
+std::vector<TaskStats> Arx5ControllerBase::get_task_stats()
+{
+    return task_scheduler_->get_stats();
+}
+
+void Arx5ControllerBase::reset_task_stats()
+{
+    task_scheduler_->reset_stats();
+}
+
+Diagnostics Arx5ControllerBase::get_diagnostics()
+{
+    std::lock_guard<std::mutex> guard(state_mutex_);
+    return diagnostics_;
+}
+
+double Arx5ControllerBase::to_controller_time_(double command_time)
+{
+    if (command_time == 0 || controller_config_.command_clock == "controller")
+        return command_time;
+    return clock_domain_->to_controller_time(command_time, controller_config_.command_clock);
+}
+void Arx5ControllerBase::calc_traj_vel_(JointTrajectory &traj, int current_index, double avg_window_s)
+{
+    if (controller_config_.traj_vel_method == "window")
+    {
+        calc_joint_vel(traj, avg_window_s);
+        return;
+    }
+    int waypoint_num = traj.size() - current_index;
+    TrajDerivative traj_derivative{robot_config_.joint_dof, "spline"};
+    traj_derivative.reserve(waypoint_num);
+    traj_derivative.set_boundary_vel(traj.vel.row(current_index).transpose(), VecDoF::Zero(robot_config_.joint_dof));
+    for (int i = current_index; i < traj.size(); i++)
+        traj_derivative.append(traj.timestamps[i], traj.pos.row(i).transpose());
+    traj.vel.bottomRows(waypoint_num) = traj_derivative.get_vel().transpose();
+}
+
 RobotConfig Arx5ControllerBase::get_robot_config()
 {
     return robot_config_;
@@ -140,7 +320,9 @@ ControllerConfig Arx5ControllerBase::get_controller_config()
 }
 void Arx5ControllerBase::set_log_level(spdlog::level::level_enum level)
 {
-    logger_->set_level(level);
+    log_level_ = level;
+    // Debug logs stay off while the control loop sheds load
+    logger_->set_level(load_level_ == LoadLevel::NORMAL ? level : std::max(level, spdlog::level::info));
 }
 
 void Arx5ControllerBase::reset_to_home()
@@ -185,6 +367,8 @@ void Arx5ControllerBase::reset_to_home()
         start_state.gripper_pos = init_state.gripper_pos;
         start_state.timestamp = get_timestamp();
         interpolator_.init(start_state, target_state);
+        cmd_source_ = CmdSource::INTERPOLATOR;
+        gripper_controller_->release();
     }
     Gain new_gain{robot_config_.joint_dof};
     for (int i = 0; i <= step_num; i++)
@@ -217,11 +401,99 @@ void Arx5ControllerBase::set_to_damping()
         joint_state.vel = VecDoF::Zero(robot_config_.joint_dof);
         joint_state.torque = VecDoF::Zero(robot_config_.joint_dof);
         interpolator_.init_fixed(joint_state);
+        cmd_source_ = CmdSource::INTERPOLATOR;
+        gripper_controller_->release();
     }
 }
 
+void Arx5ControllerBase::grasp(double torque, double speed)
+{
+    std::lock_guard<std::mutex> guard(cmd_mutex_);
+    if (gain_.gripper_kp <= 0)
+        throw std::invalid_argument("Grasp requires a positive gripper kp");
+    gripper_controller_->grasp(torque, speed, output_joint_cmd_.gripper_pos);
+}
+
+void Arx5ControllerBase::release_grasp()
+{
+    std::lock_guard<std::mutex> guard(cmd_mutex_);
+    gripper_controller_->release();
+}
+
+GraspState Arx5ControllerBase::get_grasp_state()
+{
+    std::lock_guard<std::mutex> guard(cmd_mutex_);
+    return gripper_controller_->get_state();
+}
+
+double Arx5ControllerBase::get_grasp_width()
+{
+    std::lock_guard<std::mutex> guard(cmd_mutex_);
+    return gripper_controller_->get_grasp_width();
+}
+
+void Arx5ControllerBase::set_collision_peer(Arx5ControllerBase *peer, Pose6d peer_base_pose)
+{
+    if (collision_checker_ == nullptr)
+        throw std::runtime_error("Collision guard is disabled. Please set controller_config.collision_check to true.");
+    std::shared_ptr<Arx5CollisionChecker> peer_checker;
+    if (peer != nullptr)
+    {
+        // A separate checker instance, since the peer's one is used by its own background thread
+        RobotConfig peer_config = peer->get_robot_config();
+        peer_checker = std::make_shared<Arx5CollisionChecker>(peer_config.urdf_path, peer_config.joint_dof,
+                                                              peer_config.base_link_name, peer_config.eef_link_name);
+    }
+    std::lock_guard<std::mutex> guard(cmd_mutex_);
+    collision_peer_ = peer;
+    collision_peer_checker_ = peer_checker;
+    collision_peer_base_pose_ = peer_base_pose;
+}
+
+void Arx5ControllerBase::set_teleop_leader(Arx5ControllerBase *leader, TeleopConfig teleop_config)
+{
+    if (leader == this)
+        throw std::invalid_argument("An arm cannot be its own teleop leader");
+    if (teleop_config.joint_scale.size() != robot_config_.joint_dof ||
+        teleop_config.joint_offset.size() != robot_config_.joint_dof)
+        throw std::invalid_argument("Teleop joint scale and offset should have size " +
+                                    std::to_string(robot_config_.joint_dof));
+    RobotConfig leader_config = leader != nullptr ? leader->get_robot_config() : robot_config_;
+    if (leader_config.joint_dof != robot_config_.joint_dof)
+        throw std::invalid_argument("Teleop leader has " + std::to_string(leader_config.joint_dof) +
+                                    " joints, but the follower has " + std::to_string(robot_config_.joint_dof));
+    if (leader != nullptr && leader_config.gripper_width <= 0)
+        throw std::invalid_argument("Teleop leader gripper width should be positive");
+    std::lock_guard<std::mutex> guard(cmd_mutex_);
+    if (leader == nullptr)
+    {
+        resume_interpolator_();
+        teleop_leader_ = nullptr;
+        return;
+    }
+    resume_interpolator_();
+    teleop_config_ = teleop_config;
+    teleop_leader_gripper_width_ = leader_config.gripper_width;
+    prev_teleop_leader_ok_ = true;
+    teleop_feedback_energy_ = 0.0;
+    teleop_leader_ = leader;
+    cmd_source_ = CmdSource::TELEOP;
+}
+
+TeleopConfig Arx5ControllerBase::get_teleop_config()
+{
+    std::lock_guard<std::mutex> guard(cmd_mutex_);
+    return teleop_config_;
+}
+
 // ---------------------- Private functions ----------------------
 
+PoseSE3 Arx5ControllerBase::forward_kinematics_se3_(const VecDoF &joint_pos)
+{
+    std::lock_guard<std::mutex> guard(kinematics_mutex_);
+    return link_kinematics_->forward_kinematics(joint_pos);
+}
+
 void Arx5ControllerBase::init_robot_()
 {
     // Background send receive is disabled during initialization
@@ -233,6 +505,9 @@ void Arx5ControllerBase::init_robot_()
         over_current_protection_();
         // logger_->info("pos: {}", vec2str(joint_state_.pos));
     }
+    // The gravity task only runs after the commands of a tick are sent, so the first command needs it beforehand
+    if (controller_config_.gravity_compensation)
+        update_gravity_torque_(joint_state_.timestamp);
 
     Gain gain{robot_config_.joint_dof};
     gain.kd = controller_config_.default_kd;
@@ -311,11 +586,15 @@ void Arx5ControllerBase::check_joint_state_sanity_()
 void Arx5ControllerBase::over_current_protection_()
 {
     bool over_current = false;
+    int over_current_id = -1;
+    double over_current_torque = 0.0;
     for (int i = 0; i < robot_config_.joint_dof; ++i)
     {
         if (std::abs(joint_state_.torque[i]) > robot_config_.joint_torque_max[i])
         {
             over_current = true;
+            over_current_id = i;
+            over_current_torque = joint_state_.torque[i];
             logger_->error("Over current detected once on joint {}, current: {:.3f}", i, joint_state_.torque[i]);
             break;
         }
@@ -323,10 +602,14 @@ void Arx5ControllerBase::over_current_protection_()
     if (std::abs(joint_state_.gripper_torque) > robot_config_.gripper_torque_max)
     {
         over_current = true;
+        over_current_id = robot_config_.joint_dof;
+        over_current_torque = joint_state_.gripper_torque;
         logger_->error("Over current detected once on gripper, current: {:.3f}", joint_state_.gripper_torque);
     }
     if (over_current)
     {
+        if (over_current_cnt_ == 0)
+            event_bus_->publish(EventType::OVER_CURRENT, joint_state_.timestamp, over_current_id, over_current_torque);
         over_current_cnt_++;
         if (over_current_cnt_ > controller_config_.over_current_cnt_max)
         {
@@ -349,6 +632,7 @@ void Arx5ControllerBase::enter_emergency_state_()
     damping_gain.kd[2] *= 3;
     damping_gain.kd[3] *= 1.5;
     logger_->error("Emergency state entered. Please restart the program.");
+    event_bus_->publish(EventType::EMERGENCY, get_timestamp());
     while (true)
     {
         std::lock_guard<std::mutex> guard(cmd_mutex_);
@@ -357,6 +641,7 @@ void Arx5ControllerBase::enter_emergency_state_()
         output_joint_cmd_.torque = VecDoF::Zero(robot_config_.joint_dof);
 
         interpolator_.init_fixed(output_joint_cmd_);
+        cmd_source_ = CmdSource::INTERPOLATOR;
         send_recv_();
         sleep_ms(5);
     }
@@ -405,6 +690,21 @@ void Arx5ControllerBase::update_joint_state_()
     joint_state_.gripper_torque =
         motor_msg[robot_config_.gripper_motor_id].current_actual_float * torque_constant_DM_J4310;
     joint_state_.timestamp = get_timestamp();
+    joint_estimator_.update(joint_state_.timestamp, joint_state_.pos, joint_state_.vel);
+    joint_estimator_.get_estimate(joint_state_estimate_);
+    if (momentum_observer_ != nullptr)
+    {
+        external_torque_ = momentum_observer_->update(joint_state_.timestamp, joint_state_.pos, joint_state_.vel,
+                                                      joint_state_.torque);
+        bool contact = (external_torque_.cwiseAbs().array() > contact_torque_threshold_.array()).any();
+        if (contact && !contact_detected_)
+        {
+            contact_joint_pos_ = joint_state_.pos;
+            contact_torque_ = external_torque_;
+            contact_pending_ = true;
+        }
+        contact_detected_ = contact;
+    }
 }
 
 void Arx5ControllerBase::update_output_cmd_()
@@ -413,21 +713,106 @@ void Arx5ControllerBase::update_output_cmd_()
 
     // TODO: deal with non-zero velocity and torque for joint control
     double timestamp = get_timestamp();
+    Arx5ControllerBase *collision_peer;
+    std::shared_ptr<Arx5CollisionChecker> collision_peer_checker;
+    Pose6d collision_peer_base_pose;
+    bool grasp_active;
+    LoadLevel load_level = load_level_;
+    // Read before locking cmd_mutex_, so that the leader and the follower never wait for each other's locks
+    Arx5ControllerBase *teleop_leader = cmd_source_ == CmdSource::TELEOP ? teleop_leader_.load() : nullptr;
+    JointState leader_state{robot_config_.joint_dof};
+    double leader_state_age = 0.0;
+    if (teleop_leader != nullptr)
+    {
+        leader_state = teleop_leader->get_joint_state();
+        leader_state_age = teleop_leader->get_timestamp() - leader_state.timestamp;
+    }
     {
         std::lock_guard<std::mutex> guard(cmd_mutex_);
-        output_joint_cmd_ = interpolator_.interpolate(timestamp);
+        if (contact_pending_)
+        {
+            react_to_contact_(timestamp);
+            contact_pending_ = false;
+        }
+        if (load_level == LoadLevel::HOLD)
+        {
+            // The commands are discarded until the control loop recovers, see set_load_level_()
+            output_joint_cmd_ = prev_output_cmd;
+            output_joint_cmd_.vel = VecDoF::Zero(robot_config_.joint_dof);
+            output_joint_cmd_.torque = VecDoF::Zero(robot_config_.joint_dof);
+            output_joint_cmd_.timestamp = timestamp;
+        }
+        else if (cmd_source_ == CmdSource::TELEOP && teleop_leader != nullptr)
+        {
+            output_joint_cmd_ = teleop_follow_(timestamp, prev_output_cmd, leader_state, leader_state_age);
+            if (load_level == LoadLevel::NORMAL)
+                teleop_reflect_(teleop_leader, leader_state, leader_state_age);
+        }
+        else if (cmd_source_ == CmdSource::EEF)
+            output_joint_cmd_ = eef_interpolate_(timestamp, prev_output_cmd);
+        else if (cmd_source_ == CmdSource::JOINT_VEL)
+            output_joint_cmd_ = joint_vel_integrate_(timestamp, prev_output_cmd);
+        else if (cmd_source_ == CmdSource::JOINT_TORQUE)
+            output_joint_cmd_ = joint_torque_stream_(timestamp, prev_output_cmd);
+        else if (cmd_source_ == CmdSource::CHUNK)
+            output_joint_cmd_ = action_chunk_ensemble_(timestamp, prev_output_cmd);
+        else
+        {
+            output_joint_cmd_ = interpolator_.interpolate(timestamp);
+            check_traj_complete_(timestamp, interpolator_.get_end_time());
+        }
+        if (load_level != LoadLevel::HOLD)
+            update_traj_handle_(timestamp, prev_output_cmd);
+        // joint_state_ is only written by this thread, so it can be read without state_mutex_
+        grasp_active = gripper_controller_->is_active();
+        if (grasp_active)
+            output_joint_cmd_.gripper_pos =
+                gripper_controller_->update(timestamp, joint_state_.gripper_pos, joint_state_.gripper_vel,
+                                            joint_state_.gripper_torque, gain_.gripper_kp);
+        collision_peer = collision_peer_;
+        collision_peer_checker = collision_peer_checker_;
+        collision_peer_base_pose = collision_peer_base_pose_;
     }
+    // Read before locking state_mutex_, otherwise two arms guarding each other can deadlock
+    VecDoF peer_joint_pos;
+    if (collision_peer != nullptr)
+        peer_joint_pos = collision_peer->get_joint_state().pos;
 
     std::lock_guard<std::mutex> guard(state_mutex_);
     if (controller_config_.gravity_compensation)
     {
-        output_joint_cmd_.torque += solver_->inverse_dynamics(joint_state_.pos, VecDoF::Zero(robot_config_.joint_dof),
-                                                              VecDoF::Zero(robot_config_.joint_dof));
+        // Computed by the gravity task after the previous tick
+        output_joint_cmd_.torque += gravity_torque_;
+        if (gravity_period_ > 1.5 * controller_config_.controller_dt)
+            output_joint_cmd_.torque += gravity_torque_rate_ * std::min(timestamp - gravity_time_, gravity_period_);
     }
+    // Force feedback from a bilateral teleop follower
+    teleop_feedback_mailbox_.read(teleop_feedback_);
+    if (timestamp - teleop_feedback_.timestamp <= controller_config_.joint_torque_timeout)
+    {
+        output_joint_cmd_.torque += teleop_feedback_.torque;
+        double gripper_torque_limit = robot_config_.gripper_torque_max / 2; // Keep away from the over current check
+        gripper_torque_ff_ =
+            std::min(std::max(teleop_feedback_.gripper_torque, -gripper_torque_limit), gripper_torque_limit);
+        if (grasp_active)
+            gripper_torque_ff_ = 0.0; // Would add to the grasp torque
+    }
+    else
+        gripper_torque_ff_ = 0.0;
 
     // Joint pos clipping
+    int pos_clipped = 0;
+    int vel_clipped = 0;
+    int torque_clipped = 0;
     for (int i = 0; i < robot_config_.joint_dof; ++i)
     {
+        if (output_joint_cmd_.pos[i] < robot_config_.joint_pos_min[i] ||
+            output_joint_cmd_.pos[i] > robot_config_.joint_pos_max[i])
+        {
+            pos_clipped |= 1 << i;
+            if ((prev_pos_clipped_ & 1 << i) == 0)
+                event_bus_->publish(EventType::JOINT_POS_CLIPPED, timestamp, i, output_joint_cmd_.pos[i]);
+        }
         if (output_joint_cmd_.pos[i] < robot_config_.joint_pos_min[i])
         {
             logger_->debug("Joint {} pos {:.3f} pos cmd clipped from {:.3f} to min {:.3f}", i, joint_state_.pos[i],
@@ -459,6 +844,9 @@ void Arx5ControllerBase::update_output_cmd_()
                     new_pos = robot_config_.joint_pos_min[i];
                 logger_->debug("Joint velocity reaches limit: Joint {} pos {:.3f} pos cmd clipped: {:.3f} to {:.3f}", i,
                                joint_state_.pos[i], output_joint_cmd_.pos[i], new_pos);
+                vel_clipped |= 1 << i;
+                if ((prev_vel_clipped_ & 1 << i) == 0)
+                    event_bus_->publish(EventType::JOINT_VEL_CLIPPED, timestamp, i, output_joint_cmd_.pos[i]);
                 output_joint_cmd_.pos[i] = new_pos;
             }
         }
@@ -502,7 +890,8 @@ void Arx5ControllerBase::update_output_cmd_()
                            robot_config_.gripper_width);
         output_joint_cmd_.gripper_pos = robot_config_.gripper_width;
     }
-    if (std::abs(joint_state_.gripper_torque) > robot_config_.gripper_torque_max / 2)
+    // The grasp mode limits the gripper torque by itself
+    if (std::abs(joint_state_.gripper_torque) > robot_config_.gripper_torque_max / 2 && !grasp_active)
     {
         double sign = joint_state_.gripper_torque > 0 ? 1 : -1; // -1 for closing blocked, 1 for opening blocked
         double delta_pos =
@@ -510,7 +899,11 @@ void Arx5ControllerBase::update_output_cmd_()
         if (delta_pos * sign > 0)
         {
             if (prev_gripper_updated_)
+            {
                 logger_->warn("Gripper torque is too large, gripper pos cmd is not updated");
+                event_bus_->publish(EventType::GRIPPER_STALL, timestamp, robot_config_.joint_dof,
+                                    joint_state_.gripper_torque);
+            }
             output_joint_cmd_.gripper_pos = prev_output_cmd.gripper_pos;
             prev_gripper_updated_ = false;
         }
@@ -518,9 +911,18 @@ void Arx5ControllerBase::update_output_cmd_()
             prev_gripper_updated_ = true;
     }
 
+    if (collision_checker_ != nullptr && !gain_.kp.isZero())
+        collision_guard_(prev_output_cmd, collision_peer_checker, collision_peer_base_pose, peer_joint_pos);
+
     // Torque clipping
     for (int i = 0; i < robot_config_.joint_dof; ++i)
     {
+        if (std::abs(output_joint_cmd_.torque[i]) > robot_config_.joint_torque_max[i])
+        {
+            torque_clipped |= 1 << i;
+            if ((prev_torque_clipped_ & 1 << i) == 0)
+                event_bus_->publish(EventType::TORQUE_CLIPPED, timestamp, i, output_joint_cmd_.torque[i]);
+        }
         if (output_joint_cmd_.torque[i] > robot_config_.joint_torque_max[i])
         {
             logger_->debug("Joint {} torque cmd clipped from {:.3f} to max {:.3f}", i, output_joint_cmd_.torque[i],
@@ -534,6 +936,429 @@ void Arx5ControllerBase::update_output_cmd_()
             output_joint_cmd_.torque[i] = -robot_config_.joint_torque_max[i];
         }
     }
+    prev_pos_clipped_ = pos_clipped;
+    prev_vel_clipped_ = vel_clipped;
+    prev_torque_clipped_ = torque_clipped;
+}
+
+JointState Arx5ControllerBase::eef_interpolate_(double timestamp, const JointState &prev_output_cmd)
+{
+    double dt = controller_config_.controller_dt;
+    EEFStateSE3 target;
+    if (eef_twist_active_)
+    {
+        // The velocity ramps towards the twist, and down to zero once the twist is not refreshed in time
+        Pose6d target_twist = timestamp <= eef_twist_deadline_ ? eef_twist_ : Pose6d::Zero();
+        Eigen::Vector3d delta_lin = target_twist.head<3>() - eef_twist_vel_.head<3>();
+        Eigen::Vector3d delta_ang = target_twist.tail<3>() - eef_twist_vel_.tail<3>();
+        double max_delta_lin = controller_config_.eef_twist_lin_acc_max * dt;
+        double max_delta_ang = controller_config_.eef_twist_ang_acc_max * dt;
+        if (delta_lin.norm() > max_delta_lin)
+            delta_lin *= max_delta_lin / delta_lin.norm();
+        if (delta_ang.norm() > max_delta_ang)
+            delta_ang *= max_delta_ang / delta_ang.norm();
+        eef_twist_vel_.head<3>() += delta_lin;
+        eef_twist_vel_.tail<3>() += delta_ang;
+
+        target = eef_cmd_;
+        Eigen::Vector3d angular_vel = eef_twist_vel_.tail<3>();
+        target.pose.pos += eef_twist_vel_.head<3>() * dt;
+        if (angular_vel.norm() > 0)
+            target.pose.quat =
+                (Eigen::AngleAxisd(angular_vel.norm() * dt, angular_vel.normalized()) * target.pose.quat).normalized();
+        if (timestamp <= eef_twist_deadline_)
+            target.gripper_pos = std::max(0.0, std::min(robot_config_.gripper_width,
+                                                        target.gripper_pos + eef_twist_gripper_vel_ * dt));
+    }
+    else
+    {
+        target = eef_interpolator_.interpolate(timestamp);
+        check_traj_complete_(timestamp, eef_interpolator_.get_end_time());
+    }
+
+    // Limit the eef speed. Translation and rotation are scaled by the same ratio, so the pose stays on the
+    // interpolated path and only falls behind schedule.
+    Eigen::Vector3d delta_pos = target.pose.pos - eef_cmd_.pose.pos;
+    Eigen::AngleAxisd delta_rot(target.pose.quat * eef_cmd_.pose.quat.conjugate());
+    Eigen::Vector3d delta_rotvec = delta_rot.angle() * delta_rot.axis();
+    double ratio = 1.0;
+    for (int i = 0; i < 3; i++)
+    {
+        if (std::abs(delta_pos[i]) > robot_config_.ee_vel_max[i] * dt)
+            ratio = std::min(ratio, robot_config_.ee_vel_max[i] * dt / std::abs(delta_pos[i]));
+        if (std::abs(delta_rotvec[i]) > robot_config_.ee_vel_max[i + 3] * dt)
+            ratio = std::min(ratio, robot_config_.ee_vel_max[i + 3] * dt / std::abs(delta_rotvec[i]));
+    }
+    if (ratio < 1.0)
+        eef_cmd_.pose = eef_cmd_.pose.interpolate(target.pose, ratio);
+    else
+        eef_cmd_.pose = target.pose;
+    eef_cmd_.gripper_pos = target.gripper_pos;
+    eef_cmd_.timestamp = timestamp;
+
+    JointState joint_cmd{robot_config_.joint_dof};
+    joint_cmd.gripper_pos = eef_cmd_.gripper_pos;
+    joint_cmd.timestamp = timestamp;
+    // At REDUCED_RATE, the IK only runs every other tick and the joints keep their velocity in between. The IK of
+    // the next tick catches up with eef_cmd_.
+    if (load_level_ == LoadLevel::REDUCED_RATE && eef_ik_tick_++ % 2 == 1)
+    {
+        joint_cmd.pos = prev_output_cmd.pos + prev_output_cmd.vel * dt;
+        joint_cmd.vel = prev_output_cmd.vel;
+        return joint_cmd;
+    }
+
+    // Warm-started from the previous command, which is at most one tick of motion away
+    std::tuple<int, VecDoF> ik_results = differential_ik_->inverse_kinematics(eef_cmd_.pose, prev_output_cmd.pos);
+    bool tracking_ok = std::get<0>(ik_results) == 0;
+    if (!tracking_ok && prev_eef_tracking_ok_)
+    {
+        logger_->warn("Cartesian interpolation: pose {} cannot be tracked, it may be out of the workspace",
+                      vec2str(eef_cmd_.pose.to_pose_6d()));
+        event_bus_->publish(EventType::EEF_UNTRACKABLE, timestamp);
+    }
+    prev_eef_tracking_ok_ = tracking_ok;
+
+    joint_cmd.pos = std::get<1>(ik_results);
+    joint_cmd.vel = (joint_cmd.pos - prev_output_cmd.pos) / dt;
+    return joint_cmd;
+}
+
+JointState Arx5ControllerBase::joint_vel_integrate_(double timestamp, const JointState &prev_output_cmd)
+{
+    double dt = controller_config_.controller_dt;
+    // Dead-man: decelerate to zero once the command is not refreshed in time
+    VecDoF target_vel = VecDoF::Zero(robot_config_.joint_dof);
+    double target_gripper_vel = 0.0;
+    if (timestamp <= joint_vel_deadline_)
+    {
+        target_vel = joint_vel_cmd_.cwiseMax(-robot_config_.joint_vel_max).cwiseMin(robot_config_.joint_vel_max);
+        target_gripper_vel = joint_vel_gripper_cmd_;
+    }
+    double max_delta_vel = controller_config_.joint_acc_max * dt;
+    joint_vel_ += (target_vel - joint_vel_).cwiseMax(-max_delta_vel).cwiseMin(max_delta_vel);
+
+    JointState joint_cmd{robot_config_.joint_dof};
+    joint_cmd.pos = prev_output_cmd.pos + joint_vel_ * dt;
+    for (int i = 0; i < robot_config_.joint_dof; ++i)
+    {
+        // Stop at the joint limits instead of winding up the velocity
+        if (joint_cmd.pos[i] <= robot_config_.joint_pos_min[i] || joint_cmd.pos[i] >= robot_config_.joint_pos_max[i])
+        {
+            joint_cmd.pos[i] =
+                std::max(robot_config_.joint_pos_min[i], std::min(robot_config_.joint_pos_max[i], joint_cmd.pos[i]));
+            joint_vel_[i] = 0.0;
+        }
+    }
+    joint_cmd.vel = joint_vel_; // MIT velocity feedforward
+    joint_cmd.gripper_pos = std::max(
+        0.0, std::min(robot_config_.gripper_width, prev_output_cmd.gripper_pos + target_gripper_vel * dt));
+    joint_cmd.timestamp = timestamp;
+    return joint_cmd;
+}
+
+JointState Arx5ControllerBase::joint_torque_stream_(double timestamp, const JointState &prev_output_cmd)
+{
+    joint_torque_mailbox_.read(joint_torque_cmd_);
+    JointState joint_cmd = prev_output_cmd;
+    joint_cmd.vel.setZero();
+    joint_cmd.torque = joint_torque_cmd_.torque; // Gravity compensation is added afterwards if enabled
+    joint_cmd.timestamp = timestamp;
+    if (timestamp - joint_torque_cmd_.timestamp > controller_config_.joint_torque_timeout)
+    {
+        // Same as set_to_damping()
+        logger_->warn("Torque command is not refreshed for {:.3f}s, set to damping",
+                      timestamp - joint_torque_cmd_.timestamp);
+        event_bus_->publish(EventType::TORQUE_TIMEOUT, timestamp, -1, timestamp - joint_torque_cmd_.timestamp);
+        Gain damping_gain{robot_config_.joint_dof};
+        damping_gain.kd = controller_config_.default_kd;
+        gain_ = damping_gain;
+        joint_cmd.torque.setZero();
+        interpolator_.init_fixed(joint_cmd);
+        cmd_source_ = CmdSource::INTERPOLATOR;
+    }
+    return joint_cmd;
+}
+
+JointState Arx5ControllerBase::action_chunk_ensemble_(double timestamp, const JointState &prev_output_cmd)
+{
+    // Drop the chunks that have ended, but keep the newest one so that its last action is held
+    for (auto it = action_chunks_.begin(); it != action_chunks_.end() && action_chunks_.size() > 1;)
+    {
+        if (it->actions.back().timestamp < timestamp)
+            it = action_chunks_.erase(it);
+        else
+            ++it;
+    }
+
+    JointState joint_cmd{robot_config_.joint_dof};
+    double fade_time = controller_config_.chunk_fade_time;
+    double newest_observation_time = action_chunks_.back().observation_time;
+    double weight_sum = 0.0;
+    double fade_in_max = fade_time > 0 ? 0.0 : 1.0;
+    for (const ActionChunk &chunk : action_chunks_)
+    {
+        const std::vector<JointState> &actions = chunk.actions;
+        bool ended = timestamp >= actions.back().timestamp;
+        if (timestamp < actions.front().timestamp || (ended && &chunk != &action_chunks_.back()))
+            continue;
+        // Relative to the newest chunk, so that the exponential cannot overflow
+        double weight =
+            std::exp(controller_config_.chunk_ensemble_decay * (chunk.observation_time - newest_observation_time));
+        if (fade_time > 0)
+        {
+            double fade_in = std::max(0.0, std::min(1.0, (timestamp - chunk.arrival_time) / fade_time));
+            fade_in_max = std::max(fade_in_max, fade_in);
+            if (!ended)
+                weight *= std::max(std::min(fade_in, (actions.back().timestamp - timestamp) / fade_time), 1E-6);
+        }
+
+        // Linear interpolation between the two actions around the current time, velocity from their difference
+        auto next = std::upper_bound(actions.begin(), actions.end(), timestamp,
+                                     [](double t, const JointState &action) { return t < action.timestamp; });
+        if (next == actions.end())
+        {
+            joint_cmd.pos += weight * actions.back().pos;
+            joint_cmd.gripper_pos += weight * actions.back().gripper_pos;
+        }
+        else
+        {
+            const JointState &prev = *(next - 1);
+            double action_dt = next->timestamp - prev.timestamp;
+            double ratio = (timestamp - prev.timestamp) / action_dt;
+            joint_cmd.pos += weight * ((1 - ratio) * prev.pos + ratio * next->pos);
+            joint_cmd.vel += weight / action_dt * (next->pos - prev.pos);
+            joint_cmd.gripper_pos += weight * ((1 - ratio) * prev.gripper_pos + ratio * next->gripper_pos);
+        }
+        weight_sum += weight;
+    }
+    if (weight_sum == 0.0)
+    {
+        // No chunk has started yet
+        joint_cmd = prev_output_cmd;
+        joint_cmd.vel.setZero();
+        joint_cmd.torque.setZero();
+    }
+    else
+    {
+        joint_cmd.pos /= weight_sum;
+        joint_cmd.vel /= weight_sum;
+        joint_cmd.gripper_pos /= weight_sum;
+        // The previous command fills in for the chunks that are still fading in, so that a lone fresh chunk (the
+        // first one, or one after a gap) ramps in instead of jumping
+        joint_cmd.pos = fade_in_max * joint_cmd.pos + (1 - fade_in_max) * prev_output_cmd.pos;
+        joint_cmd.vel = fade_in_max * joint_cmd.vel + (1 - fade_in_max) * prev_output_cmd.vel;
+        joint_cmd.gripper_pos = fade_in_max * joint_cmd.gripper_pos + (1 - fade_in_max) * prev_output_cmd.gripper_pos;
+    }
+    joint_cmd.timestamp = timestamp;
+    return joint_cmd;
+}
+
+JointState Arx5ControllerBase::teleop_follow_(double timestamp, const JointState &prev_output_cmd,
+                                              const JointState &leader_state, double leader_state_age)
+{
+    JointState joint_cmd = prev_output_cmd;
+    joint_cmd.torque.setZero();
+    joint_cmd.timestamp = timestamp;
+    bool leader_ok = leader_state_age <= teleop_config_.leader_state_timeout;
+    if (!leader_ok && prev_teleop_leader_ok_)
+    {
+        logger_->warn("Teleop leader state is {:.3f}s old, holding the follower", leader_state_age);
+        event_bus_->publish(EventType::TELEOP_LEADER_LOST, timestamp, -1, leader_state_age);
+    }
+    prev_teleop_leader_ok_ = leader_ok;
+    if (!leader_ok)
+    {
+        joint_cmd.vel.setZero();
+        return joint_cmd;
+    }
+    // The joint velocity clipping afterwards also makes the follower catch up smoothly when the coupling starts
+    joint_cmd.pos = teleop_config_.joint_offset + teleop_config_.joint_scale.cwiseProduct(leader_state.pos);
+    joint_cmd.vel = teleop_config_.vel_feedforward * teleop_config_.joint_scale.cwiseProduct(leader_state.vel);
+    joint_cmd.gripper_pos =
+        (teleop_config_.gripper_offset +
+         teleop_config_.gripper_scale * leader_state.gripper_pos / teleop_leader_gripper_width_) *
+        robot_config_.gripper_width;
+    return joint_cmd;
+}
+
+void Arx5ControllerBase::teleop_reflect_(Arx5ControllerBase *leader, const JointState &leader_state,
+                                         double leader_state_age)
+{
+    if (teleop_config_.force_feedback_scale <= 0 && teleop_config_.gripper_force_feedback_scale <= 0)
+        return;
+    if (leader_state_age > teleop_config_.leader_state_timeout)
+        return; // The leader drops the feedback by itself once it is not refreshed
+    double dt = controller_config_.controller_dt;
+    // joint_state_ is only written by this thread, so it can be read without state_mutex_
+    VecDoF gravity_torque = solver_->inverse_dynamics(joint_state_.pos, VecDoF::Zero(robot_config_.joint_dof),
+                                                      VecDoF::Zero(robot_config_.joint_dof));
+    JointState &feedback = teleop_feedback_out_;
+    feedback.torque = -teleop_config_.force_feedback_scale *
+                      teleop_config_.joint_scale.cwiseProduct(joint_state_.torque - gravity_torque);
+
+    // Passivity observer: energy absorbed by the feedback from the leader. If it turns negative (the delayed feedback
+    // pushes the leader along its motion), damp the leader just enough to bring it back to zero.
+    double leader_vel_sq = leader_state.vel.squaredNorm();
+    double energy = teleop_feedback_energy_ - feedback.torque.dot(leader_state.vel) * dt;
+    if (energy < 0 && leader_vel_sq > 1E-8)
+    {
+        double damping = std::min(-energy / (leader_vel_sq * dt), teleop_config_.force_feedback_damping_max);
+        feedback.torque -= damping * leader_state.vel;
+        energy += damping * leader_vel_sq * dt;
+    }
+    teleop_feedback_energy_ = std::min(energy, teleop_config_.force_feedback_energy_max);
+
+    feedback.gripper_torque = -teleop_config_.gripper_force_feedback_scale * joint_state_.gripper_torque;
+    feedback.timestamp = leader->get_timestamp();
+    std::lock_guard<std::mutex> guard(leader->teleop_feedback_writer_mutex_);
+    leader->teleop_feedback_mailbox_.write(feedback);
+}
+
+void Arx5ControllerBase::resume_interpolator_()
+{
+    eef_twist_active_ = false;
+    if (cmd_source_ == CmdSource::INTERPOLATOR)
+        return;
+    JointState start_state = output_joint_cmd_;
+    start_state.vel = VecDoF::Zero(robot_config_.joint_dof);
+    start_state.torque = VecDoF::Zero(robot_config_.joint_dof); // Gravity compensation is added again every tick
+    start_state.timestamp = get_timestamp();
+    interpolator_.init_fixed(start_state);
+    cmd_source_ = CmdSource::INTERPOLATOR;
+}
+
+void Arx5ControllerBase::check_traj_complete_(double timestamp, double end_time)
+{
+    // A new trajectory (e.g. a waypoint in the future) is running until its end time, holding a state is not
+    if (end_time != traj_end_time_)
+    {
+        traj_end_time_ = end_time;
+        traj_running_ = end_time > timestamp;
+    }
+    if (traj_running_ && timestamp >= end_time)
+    {
+        event_bus_->publish(EventType::TRAJ_COMPLETE, timestamp, -1, end_time);
+        traj_running_ = false;
+    }
+}
+
+void Arx5ControllerBase::start_traj_handle_(std::shared_ptr<TrajHandle> handle, bool eef)
+{
+    if (traj_handle_ != nullptr)
+        traj_handle_->finish(TrajStatus::OVERRIDDEN);
+    traj_handle_ = handle;
+    traj_handle_eef_ = eef;
+    // All the waypoints were already in the past
+    if (handle->get_progress().waypoint_num == 0)
+    {
+        handle->finish(TrajStatus::COMPLETED);
+        traj_handle_.reset();
+    }
+}
+
+void Arx5ControllerBase::update_traj_handle_(double timestamp, const JointState &prev_output_cmd)
+{
+    if (traj_handle_ == nullptr)
+        return;
+    bool followed;
+    if (traj_handle_eef_)
+        followed = cmd_source_ == CmdSource::EEF && !eef_twist_active_ &&
+                   eef_interpolator_.get_end_time() == traj_handle_->get_end_time();
+    else
+        followed = cmd_source_ == CmdSource::INTERPOLATOR &&
+                   interpolator_.get_end_time() == traj_handle_->get_end_time();
+    if (!followed)
+    {
+        traj_handle_->finish(TrajStatus::OVERRIDDEN);
+        traj_handle_.reset();
+        return;
+    }
+    // joint_state_ is only written by this thread, so it can be read without state_mutex_. It was measured after
+    // prev_output_cmd was sent.
+    traj_handle_->update(timestamp, (joint_state_.pos - prev_output_cmd.pos).norm());
+    if (timestamp >= traj_handle_->get_end_time())
+    {
+        traj_handle_->finish(TrajStatus::COMPLETED);
+        traj_handle_.reset();
+    }
+}
+
+void Arx5ControllerBase::react_to_contact_(double timestamp)
+{
+    logger_->warn("Contact detected, external torque: {} Nm, reaction: {}", vec2str(contact_torque_),
+                  controller_config_.contact_reaction);
+    int contact_joint;
+    contact_torque_.cwiseAbs().maxCoeff(&contact_joint);
+    event_bus_->publish(EventType::CONTACT, timestamp, contact_joint, contact_torque_[contact_joint]);
+    if (controller_config_.contact_reaction == "none")
+        return;
+    // Hold the measured position rather than the command, so that the arm stops pushing against the obstacle
+    JointState hold_state{robot_config_.joint_dof};
+    hold_state.pos = contact_joint_pos_;
+    hold_state.gripper_pos = output_joint_cmd_.gripper_pos;
+    hold_state.timestamp = timestamp;
+    interpolator_.init_fixed(hold_state);
+    action_chunks_.clear();
+    cmd_source_ = CmdSource::INTERPOLATOR;
+    if (controller_config_.contact_reaction == "retract")
+    {
+        // Yield along the external torque, i.e. away from the obstacle
+        JointState retract_state = hold_state;
+        retract_state.pos += controller_config_.contact_retract_distance * contact_torque_.normalized();
+        retract_state.timestamp = timestamp + controller_config_.contact_retract_time;
+        interpolator_.init(hold_state, retract_state);
+    }
+    else if (controller_config_.contact_reaction == "damping")
+    {
+        gain_.kp = VecDoF::Zero(robot_config_.joint_dof);
+        gain_.kd = controller_config_.default_kd;
+        gain_.gripper_kp = 0.0;
+        gain_.gripper_kd = controller_config_.default_gripper_kd;
+    }
+}
+
+void Arx5ControllerBase::collision_guard_(const JointState &prev_output_cmd,
+                                          std::shared_ptr<Arx5CollisionChecker> peer_checker,
+                                          const Pose6d &peer_base_pose, const VecDoF &peer_joint_pos)
+{
+    // Motions that increase the distance are always allowed, so the arm can still leave a blocked configuration
+    auto min_distance = [&](const VecDoF &joint_pos) {
+        CollisionResult result = collision_checker_->self_distance(joint_pos);
+        if (peer_checker != nullptr && peer_joint_pos.size() > 0)
+        {
+            CollisionResult inter_arm_result =
+                collision_checker_->inter_arm_distance(joint_pos, peer_checker, peer_base_pose, peer_joint_pos);
+            if (inter_arm_result.distance < result.distance)
+                result = inter_arm_result;
+        }
+        return result;
+    };
+    CollisionResult result = min_distance(output_joint_cmd_.pos);
+    if (result.distance < controller_config_.collision_min_distance &&
+        result.distance < min_distance(prev_output_cmd.pos).distance)
+    {
+        if (!prev_collision_blocked_)
+        {
+            logger_->warn("Collision guard: distance between {} and {} is {:.3f}m, joint pos cmd is not updated",
+                          result.link_a, result.link_b, result.distance);
+            event_bus_->publish(EventType::COLLISION_BLOCKED, get_timestamp(), -1, result.distance);
+        }
+        output_joint_cmd_.pos = prev_output_cmd.pos;
+        output_joint_cmd_.vel = VecDoF::Zero(robot_config_.joint_dof); // No velocity feedforward into the obstacle
+        if (cmd_source_ == CmdSource::JOINT_VEL)
+        {
+            // Otherwise the integrated velocity would resume at full speed once unblocked. A new set_joint_vel is
+            // needed to move again.
+            std::lock_guard<std::mutex> guard(cmd_mutex_);
+            joint_vel_ = VecDoF::Zero(robot_config_.joint_dof);
+            joint_vel_cmd_ = VecDoF::Zero(robot_config_.joint_dof);
+            joint_vel_gripper_cmd_ = 0.0;
+        }
+        prev_collision_blocked_ = true;
+    }
+    else
+        prev_collision_blocked_ = false;
 }
 
 void Arx5ControllerBase::send_recv_()
@@ -544,6 +1369,7 @@ void Arx5ControllerBase::send_recv_()
     const double torque_constant_DM_J4310 = 0.424;
     const double torque_constant_DM_J4340 = 1.0;
     int start_time_us = get_time_us();
+    int pacing_time_us = 0;
 
     update_output_cmd_();
     int update_cmd_time_us = get_time_us();
@@ -581,6 +1407,7 @@ void Arx5ControllerBase::send_recv_()
         }
         int finish_send_motor_time_us = get_time_us();
         sleep_us(communicate_sleep_us - (finish_send_motor_time_us - start_send_motor_time_us));
+        pacing_time_us += get_time_us() - finish_send_motor_time_us;
     }
 
     // Send gripper command (gripper is using DM motor)
@@ -591,9 +1418,10 @@ void Arx5ControllerBase::send_recv_()
         double gripper_motor_pos =
             output_joint_cmd_.gripper_pos / robot_config_.gripper_width * robot_config_.gripper_open_readout;
         can_handle_.send_DM_motor_cmd(robot_config_.gripper_motor_id, gain_.gripper_kp, gain_.gripper_kd,
-                                      gripper_motor_pos, 0, 0);
+                                      gripper_motor_pos, 0, gripper_torque_ff_ / torque_constant_DM_J4310);
         int finish_send_motor_time_us = get_time_us();
         sleep_us(communicate_sleep_us - (finish_send_motor_time_us - start_send_motor_time_us));
+        pacing_time_us += get_time_us() - finish_send_motor_time_us;
     }
 
     // logger_->trace("update_cmd: {} us, send_motor_0: {} us, send_motor_1: {} us, send_motor_2: {} us, send_motor_3:
@@ -606,6 +1434,10 @@ void Arx5ControllerBase::send_recv_()
     //                get_motor_msg_time_us - start_get_motor_msg_time_us);
 
     update_joint_state_();
+    core_end_time_us_ = get_time_us();
+    pacing_time_us_ = pacing_time_us;
+    task_scheduler_->run(joint_state_.timestamp, (core_end_time_us_ - start_time_us - pacing_time_us) * 1e-6,
+                         pacing_time_us * 1e-6);
 }
 
 void Arx5ControllerBase::recv_()
@@ -657,6 +1489,9 @@ void Arx5ControllerBase::background_send_recv_()
             over_current_protection_();
             check_joint_state_sanity_();
             send_recv_();
+            // Only the computation: the CAN pacing is fixed and the tasks are budgeted by the task scheduler
+            int compute_time_us = core_end_time_us_ - start_time_us - pacing_time_us_;
+            update_load_level_(compute_time_us * 1e-6, pacing_time_us_ * 1e-6);
         }
         int elapsed_time_us = get_time_us() - start_time_us;
         int sleep_time_us = int(controller_config_.controller_dt * 1e6) - elapsed_time_us;
@@ -671,6 +1506,95 @@ void Arx5ControllerBase::background_send_recv_()
     }
 }
 
+void Arx5ControllerBase::update_load_level_(double compute_time, double pacing_time)
+{
+    bool overrun =
+        compute_time + pacing_time > controller_config_.controller_dt + controller_config_.overrun_tolerance;
+    {
+        std::lock_guard<std::mutex> guard(state_mutex_);
+        if (loop_stats_.count == 0)
+            loop_stats_.mean = compute_time;
+        else
+            loop_stats_.mean += LOOP_STATS_EMA_ALPHA_ * (compute_time - loop_stats_.mean);
+        loop_stats_.count++;
+        loop_stats_.last = compute_time;
+        loop_stats_.max = std::max(loop_stats_.max, compute_time);
+        if (overrun)
+            loop_stats_.overrun_count++;
+    }
+    if (controller_config_.load_shedding_max_level == 0)
+        return;
+    // One level at a time: a sustained overrun keeps escalating, a single late tick restarts the recovery
+    overrun_streak_ = overrun ? overrun_streak_ + 1 : 0;
+    on_time_streak_ = overrun ? 0 : on_time_streak_ + 1;
+    int level = int(load_level_.load());
+    int max_level = controller_config_.load_shedding_max_level;
+    if (overrun_streak_ >= controller_config_.overrun_escalate_cnt && level < max_level)
+    {
+        logger_->warn("Control loop overruns for {} ticks (computation {:.0f}us, CAN pacing {:.0f}us), load level "
+                      "raised to {}",
+                      overrun_streak_, get_loop_stats().mean * 1e6, pacing_time * 1e6, level + 1);
+        set_load_level_(LoadLevel(level + 1));
+        overrun_streak_ = 0;
+    }
+    else if (on_time_streak_ >= controller_config_.overrun_recover_cnt && level > 0)
+    {
+        logger_->warn("Control loop on time for {} ticks, load level lowered to {}", on_time_streak_, level - 1);
+        set_load_level_(LoadLevel(level - 1));
+        on_time_streak_ = 0;
+    }
+}
+
+void Arx5ControllerBase::set_load_level_(LoadLevel level)
+{
+    LoadLevel prev_level = load_level_;
+    if (level == LoadLevel::HOLD || prev_level == LoadLevel::HOLD)
+    {
+        // Hold the last command. Also when leaving HOLD, so that the commands sent meanwhile do not make the arm jump.
+        std::lock_guard<std::mutex> guard(cmd_mutex_);
+        JointState hold_state = output_joint_cmd_;
+        hold_state.vel = VecDoF::Zero(robot_config_.joint_dof);
+        hold_state.torque = VecDoF::Zero(robot_config_.joint_dof); // Gravity compensation is added again every tick
+        hold_state.timestamp = get_timestamp();
+        interpolator_.init_fixed(hold_state);
+        action_chunks_.clear();
+        cmd_source_ = CmdSource::INTERPOLATOR;
+    }
+    if (prev_level == LoadLevel::NORMAL)
+        logger_->set_level(std::max(log_level_.load(), spdlog::level::info));
+    else if (level == LoadLevel::NORMAL)
+        logger_->set_level(log_level_);
+    load_level_ = level;
+    event_bus_->publish(EventType::LOAD_LEVEL_CHANGED, get_timestamp(), -1, double(level));
+}
+
+void Arx5ControllerBase::update_gravity_torque_(double timestamp)
+{
+    // joint_state_ is only written by this thread, so it can be read without state_mutex_
+    VecDoF gravity_torque = solver_->inverse_dynamics(joint_state_.pos, VecDoF::Zero(robot_config_.joint_dof),
+                                                      VecDoF::Zero(robot_config_.joint_dof));
+    if (gravity_time_ > 0 && timestamp > gravity_time_)
+        gravity_torque_rate_ = (gravity_torque - gravity_torque_) / (timestamp - gravity_time_);
+    gravity_torque_ = gravity_torque;
+    gravity_time_ = timestamp;
+}
+
+void Arx5ControllerBase::update_diagnostics_(double timestamp)
+{
+    // get_diagnostics keeps the last published state meanwhile
+    if (load_level_ != LoadLevel::NORMAL)
+        return;
+    std::array<OD_Motor_Msg, 10> motor_msg = can_handle_.get_motor_msg();
+    diagnostics_buffer_.timestamp = timestamp;
+    diagnostics_buffer_.eef_pose = diagnostics_kinematics_->forward_kinematics(joint_state_.pos);
+    for (int i = 0; i < robot_config_.joint_dof; i++)
+        diagnostics_buffer_.motor_temperature[i] = motor_msg[robot_config_.motor_id[i]].temperature;
+    diagnostics_buffer_.motor_temperature[robot_config_.joint_dof] =
+        motor_msg[robot_config_.gripper_motor_id].temperature;
+    std::lock_guard<std::mutex> guard(state_mutex_);
+    diagnostics_ = diagnostics_buffer_; // Same sizes, copied without allocation
+}
+
 Pose6d Arx5ControllerBase::get_home_pose()
 {
     return solver_->forward_kinematics(VecDoF::Zero(robot_config_.joint_dof));
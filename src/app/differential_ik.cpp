@@ -0,0 +1,78 @@
+#include "app/differential_ik.h"
+#include "app/kdl_utils.h"
+#include <kdl/solveri.hpp>
+#include <stdexcept>
+
+namespace arx
+{
+
+Arx5DifferentialIk::Arx5DifferentialIk(std::string urdf_path, int joint_dof, Eigen::VectorXd joint_pos_min,
+                                       Eigen::VectorXd joint_pos_max, std::string base_link, std::string eef_link)
+    : JOINT_DOF_(joint_dof), JOINT_POS_MIN_(joint_pos_min), JOINT_POS_MAX_(joint_pos_max)
+{
+    chain_ = load_kdl_chain(urdf_path, base_link, eef_link);
+    if (int(chain_.getNrOfJoints()) != joint_dof)
+        throw std::invalid_argument("Joint dof " + std::to_string(joint_dof) + " does not match the urdf chain (" +
+                                    std::to_string(chain_.getNrOfJoints()) + " joints)");
+    if (joint_pos_min.size() != joint_dof || joint_pos_max.size() != joint_dof)
+        throw std::invalid_argument("Joint limits size does not match joint dof " + std::to_string(joint_dof));
+    fk_solver_ = std::make_shared<KDL::ChainFkSolverPos_recursive>(chain_);
+    jac_solver_ = std::make_shared<KDL::ChainJntToJacSolver>(chain_);
+    q_kdl_ = KDL::JntArray(joint_dof);
+    jac_ = KDL::Jacobian(joint_dof);
+}
+
+PoseSE3 Arx5DifferentialIk::forward_kinematics(Eigen::VectorXd joint_pos)
+{
+    if (joint_pos.size() != JOINT_DOF_)
+        throw std::invalid_argument("Joint position expected size " + std::to_string(JOINT_DOF_) + " but got " +
+                                    std::to_string(joint_pos.size()));
+    KDL::Frame frame;
+    q_kdl_.data = joint_pos;
+    fk_solver_->JntToCart(q_kdl_, frame);
+    return frame2se3(frame);
+}
+
+std::tuple<int, Eigen::VectorXd> Arx5DifferentialIk::inverse_kinematics(PoseSE3 target_pose,
+                                                                        Eigen::VectorXd current_joint_pos)
+{
+    if (current_joint_pos.size() != JOINT_DOF_)
+        throw std::invalid_argument("Inverse kinematics input expected size " + std::to_string(JOINT_DOF_) +
+                                    " but got " + std::to_string(current_joint_pos.size()));
+    KDL::Frame target = se32frame(target_pose);
+    Eigen::VectorXd q = current_joint_pos.cwiseMax(JOINT_POS_MIN_).cwiseMin(JOINT_POS_MAX_);
+    for (int iter = 0; iter <= MAXITER_; iter++)
+    {
+        KDL::Frame frame;
+        q_kdl_.data = q;
+        fk_solver_->JntToCart(q_kdl_, frame);
+        KDL::Twist twist = KDL::diff(frame, target);
+        Eigen::Matrix<double, 6, 1> error;
+        error << twist.vel.x(), twist.vel.y(), twist.vel.z(), twist.rot.x(), twist.rot.y(), twist.rot.z();
+        if (error.head<3>().norm() < POS_TOLERANCE_ && error.tail<3>().norm() < ORI_TOLERANCE_)
+            return std::make_tuple(int(KDL::SolverI::E_NOERROR), q);
+        if (iter == MAXITER_)
+            break;
+
+        jac_solver_->JntToJac(q_kdl_, jac_);
+        Eigen::Matrix<double, 6, Eigen::Dynamic> J = jac_.data;
+        Eigen::Matrix<double, 6, 6> JJt = J * J.transpose();
+        // Damping is only activated close to singularities, same as Arx5NullspaceIk
+        double manipulability = std::sqrt(std::max(JJt.determinant(), 0.0));
+        double damping_sq = 1E-8;
+        if (manipulability < MANIPULABILITY_THRESHOLD_)
+        {
+            double ratio = 1 - manipulability / MANIPULABILITY_THRESHOLD_;
+            damping_sq += DAMPING_ * DAMPING_ * ratio * ratio;
+        }
+        Eigen::VectorXd step =
+            J.transpose() * (JJt + damping_sq * Eigen::Matrix<double, 6, 6>::Identity()).ldlt().solve(error);
+        double step_norm = step.cwiseAbs().maxCoeff();
+        if (step_norm > MAX_STEP_)
+            step *= MAX_STEP_ / step_norm;
+        q = (q + step).cwiseMax(JOINT_POS_MIN_).cwiseMin(JOINT_POS_MAX_);
+    }
+    return std::make_tuple(int(KDL::SolverI::E_MAX_ITERATIONS_EXCEEDED), q);
+}
+
+} // namespace arx
@@ -0,0 +1,285 @@
+#include "app/event_bus.h"
+#include <chrono>
+#include <stdexcept>
+
+namespace arx
+{
+
+std::string event_type_name(EventType type)
+{
+    switch (type)
+    {
+    case EventType::OVER_CURRENT:
+        return "OVER_CURRENT";
+    case EventType::EMERGENCY:
+        return "EMERGENCY";
+    case EventType::GRIPPER_STALL:
+        return "GRIPPER_STALL";
+    case EventType::IK_FAILURE:
+        return "IK_FAILURE";
+    case EventType::EEF_UNTRACKABLE:
+        return "EEF_UNTRACKABLE";
+    case EventType::JOINT_POS_CLIPPED:
+        return "JOINT_POS_CLIPPED";
+    case EventType::JOINT_VEL_CLIPPED:
+        return "JOINT_VEL_CLIPPED";
+    case EventType::TORQUE_CLIPPED:
+        return "TORQUE_CLIPPED";
+    case EventType::COLLISION_BLOCKED:
+        return "COLLISION_BLOCKED";
+    case EventType::CONTACT:
+        return "CONTACT";
+    case EventType::TORQUE_TIMEOUT:
+        return "TORQUE_TIMEOUT";
+    case EventType::TELEOP_LEADER_LOST:
+        return "TELEOP_LEADER_LOST";
+    case EventType::TRAJ_COMPLETE:
+        return "TRAJ_COMPLETE";
+    case EventType::GRASPED:
+        return "GRASPED";
+    case EventType::GRASP_MISSED:
+        return "GRASP_MISSED";
+    case EventType::GRASP_SLIP:
+        return "GRASP_SLIP";
+    case EventType::LOAD_LEVEL_CHANGED:
+        return "LOAD_LEVEL_CHANGED";
+    case EventType::UNREACHABLE:
+        return "UNREACHABLE";
+    }
+    return "UNKNOWN";
+}
+
+EventListener::EventListener(int capacity) : CAPACITY_(capacity)
+{
+    if (capacity <= 0)
+        throw std::invalid_argument("Event listener capacity must be positive");
+}
+
+bool EventListener::next(Event &event, double timeout)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!cond_.wait_for(lock, std::chrono::duration<double>(timeout),
+                        [this] { return !events_.empty() || closed_; }) ||
+        events_.empty())
+        return false;
+    event = events_.front();
+    events_.pop_front();
+    return true;
+}
+
+void EventListener::close()
+{
+    std::lock_guard<std::mutex> guard(mutex_);
+    closed_ = true;
+    cond_.notify_all();
+}
+
+bool EventListener::is_closed()
+{
+    std::lock_guard<std::mutex> guard(mutex_);
+    return closed_;
+}
+
+long int EventListener::get_dropped_count()
+{
+    std::lock_guard<std::mutex> guard(mutex_);
+    return dropped_cnt_;
+}
+
+void EventListener::push(const Event &event)
+{
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (closed_)
+        return;
+    if (int(events_.size()) >= CAPACITY_)
+    {
+        events_.pop_front();
+        dropped_cnt_++;
+    }
+    events_.push_back(event);
+    cond_.notify_one();
+}
+
+static long int ring_capacity(int capacity)
+{
+    if (capacity <= 0)
+        throw std::invalid_argument("Event bus capacity must be positive");
+    long int ring_size = 1;
+    while (ring_size < capacity)
+        ring_size *= 2;
+    return ring_size;
+}
+
+EventBus::EventBus(std::shared_ptr<spdlog::logger> logger, int capacity)
+    : MASK_(ring_capacity(capacity) - 1), slots_(new Slot[MASK_ + 1]), logger_(logger)
+{
+    for (long int i = 0; i <= MASK_; i++)
+        slots_[i].turn.store(i, std::memory_order_relaxed);
+    sem_init(&event_sem_, 0, 0);
+    dispatch_thread_ = std::thread(&EventBus::dispatch_, this);
+}
+
+EventBus::~EventBus()
+{
+    stop_ = true;
+    sem_post(&event_sem_);
+    dispatch_thread_.join();
+    sem_destroy(&event_sem_);
+    for (const Subscriber &subscriber : *subscribers_)
+        if (subscriber.listener != nullptr)
+            subscriber.listener->close();
+}
+
+bool EventBus::publish(EventType type, double timestamp, int joint_id, double value)
+{
+    // Claim the slot at write_pos_ once the dispatch thread has released it (turn == pos)
+    long int pos = write_pos_.load(std::memory_order_relaxed);
+    Slot *slot;
+    while (true)
+    {
+        slot = &slots_[pos & MASK_];
+        long int diff = slot->turn.load(std::memory_order_acquire) - pos;
+        if (diff == 0)
+        {
+            if (write_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0)
+        {
+            dropped_cnt_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        else
+            pos = write_pos_.load(std::memory_order_relaxed);
+    }
+    slot->event.type = type;
+    slot->event.seq = pos; // In ring order, so increasing in delivery order
+    slot->event.timestamp = timestamp;
+    slot->event.joint_id = joint_id;
+    slot->event.value = value;
+    slot->turn.store(pos + 1, std::memory_order_release);
+    sem_post(&event_sem_);
+    return true;
+}
+
+// The subscriber list is never modified in place: the writers publish a new copy, which the dispatch thread picks up
+// on its next wake-up. Copying or freeing a Python callback takes the GIL, so the Python bindings call these without
+// the GIL, and the previous list is released after unlocking.
+
+int EventBus::subscribe(std::function<void(const Event &)> callback)
+{
+    std::shared_ptr<const std::vector<Subscriber>> prev_subscribers;
+    std::lock_guard<std::mutex> guard(subscriber_mutex_);
+    prev_subscribers = subscribers_;
+    std::vector<Subscriber> subscribers = *prev_subscribers;
+    subscribers.push_back(Subscriber{next_subscriber_id_, callback, nullptr});
+    subscribers_ = std::make_shared<const std::vector<Subscriber>>(std::move(subscribers));
+    return next_subscriber_id_++;
+}
+
+void EventBus::unsubscribe(int id)
+{
+    std::shared_ptr<const std::vector<Subscriber>> prev_subscribers;
+    std::lock_guard<std::mutex> guard(subscriber_mutex_);
+    prev_subscribers = subscribers_;
+    std::vector<Subscriber> subscribers;
+    subscribers.reserve(prev_subscribers->size());
+    for (const Subscriber &subscriber : *prev_subscribers)
+    {
+        if (subscriber.id != id)
+            subscribers.push_back(subscriber);
+        else if (subscriber.listener != nullptr)
+            subscriber.listener->close();
+    }
+    subscribers_ = std::make_shared<const std::vector<Subscriber>>(std::move(subscribers));
+}
+
+std::shared_ptr<EventListener> EventBus::listen(int capacity)
+{
+    std::shared_ptr<EventListener> listener = std::make_shared<EventListener>(capacity);
+    std::shared_ptr<const std::vector<Subscriber>> prev_subscribers;
+    std::lock_guard<std::mutex> guard(subscriber_mutex_);
+    prev_subscribers = subscribers_;
+    std::vector<Subscriber> subscribers = *prev_subscribers;
+    subscribers.push_back(Subscriber{next_subscriber_id_++, nullptr, listener});
+    subscribers_ = std::make_shared<const std::vector<Subscriber>>(std::move(subscribers));
+    return listener;
+}
+
+long int EventBus::get_dropped_count()
+{
+    return dropped_cnt_.load(std::memory_order_relaxed);
+}
+
+bool EventBus::pop_(Event &event)
+{
+    Slot &slot = slots_[read_pos_ & MASK_];
+    if (slot.turn.load(std::memory_order_acquire) != read_pos_ + 1)
+        return false;
+    event = slot.event;
+    // Release the slot for the producers of the next round
+    slot.turn.store(read_pos_ + MASK_ + 1, std::memory_order_release);
+    read_pos_++;
+    return true;
+}
+
+void EventBus::dispatch_()
+{
+    Event event;
+    std::shared_ptr<const std::vector<Subscriber>> subscribers;
+    while (true)
+    {
+        while (sem_wait(&event_sem_) != 0)
+            ; // Interrupted by a signal
+        if (stop_)
+            return;
+        // One post per published event, but a slot claimed earlier by a slower producer may still be being written:
+        // then the event is delivered on a later post
+        {
+            std::lock_guard<std::mutex> guard(subscriber_mutex_);
+            subscribers = subscribers_;
+        }
+        while (pop_(event))
+        {
+            for (const Subscriber &subscriber : *subscribers)
+            {
+                if (subscriber.listener != nullptr)
+                    subscriber.listener->push(event);
+                else
+                {
+                    // A failing callback must not stop the delivery to the others
+                    try
+                    {
+                        subscriber.callback(event);
+                    }
+                    catch (const std::exception &e)
+                    {
+                        logger_->error("Event callback {} failed on {}: {}", subscriber.id,
+                                       event_type_name(event.type), e.what());
+                    }
+                    catch (...)
+                    {
+                        logger_->error("Event callback {} failed on {}", subscriber.id, event_type_name(event.type));
+                    }
+                }
+            }
+        }
+        // Drop the closed listeners, only copying the list when there is one
+        subscribers = nullptr;
+        std::shared_ptr<const std::vector<Subscriber>> prev_subscribers;
+        std::lock_guard<std::mutex> guard(subscriber_mutex_);
+        prev_subscribers = subscribers_;
+        bool has_closed = false;
+        for (const Subscriber &subscriber : *prev_subscribers)
+            has_closed = has_closed || (subscriber.listener != nullptr && subscriber.listener->is_closed());
+        if (!has_closed)
+            continue;
+        std::vector<Subscriber> open_subscribers;
+        for (const Subscriber &subscriber : *prev_subscribers)
+            if (subscriber.listener == nullptr || !subscriber.listener->is_closed())
+                open_subscribers.push_back(subscriber);
+        subscribers_ = std::make_shared<const std::vector<Subscriber>>(std::move(open_subscribers));
+    }
+}
+
+} // namespace arx
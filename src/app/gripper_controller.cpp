@@ -0,0 +1,110 @@
+#include "app/gripper_controller.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace arx
+{
+
+GripperController::GripperController(RobotConfig robot_config, ControllerConfig controller_config,
+                                     std::shared_ptr<EventBus> event_bus)
+    : robot_config_(robot_config), controller_config_(controller_config), event_bus_(event_bus)
+{
+}
+
+void GripperController::grasp(double torque, double speed, double start_pos)
+{
+    // Stay below the stall check of the position mode and far from the over current protection
+    if (torque <= 0 || torque > robot_config_.gripper_torque_max / 2)
+        throw std::invalid_argument("Grasp torque must be between 0 and half of gripper_torque_max (" +
+                                    std::to_string(robot_config_.gripper_torque_max / 2) + " Nm)");
+    if (speed <= 0 || speed > robot_config_.gripper_vel_max)
+        throw std::invalid_argument("Grasp speed must be between 0 and gripper_vel_max (" +
+                                    std::to_string(robot_config_.gripper_vel_max) + " m/s)");
+    torque_ = torque;
+    speed_ = speed;
+    target_pos_ = start_pos;
+    contact_duration_ = 0.0;
+    grasp_width_ = 0.0;
+    state_ = GraspState::CLOSING;
+}
+
+void GripperController::release()
+{
+    state_ = GraspState::IDLE;
+    grasp_width_ = 0.0;
+}
+
+bool GripperController::is_active()
+{
+    return state_ != GraspState::IDLE;
+}
+
+double GripperController::update(double timestamp, double gripper_pos, double gripper_vel, double gripper_torque,
+                                 double gripper_kp)
+{
+    if (state_ == GraspState::IDLE)
+        return gripper_pos;
+    if (gripper_kp <= 0)
+        return gripper_pos; // The torque cannot be limited without a position gain, stay passive
+    // Position error (m) at which the motor pushes with torque_
+    double max_error = torque_ / gripper_kp * robot_config_.gripper_width / robot_config_.gripper_open_readout;
+    double dt = controller_config_.controller_dt;
+    // Closing pushes with a negative motor torque
+    double closing_torque = -gripper_torque;
+
+    if (state_ == GraspState::CLOSING)
+    {
+        target_pos_ = std::max(0.0, target_pos_ - speed_ * dt);
+        if (gripper_pos <= controller_config_.grasp_min_width)
+        {
+            state_ = GraspState::MISSED;
+            event_bus_->publish(EventType::GRASP_MISSED, timestamp, robot_config_.joint_dof, gripper_pos);
+        }
+        else if (std::abs(gripper_vel) < controller_config_.grasp_contact_vel &&
+                 closing_torque >= controller_config_.grasp_contact_ratio * torque_)
+        {
+            contact_duration_ += dt;
+            if (contact_duration_ >= controller_config_.grasp_contact_time)
+            {
+                state_ = GraspState::HOLDING;
+                grasp_width_ = gripper_pos;
+                slip_ref_width_ = gripper_pos;
+                event_bus_->publish(EventType::GRASPED, timestamp, robot_config_.joint_dof, gripper_pos);
+            }
+        }
+        else
+            contact_duration_ = 0.0;
+        if (state_ == GraspState::CLOSING)
+            return std::max(target_pos_, gripper_pos - max_error);
+    }
+    if (state_ == GraspState::HOLDING)
+    {
+        if (gripper_pos <= controller_config_.grasp_min_width)
+        {
+            state_ = GraspState::MISSED;
+            grasp_width_ = 0.0;
+            event_bus_->publish(EventType::GRASP_MISSED, timestamp, robot_config_.joint_dof, gripper_pos);
+        }
+        else if (slip_ref_width_ - gripper_pos > controller_config_.grasp_slip_distance)
+        {
+            event_bus_->publish(EventType::GRASP_SLIP, timestamp, robot_config_.joint_dof,
+                                slip_ref_width_ - gripper_pos);
+            slip_ref_width_ = gripper_pos;
+        }
+    }
+    // Squeeze with torque_ whatever the width
+    return std::max(0.0, gripper_pos - max_error);
+}
+
+GraspState GripperController::get_state()
+{
+    return state_;
+}
+
+double GripperController::get_grasp_width()
+{
+    return grasp_width_;
+}
+
+} // namespace arx
@@ -0,0 +1,388 @@
+#include "app/ik_portfolio.h"
+#include "app/kdl_utils.h"
+#include <algorithm>
+#include <kdl/chainiksolverpos_lma.hpp>
+#include <kdl/chainiksolverpos_nr_jl.hpp>
+#include <kdl/chainiksolvervel_pinv.hpp>
+#include <kdl/solveri.hpp>
+#include <random>
+#include <stdexcept>
+
+namespace arx
+{
+
+// ---------------------- SqpIkSolver ----------------------
+
+SqpIkSolver::SqpIkSolver(const KDL::Chain &chain, Eigen::VectorXd joint_pos_min, Eigen::VectorXd joint_pos_max,
+                         double eps, int max_iter)
+    : EPS_(eps), MAXITER_(max_iter), JOINT_DOF_(chain.getNrOfJoints()), JOINT_POS_MIN_(joint_pos_min),
+      JOINT_POS_MAX_(joint_pos_max), fk_solver_(chain), jac_solver_(chain), q_kdl_(chain.getNrOfJoints()),
+      jac_(chain.getNrOfJoints())
+{
+    if (joint_pos_min.size() != JOINT_DOF_ || joint_pos_max.size() != JOINT_DOF_)
+        throw std::invalid_argument("Joint limits size does not match the chain joint number " +
+                                    std::to_string(JOINT_DOF_));
+}
+
+Eigen::Matrix<double, 6, 1> SqpIkSolver::weighted_error_(const KDL::Frame &target, const Eigen::VectorXd &joint_pos)
+{
+    KDL::Frame frame;
+    q_kdl_.data = joint_pos;
+    fk_solver_.JntToCart(q_kdl_, frame);
+    KDL::Twist twist = KDL::diff(frame, target);
+    Eigen::Matrix<double, 6, 1> error;
+    error << twist.vel.x(), twist.vel.y(), twist.vel.z(), twist.rot.x(), twist.rot.y(), twist.rot.z();
+    return ERROR_WEIGHT_.cwiseProduct(error);
+}
+
+Eigen::VectorXd SqpIkSolver::solve_box_qp_(const Eigen::MatrixXd &H, const Eigen::VectorXd &g,
+                                           const Eigen::VectorXd &lower, const Eigen::VectorXd &upper)
+{
+    // Primal active-set method for: min 0.5 x^T H x + g^T x  s.t. lower <= x <= upper
+    // active[i]: 0 for free, -1 for fixed at lower bound, 1 for fixed at upper bound
+    int n = g.size();
+    std::vector<int> active(n, 0);
+    Eigen::VectorXd x = Eigen::VectorXd::Zero(n);
+    for (int iter = 0; iter < 3 * n; iter++)
+    {
+        std::vector<int> free_idx;
+        for (int i = 0; i < n; i++)
+        {
+            if (active[i] == 0)
+                free_idx.push_back(i);
+            else
+                x[i] = active[i] < 0 ? lower[i] : upper[i];
+        }
+        int nf = free_idx.size();
+        if (nf > 0)
+        {
+            Eigen::MatrixXd H_ff(nf, nf);
+            Eigen::VectorXd rhs(nf);
+            for (int a = 0; a < nf; a++)
+            {
+                rhs[a] = -g[free_idx[a]];
+                for (int i = 0; i < n; i++)
+                {
+                    if (active[i] != 0)
+                        rhs[a] -= H(free_idx[a], i) * x[i];
+                }
+                for (int b = 0; b < nf; b++)
+                    H_ff(a, b) = H(free_idx[a], free_idx[b]);
+            }
+            Eigen::VectorXd x_f = H_ff.ldlt().solve(rhs);
+            bool violated = false;
+            for (int a = 0; a < nf; a++)
+            {
+                int i = free_idx[a];
+                x[i] = x_f[a];
+                if (x[i] < lower[i])
+                {
+                    active[i] = -1;
+                    violated = true;
+                }
+                else if (x[i] > upper[i])
+                {
+                    active[i] = 1;
+                    violated = true;
+                }
+            }
+            if (violated)
+                continue;
+        }
+        // Release the constraint with the most negative multiplier, if any
+        Eigen::VectorXd grad = H * x + g;
+        int release_idx = -1;
+        double max_violation = 0;
+        for (int i = 0; i < n; i++)
+        {
+            double violation = active[i] < 0 ? -grad[i] : (active[i] > 0 ? grad[i] : 0);
+            if (violation > max_violation)
+            {
+                max_violation = violation;
+                release_idx = i;
+            }
+        }
+        if (release_idx < 0)
+            break;
+        active[release_idx] = 0;
+    }
+    return x.cwiseMax(lower).cwiseMin(upper);
+}
+
+int SqpIkSolver::solve(const KDL::Frame &target, const Eigen::VectorXd &init_joint_pos, Eigen::VectorXd &joint_pos,
+                       const std::atomic<bool> *cancel)
+{
+    if (init_joint_pos.size() != JOINT_DOF_)
+        return KDL::SolverI::E_SIZE_MISMATCH;
+    Eigen::VectorXd q = init_joint_pos.cwiseMax(JOINT_POS_MIN_).cwiseMin(JOINT_POS_MAX_);
+    Eigen::Matrix<double, 6, 1> error = weighted_error_(target, q);
+    double lambda = 1E-3;
+    for (int iter = 0; iter < MAXITER_; iter++)
+    {
+        joint_pos = q;
+        if (error.norm() < EPS_)
+            return KDL::SolverI::E_NOERROR;
+        if (cancel != nullptr && cancel->load())
+            return KDL::SolverI::E_NO_CONVERGE;
+
+        q_kdl_.data = q;
+        jac_solver_.JntToJac(q_kdl_, jac_);
+        Eigen::MatrixXd J = ERROR_WEIGHT_.asDiagonal() * jac_.data;
+        Eigen::MatrixXd H = J.transpose() * J + lambda * Eigen::MatrixXd::Identity(JOINT_DOF_, JOINT_DOF_);
+        Eigen::VectorXd g = -J.transpose() * error;
+        Eigen::VectorXd dq = solve_box_qp_(H, g, JOINT_POS_MIN_ - q, JOINT_POS_MAX_ - q);
+        if (dq.norm() < EPS_JOINTS_)
+            return KDL::SolverI::E_NO_CONVERGE;
+
+        Eigen::VectorXd new_q = q + dq;
+        Eigen::Matrix<double, 6, 1> new_error = weighted_error_(target, new_q);
+        if (new_error.norm() < error.norm())
+        {
+            q = new_q;
+            error = new_error;
+            lambda = std::max(lambda * 0.3, 1E-9);
+        }
+        else
+        {
+            lambda = std::min(lambda * 10, 1E3);
+        }
+    }
+    joint_pos = q;
+    return error.norm() < EPS_ ? KDL::SolverI::E_NOERROR : KDL::SolverI::E_MAX_ITERATIONS_EXCEEDED;
+}
+
+// ---------------------- Arx5IkPortfolio ----------------------
+
+Arx5IkPortfolio::Arx5IkPortfolio(std::string urdf_path, int joint_dof, Eigen::VectorXd joint_pos_min,
+                                 Eigen::VectorXd joint_pos_max, std::string base_link, std::string eef_link,
+                                 std::vector<std::string> solver_names)
+    : JOINT_DOF_(joint_dof), JOINT_POS_MIN_(joint_pos_min), JOINT_POS_MAX_(joint_pos_max),
+      solver_names_(solver_names)
+{
+    chain_ = load_kdl_chain(urdf_path, base_link, eef_link);
+    if (int(chain_.getNrOfJoints()) != joint_dof)
+        throw std::invalid_argument("Joint dof " + std::to_string(joint_dof) + " does not match the urdf chain (" +
+                                    std::to_string(chain_.getNrOfJoints()) + " joints)");
+    if (joint_pos_min.size() != joint_dof || joint_pos_max.size() != joint_dof)
+        throw std::invalid_argument("Joint limits size does not match joint dof " + std::to_string(joint_dof));
+    if (solver_names_.empty())
+        throw std::invalid_argument("IK portfolio needs at least one solver");
+    for (auto &name : solver_names_)
+    {
+        if (name != "lma" && name != "nr_jl" && name != "sqp")
+            throw std::invalid_argument("Invalid IK solver: " + name + ". Currently available: 'lma', 'nr_jl', 'sqp'");
+    }
+    reset_stats();
+    for (int i = 0; i < int(solver_names_.size()); i++)
+        workers_.push_back(std::thread(&Arx5IkPortfolio::worker_, this, i));
+}
+
+Arx5IkPortfolio::~Arx5IkPortfolio()
+{
+    {
+        std::lock_guard<std::mutex> guard(job_mutex_);
+        shutdown_ = true;
+        solved_ = true;
+    }
+    job_cv_.notify_all();
+    for (auto &worker : workers_)
+        worker.join();
+}
+
+std::tuple<int, Eigen::VectorXd> Arx5IkPortfolio::inverse_kinematics(Pose6d target_pose_6d,
+                                                                      Eigen::VectorXd current_joint_pos,
+                                                                      double timeout_s)
+{
+    return solve_(pose6d2frame(target_pose_6d), current_joint_pos, timeout_s);
+}
+
+std::tuple<int, Eigen::VectorXd> Arx5IkPortfolio::inverse_kinematics(PoseSE3 target_pose,
+                                                                      Eigen::VectorXd current_joint_pos,
+                                                                      double timeout_s)
+{
+    return solve_(se32frame(target_pose), current_joint_pos, timeout_s);
+}
+
+std::tuple<int, Eigen::VectorXd> Arx5IkPortfolio::solve_(const KDL::Frame &target_frame,
+                                                          const Eigen::VectorXd &current_joint_pos, double timeout_s)
+{
+    if (current_joint_pos.size() != JOINT_DOF_)
+        throw std::invalid_argument("Inverse kinematics input expected size " + std::to_string(JOINT_DOF_) +
+                                    " but got " + std::to_string(current_joint_pos.size()));
+    std::lock_guard<std::mutex> solve_guard(solve_mutex_);
+    {
+        std::lock_guard<std::mutex> guard(job_mutex_);
+        target_frame_ = target_frame;
+        seed_joint_pos_ = current_joint_pos;
+        deadline_us_ = get_time_us() + long(timeout_s * 1e6);
+        winner_ = -1;
+        winner_seeded_ = false;
+        solved_ = false;
+        pending_workers_ = workers_.size();
+        seeded_pending_workers_ = workers_.size();
+        job_id_++;
+    }
+    job_cv_.notify_all();
+
+    std::unique_lock<std::mutex> lock(job_mutex_);
+    done_cv_.wait(lock, [this] { return pending_workers_ == 0; });
+    if (winner_ >= 0)
+    {
+        stats_[winner_].wins++;
+        return std::make_tuple(int(KDL::SolverI::E_NOERROR), result_joint_pos_);
+    }
+    Eigen::VectorXd clipped_joint_pos = current_joint_pos.cwiseMax(JOINT_POS_MIN_).cwiseMin(JOINT_POS_MAX_);
+    return std::make_tuple(int(KDL::SolverI::E_NO_CONVERGE), clipped_joint_pos);
+}
+
+std::vector<IkSolverStats> Arx5IkPortfolio::get_stats()
+{
+    std::lock_guard<std::mutex> guard(job_mutex_);
+    return stats_;
+}
+
+void Arx5IkPortfolio::reset_stats()
+{
+    std::lock_guard<std::mutex> guard(job_mutex_);
+    stats_.clear();
+    for (auto &name : solver_names_)
+    {
+        IkSolverStats stats;
+        stats.name = name;
+        stats_.push_back(stats);
+    }
+    latency_sum_ms_ = std::vector<double>(solver_names_.size(), 0.0);
+}
+
+std::vector<std::string> Arx5IkPortfolio::get_solver_names()
+{
+    return solver_names_;
+}
+
+bool Arx5IkPortfolio::in_joint_limit_(const Eigen::VectorXd &joint_pos)
+{
+    // Inclusive: the box-constrained SQP clamps its solutions exactly onto the bounds
+    return ((JOINT_POS_MAX_ - joint_pos).array() >= 0).all() && ((JOINT_POS_MIN_ - joint_pos).array() <= 0).all();
+}
+
+bool Arx5IkPortfolio::accept_(KDL::ChainFkSolverPos_recursive &fk_solver, const KDL::Frame &target,
+                              const Eigen::VectorXd &joint_pos)
+{
+    if (!in_joint_limit_(joint_pos))
+        return false;
+    KDL::JntArray q(JOINT_DOF_);
+    q.data = joint_pos;
+    KDL::Frame frame;
+    fk_solver.JntToCart(q, frame);
+    KDL::Twist error = KDL::diff(frame, target);
+    double pos_error = Eigen::Vector3d(error.vel.x(), error.vel.y(), error.vel.z()).norm();
+    double ori_error = Eigen::Vector3d(error.rot.x(), error.rot.y(), error.rot.z()).norm();
+    return pos_error < POS_TOLERANCE_ && ori_error < ORI_TOLERANCE_;
+}
+
+void Arx5IkPortfolio::worker_(int worker_id)
+{
+    // KDL solvers are not thread-safe, so every worker owns its own solver instances
+    const std::string name = solver_names_[worker_id];
+    KDL::JntArray q_min(JOINT_DOF_), q_max(JOINT_DOF_);
+    q_min.data = JOINT_POS_MIN_;
+    q_max.data = JOINT_POS_MAX_;
+    KDL::ChainFkSolverPos_recursive fk_solver(chain_);
+    KDL::ChainIkSolverVel_pinv ik_vel_solver(chain_);
+    KDL::ChainIkSolverPos_LMA lma_solver(chain_, 1E-4, 50, 1E-10);
+    KDL::ChainIkSolverPos_NR_JL nr_jl_solver(chain_, q_min, q_max, fk_solver, ik_vel_solver, 100, 1E-5);
+    SqpIkSolver sqp_solver(chain_, JOINT_POS_MIN_, JOINT_POS_MAX_);
+
+    std::mt19937 rng(std::random_device{}() + worker_id);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    long int last_job_id = 0;
+
+    while (true)
+    {
+        KDL::Frame target;
+        Eigen::VectorXd init_joint_pos;
+        long int deadline_us;
+        {
+            std::unique_lock<std::mutex> lock(job_mutex_);
+            job_cv_.wait(lock, [&] { return shutdown_ || job_id_ != last_job_id; });
+            if (shutdown_)
+                return;
+            last_job_id = job_id_;
+            target = target_frame_;
+            init_joint_pos = seed_joint_pos_;
+            deadline_us = deadline_us_;
+        }
+
+        long int start_time_us = get_time_us();
+        bool found = false;
+        bool seeded = true; // The first trial starts from the current joint positions
+        const Eigen::VectorXd current_joint_pos = init_joint_pos;
+        Eigen::VectorXd joint_pos = init_joint_pos;
+        KDL::JntArray q_init(JOINT_DOF_), q_out(JOINT_DOF_);
+        while (!solved_.load() && get_time_us() < deadline_us)
+        {
+            int status;
+            if (name == "sqp")
+            {
+                status = sqp_solver.solve(target, init_joint_pos, joint_pos, &solved_);
+            }
+            else
+            {
+                q_init.data = init_joint_pos;
+                if (name == "lma")
+                    status = lma_solver.CartToJnt(q_init, target, q_out);
+                else
+                    status = nr_jl_solver.CartToJnt(q_init, target, q_out);
+                joint_pos = q_out.data;
+            }
+            if (status >= 0 && accept_(fk_solver, target, joint_pos))
+            {
+                found = true;
+                break;
+            }
+            if (seeded)
+            {
+                std::lock_guard<std::mutex> guard(job_mutex_);
+                seeded = false;
+                seeded_pending_workers_--;
+                if (seeded_pending_workers_ == 0 && winner_ >= 0)
+                    solved_ = true; // No seeded trial left, the nearest random restart solution wins
+            }
+            // Restart from a random seed within the joint limits
+            for (int j = 0; j < JOINT_DOF_; j++)
+                init_joint_pos[j] = JOINT_POS_MIN_[j] + uniform(rng) * (JOINT_POS_MAX_[j] - JOINT_POS_MIN_[j]);
+        }
+        double latency_ms = double(get_time_us() - start_time_us) / 1e3;
+
+        std::lock_guard<std::mutex> guard(job_mutex_);
+        IkSolverStats &stats = stats_[worker_id];
+        stats.attempts++;
+        if (found)
+        {
+            stats.successes++;
+            latency_sum_ms_[worker_id] += latency_ms;
+            stats.avg_latency_ms = latency_sum_ms_[worker_id] / stats.successes;
+            stats.max_latency_ms = std::max(stats.max_latency_ms, latency_ms);
+            double distance = (joint_pos - current_joint_pos).norm();
+            // A seeded solution beats any random restart one, otherwise the nearest one is kept
+            if (!winner_seeded_ && (seeded || winner_ < 0 || distance < winner_distance_))
+            {
+                winner_ = worker_id;
+                winner_seeded_ = seeded;
+                winner_distance_ = distance;
+                result_joint_pos_ = joint_pos;
+            }
+            if (seeded)
+                solved_ = true; // cancel the other workers
+        }
+        if (seeded)
+            seeded_pending_workers_--;
+        if (seeded_pending_workers_ == 0 && winner_ >= 0)
+            solved_ = true;
+        pending_workers_--;
+        if (pending_workers_ == 0)
+            done_cv_.notify_all();
+    }
+}
+
+} // namespace arx
@@ -23,12 +23,14 @@ Arx5JointController::Arx5JointController(std::string model, std::string interfac
 
 void Arx5JointController::set_joint_cmd(JointState new_cmd)
 {
+    new_cmd.timestamp = to_controller_time_(new_cmd.timestamp);
     JointState current_joint_state = get_joint_state();
     double current_time = get_timestamp();
     if (new_cmd.timestamp == 0)
         new_cmd.timestamp = current_time + controller_config_.default_preview_time;
 
     std::lock_guard<std::mutex> guard(cmd_mutex_);
+    resume_interpolator_();
     if (abs(new_cmd.timestamp - current_time) < 1e-3)
         // If the new timestamp is close enough (<1ms) to the current time
         // Will override the entire interpolator object
@@ -37,31 +39,134 @@ void Arx5JointController::set_joint_cmd(JointState new_cmd)
         interpolator_.override_waypoint(get_timestamp(), new_cmd);
 }
 
-void Arx5JointController::set_joint_traj(std::vector<JointState> new_traj)
+std::shared_ptr<TrajHandle> Arx5JointController::set_joint_traj(std::vector<JointState> new_traj)
 {
+    return set_joint_traj(JointTrajectory(new_traj));
+}
+
+std::shared_ptr<TrajHandle> Arx5JointController::set_joint_traj(const JointTrajectory &new_traj)
+{
+    new_traj.check();
+    if (new_traj.size() > 0 && new_traj.dof() != robot_config_.joint_dof)
+        throw std::invalid_argument("Joint trajectory expected size " + std::to_string(robot_config_.joint_dof) +
+                                    " but got " + std::to_string(new_traj.dof()));
+    {
+        std::lock_guard<std::mutex> guard(cmd_mutex_);
+        resume_interpolator_();
+    }
     double start_time = get_timestamp();
-    std::vector<JointState> joint_traj;
     double avg_window_s = 0.05;
-    joint_traj.push_back(interpolator_.interpolate(start_time - 2 * avg_window_s));
-    joint_traj.push_back(interpolator_.interpolate(start_time - avg_window_s));
-    joint_traj.push_back(interpolator_.interpolate(start_time));
+    JointTrajectory joint_traj{robot_config_.joint_dof, 3 + new_traj.size()};
+    joint_traj.set_state(0, interpolator_.interpolate(start_time - 2 * avg_window_s));
+    joint_traj.set_state(1, interpolator_.interpolate(start_time - avg_window_s));
+    joint_traj.set_state(2, interpolator_.interpolate(start_time));
 
+    int waypoint_num = 3;
     double prev_timestamp = 0;
-    for (auto joint_state : new_traj)
+    for (int i = 0; i < new_traj.size(); i++)
     {
-        if (joint_state.timestamp <= start_time)
+        double timestamp = to_controller_time_(new_traj.timestamps[i]);
+        if (timestamp <= start_time)
             continue;
-        if (joint_state.timestamp == 0)
+        if (timestamp == 0)
             throw std::invalid_argument("JointState timestamp must be set for all waypoints");
-        if (joint_state.timestamp <= prev_timestamp)
+        if (timestamp <= prev_timestamp)
             throw std::invalid_argument("JointState timestamps must be in ascending order");
-        joint_traj.push_back(joint_state);
-        prev_timestamp = joint_state.timestamp;
+        joint_traj.timestamps[waypoint_num] = timestamp;
+        joint_traj.pos.row(waypoint_num) = new_traj.pos.row(i);
+        joint_traj.vel.row(waypoint_num) = new_traj.vel.row(i);
+        joint_traj.torque.row(waypoint_num) = new_traj.torque.row(i);
+        joint_traj.gripper_pos[waypoint_num] = new_traj.gripper_pos[i];
+        waypoint_num++;
+        prev_timestamp = timestamp;
     }
-    calc_joint_vel(joint_traj, avg_window_s);
+    joint_traj.resize(waypoint_num);
+    calc_traj_vel_(joint_traj, 2, avg_window_s);
+    std::shared_ptr<TrajHandle> handle = std::make_shared<TrajHandle>(
+        std::vector<double>(joint_traj.timestamps.data() + 3, joint_traj.timestamps.data() + waypoint_num));
 
     std::lock_guard<std::mutex> guard(cmd_mutex_);
     interpolator_.override_traj(get_timestamp(), joint_traj);
+    start_traj_handle_(handle, false);
+    return handle;
+}
+
+void Arx5JointController::set_joint_vel(VecDoF joint_vel, double timeout, double gripper_vel)
+{
+    if (joint_vel.size() != robot_config_.joint_dof)
+        throw std::invalid_argument("Joint velocity expected size " + std::to_string(robot_config_.joint_dof) +
+                                    " but got " + std::to_string(joint_vel.size()));
+    if (timeout <= 0)
+        throw std::invalid_argument("Joint velocity timeout must be positive");
+    double current_time = get_timestamp();
+    std::lock_guard<std::mutex> guard(cmd_mutex_);
+    if (cmd_source_ != CmdSource::JOINT_VEL)
+    {
+        // Start from the velocity of the current command, so switching from a trajectory is smooth
+        joint_vel_ = output_joint_cmd_.vel;
+        cmd_source_ = CmdSource::JOINT_VEL;
+    }
+    joint_vel_cmd_ = joint_vel;
+    joint_vel_gripper_cmd_ =
+        std::max(-robot_config_.gripper_vel_max, std::min(robot_config_.gripper_vel_max, gripper_vel));
+    joint_vel_deadline_ = current_time + timeout;
+}
+
+void Arx5JointController::set_joint_torque(VecDoF joint_torque)
+{
+    if (joint_torque.size() != robot_config_.joint_dof)
+        throw std::invalid_argument("Joint torque expected size " + std::to_string(robot_config_.joint_dof) +
+                                    " but got " + std::to_string(joint_torque.size()));
+    JointState torque_cmd{robot_config_.joint_dof};
+    torque_cmd.torque = joint_torque;
+    torque_cmd.timestamp = get_timestamp();
+    {
+        std::lock_guard<std::mutex> writer_guard(joint_torque_writer_mutex_);
+        joint_torque_mailbox_.write(torque_cmd);
+    }
+    // Only the first command of a stream takes cmd_mutex_
+    if (cmd_source_ != CmdSource::JOINT_TORQUE)
+    {
+        std::lock_guard<std::mutex> guard(cmd_mutex_);
+        cmd_source_ = CmdSource::JOINT_TORQUE;
+    }
+}
+
+void Arx5JointController::submit_action_chunk(std::vector<JointState> chunk, double observation_timestamp,
+                                              double action_dt)
+{
+    if (chunk.empty())
+        throw std::invalid_argument("Action chunk must not be empty");
+    if (action_dt <= 0)
+        throw std::invalid_argument("Action chunk action_dt must be positive");
+    observation_timestamp = to_controller_time_(observation_timestamp);
+    ActionChunk action_chunk;
+    for (int i = 0; i < int(chunk.size()); ++i)
+    {
+        if (chunk[i].pos.size() != robot_config_.joint_dof)
+            throw std::invalid_argument("Action chunk joint position expected size " +
+                                        std::to_string(robot_config_.joint_dof) + " but got " +
+                                        std::to_string(chunk[i].pos.size()));
+        chunk[i].timestamp = observation_timestamp + i * action_dt;
+    }
+    double current_time = get_timestamp();
+    if (chunk.back().timestamp < current_time)
+        logger_->warn("Action chunk arrived {:.3f}s after its last action, only the last action is used",
+                      current_time - chunk.back().timestamp);
+    action_chunk.actions = std::move(chunk);
+    action_chunk.observation_time = observation_timestamp;
+    action_chunk.arrival_time = current_time;
+    clock_domain_->record_latency(observation_timestamp, "controller");
+
+    std::lock_guard<std::mutex> guard(cmd_mutex_);
+    if (cmd_source_ != CmdSource::CHUNK)
+    {
+        action_chunks_.clear();
+        cmd_source_ = CmdSource::CHUNK;
+    }
+    action_chunks_.push_back(std::move(action_chunk));
+    while (action_chunks_.size() > size_t(std::max(controller_config_.chunk_max_num, 1)))
+        action_chunks_.pop_front();
 }
 
 void Arx5JointController::recv_once()
@@ -0,0 +1,49 @@
+#include "app/kdl_utils.h"
+#include <stdexcept>
+
+namespace arx
+{
+
+KDL::Chain load_kdl_chain(std::string urdf_path, std::string base_link, std::string eef_link)
+{
+    KDL::Tree tree;
+    if (!kdl_parser::treeFromFile(urdf_path, tree))
+        throw std::runtime_error("Failed to parse urdf file: " + urdf_path);
+    KDL::Chain chain;
+    if (!tree.getChain(base_link, eef_link, chain))
+        throw std::runtime_error("Failed to get chain from " + base_link + " to " + eef_link + " in " + urdf_path);
+    return chain;
+}
+
+KDL::Frame pose6d2frame(const Pose6d &pose_6d)
+{
+    return KDL::Frame(KDL::Rotation::RPY(pose_6d[3], pose_6d[4], pose_6d[5]),
+                      KDL::Vector(pose_6d[0], pose_6d[1], pose_6d[2]));
+}
+
+Pose6d frame2pose6d(const KDL::Frame &frame)
+{
+    Pose6d pose_6d;
+    pose_6d[0] = frame.p.x();
+    pose_6d[1] = frame.p.y();
+    pose_6d[2] = frame.p.z();
+    frame.M.GetRPY(pose_6d[3], pose_6d[4], pose_6d[5]);
+    return pose_6d;
+}
+
+KDL::Frame se32frame(const PoseSE3 &pose)
+{
+    return KDL::Frame(KDL::Rotation::Quaternion(pose.quat.x(), pose.quat.y(), pose.quat.z(), pose.quat.w()),
+                      KDL::Vector(pose.pos[0], pose.pos[1], pose.pos[2]));
+}
+
+PoseSE3 frame2se3(const KDL::Frame &frame)
+{
+    Eigen::Matrix3d rot;
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++)
+            rot(i, j) = frame.M(i, j);
+    return PoseSE3(Eigen::Vector3d(frame.p.x(), frame.p.y(), frame.p.z()), rot);
+}
+
+} // namespace arx
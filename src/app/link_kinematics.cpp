@@ -0,0 +1,119 @@
+#include "app/link_kinematics.h"
+#include "app/kdl_utils.h"
+#include <stdexcept>
+
+namespace arx
+{
+
+Arx5LinkKinematics::Arx5LinkKinematics(std::string urdf_path, int joint_dof, std::string base_link,
+                                       std::string eef_link)
+    : JOINT_DOF_(joint_dof)
+{
+    chain_ = load_kdl_chain(urdf_path, base_link, eef_link);
+    if (int(chain_.getNrOfJoints()) != joint_dof)
+        throw std::invalid_argument("Joint dof " + std::to_string(joint_dof) + " does not match the urdf chain (" +
+                                    std::to_string(chain_.getNrOfJoints()) + " joints)");
+    int joint_id = 0;
+    for (unsigned int s = 0; s < chain_.getNrOfSegments(); s++)
+    {
+        const KDL::Segment &segment = chain_.getSegment(s);
+        link_names_.push_back(segment.getName());
+        if (segment.getJoint().getType() == KDL::Joint::None)
+        {
+            joint_ids_.push_back(-1);
+            fixed_poses_.push_back(segment.pose(0.0));
+        }
+        else
+        {
+            joint_ids_.push_back(joint_id++);
+            fixed_poses_.push_back(KDL::Frame::Identity());
+        }
+    }
+    frames_.resize(chain_.getNrOfSegments());
+}
+
+void Arx5LinkKinematics::check_joint_pos_(const VecDoF &joint_pos)
+{
+    if (joint_pos.size() != JOINT_DOF_)
+        throw std::invalid_argument("Joint position expected size " + std::to_string(JOINT_DOF_) + " but got " +
+                                    std::to_string(joint_pos.size()));
+}
+
+const std::vector<KDL::Frame> &Arx5LinkKinematics::link_frames(const VecDoF &joint_pos)
+{
+    if (cache_valid_ && joint_pos.size() == cached_joint_pos_.size() && joint_pos == cached_joint_pos_)
+        return frames_;
+    check_joint_pos_(joint_pos);
+    KDL::Frame frame = KDL::Frame::Identity();
+    for (size_t s = 0; s < frames_.size(); s++)
+    {
+        if (joint_ids_[s] < 0)
+            frame = frame * fixed_poses_[s];
+        else
+            frame = frame * chain_.getSegment(s).pose(joint_pos[joint_ids_[s]]);
+        frames_[s] = frame;
+    }
+    cached_joint_pos_ = joint_pos;
+    cache_valid_ = true;
+    return frames_;
+}
+
+PoseSE3 Arx5LinkKinematics::forward_kinematics(VecDoF joint_pos)
+{
+    return frame2se3(link_frames(joint_pos).back());
+}
+
+void Arx5LinkKinematics::write_transform_(const KDL::Frame &frame, double *row)
+{
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < 3; j++)
+            row[i * 4 + j] = frame.M(i, j);
+        row[i * 4 + 3] = frame.p(i);
+    }
+    row[12] = row[13] = row[14] = 0.0;
+    row[15] = 1.0;
+}
+
+Eigen::Matrix<double, Eigen::Dynamic, 16, Eigen::RowMajor> Arx5LinkKinematics::link_transforms(VecDoF joint_pos)
+{
+    const std::vector<KDL::Frame> &frames = link_frames(joint_pos);
+    Eigen::Matrix<double, Eigen::Dynamic, 16, Eigen::RowMajor> transforms(frames.size(), 16);
+    for (size_t l = 0; l < frames.size(); l++)
+        write_transform_(frames[l], transforms.row(l).data());
+    return transforms;
+}
+
+Eigen::Matrix<double, Eigen::Dynamic, 16, Eigen::RowMajor> Arx5LinkKinematics::batch_link_transforms(
+    Eigen::MatrixXd joint_pos)
+{
+    if (joint_pos.cols() != JOINT_DOF_)
+        throw std::invalid_argument("Joint position batch expected " + std::to_string(JOINT_DOF_) +
+                                    " columns but got " + std::to_string(joint_pos.cols()));
+    int link_num = frames_.size();
+    Eigen::Matrix<double, Eigen::Dynamic, 16, Eigen::RowMajor> transforms(joint_pos.rows() * link_num, 16);
+    for (int n = 0; n < joint_pos.rows(); n++)
+    {
+        const std::vector<KDL::Frame> &frames = link_frames(joint_pos.row(n).transpose());
+        for (int l = 0; l < link_num; l++)
+            write_transform_(frames[l], transforms.row(n * link_num + l).data());
+    }
+    return transforms;
+}
+
+std::vector<std::string> Arx5LinkKinematics::get_link_names()
+{
+    return link_names_;
+}
+
+int Arx5LinkKinematics::get_link_num()
+{
+    return link_names_.size();
+}
+
+int Arx5LinkKinematics::get_joint_dof()
+{
+    return JOINT_DOF_;
+}
+
+} // namespace arx
@@ -0,0 +1,71 @@
+#include "app/momentum_observer.h"
+#include "app/kdl_utils.h"
+#include <stdexcept>
+
+namespace arx
+{
+
+Arx5MomentumObserver::Arx5MomentumObserver(std::string urdf_path, int joint_dof, std::string base_link,
+                                           std::string eef_link, Eigen::Vector3d gravity_vector, double gain)
+    : JOINT_DOF_(joint_dof), GAIN_(gain), joint_pos_(joint_dof), joint_vel_(joint_dof), coriolis_(joint_dof),
+      gravity_(joint_dof), mass_(joint_dof), prev_mass_(joint_dof), momentum_(VecDoF::Zero(joint_dof)),
+      initial_momentum_(VecDoF::Zero(joint_dof)), integral_(VecDoF::Zero(joint_dof)),
+      mass_change_(VecDoF::Zero(joint_dof)), residual_(VecDoF::Zero(joint_dof))
+{
+    if (gain <= 0)
+        throw std::invalid_argument("Momentum observer gain must be positive");
+    chain_ = load_kdl_chain(urdf_path, base_link, eef_link);
+    if (int(chain_.getNrOfJoints()) != joint_dof)
+        throw std::invalid_argument("Joint dof " + std::to_string(joint_dof) + " does not match the urdf chain (" +
+                                    std::to_string(chain_.getNrOfJoints()) + " joints)");
+    dyn_param_ = std::make_shared<KDL::ChainDynParam>(
+        chain_, KDL::Vector(gravity_vector[0], gravity_vector[1], gravity_vector[2]));
+}
+
+void Arx5MomentumObserver::reset()
+{
+    initialized_ = false;
+    residual_.setZero();
+}
+
+const VecDoF &Arx5MomentumObserver::update(double timestamp, const VecDoF &joint_pos, const VecDoF &joint_vel,
+                                           const VecDoF &joint_torque)
+{
+    if (joint_pos.size() != JOINT_DOF_ || joint_vel.size() != JOINT_DOF_ || joint_torque.size() != JOINT_DOF_)
+        throw std::invalid_argument("Momentum observer expected joint states of size " + std::to_string(JOINT_DOF_));
+    double dt = timestamp - timestamp_;
+    if (initialized_ && dt <= 0)
+        return residual_;
+    if (dt > MAX_DT_)
+        initialized_ = false;
+
+    joint_pos_.data = joint_pos;
+    joint_vel_.data = joint_vel;
+    dyn_param_->JntToMass(joint_pos_, mass_);
+    momentum_.noalias() = mass_.data * joint_vel;
+    timestamp_ = timestamp;
+    if (!initialized_)
+    {
+        initial_momentum_ = momentum_;
+        integral_.setZero();
+        residual_.setZero();
+        prev_mass_.data = mass_.data;
+        initialized_ = true;
+        return residual_;
+    }
+    dyn_param_->JntToCoriolis(joint_pos_, joint_vel_, coriolis_);
+    dyn_param_->JntToGravity(joint_pos_, gravity_);
+    mass_change_.noalias() = mass_.data * joint_vel;
+    mass_change_.noalias() -= prev_mass_.data * joint_vel;
+    integral_ += dt * (joint_torque - coriolis_.data - gravity_.data + residual_) + mass_change_;
+    residual_ = GAIN_ * (momentum_ - initial_momentum_ - integral_);
+    prev_mass_.data = mass_.data;
+    return residual_;
+}
+
+const VecDoF &Arx5MomentumObserver::get_external_torque()
+{
+    return residual_;
+}
+
+} // namespace arx
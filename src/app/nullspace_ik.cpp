@@ -0,0 +1,147 @@
+#include "app/nullspace_ik.h"
+#include "app/kdl_utils.h"
+#include <kdl/solveri.hpp>
+#include <stdexcept>
+
+namespace arx
+{
+
+Arx5NullspaceIk::Arx5NullspaceIk(std::string urdf_path, int joint_dof, Eigen::VectorXd joint_pos_min,
+                                 Eigen::VectorXd joint_pos_max, std::string base_link, std::string eef_link)
+    : JOINT_DOF_(joint_dof), JOINT_POS_MIN_(joint_pos_min), JOINT_POS_MAX_(joint_pos_max)
+{
+    chain_ = load_kdl_chain(urdf_path, base_link, eef_link);
+    if (int(chain_.getNrOfJoints()) != joint_dof)
+        throw std::invalid_argument("Joint dof " + std::to_string(joint_dof) + " does not match the urdf chain (" +
+                                    std::to_string(chain_.getNrOfJoints()) + " joints)");
+    if (joint_pos_min.size() != joint_dof || joint_pos_max.size() != joint_dof)
+        throw std::invalid_argument("Joint limits size does not match joint dof " + std::to_string(joint_dof));
+    fk_solver_ = std::make_shared<KDL::ChainFkSolverPos_recursive>(chain_);
+    jac_solver_ = std::make_shared<KDL::ChainJntToJacSolver>(chain_);
+    q_kdl_ = KDL::JntArray(joint_dof);
+    jac_ = KDL::Jacobian(joint_dof);
+}
+
+void Arx5NullspaceIk::set_weights(NullspaceIkWeights weights)
+{
+    if (weights.joint_limit < 0 || weights.manipulability < 0 || weights.previous < 0)
+        throw std::invalid_argument("Nullspace IK weights must be non-negative");
+    weights_ = weights;
+}
+
+NullspaceIkWeights Arx5NullspaceIk::get_weights()
+{
+    return weights_;
+}
+
+Eigen::Matrix<double, 6, Eigen::Dynamic> Arx5NullspaceIk::jacobian_(const Eigen::VectorXd &joint_pos)
+{
+    q_kdl_.data = joint_pos;
+    jac_solver_->JntToJac(q_kdl_, jac_);
+    return jac_.data;
+}
+
+double Arx5NullspaceIk::manipulability(Eigen::VectorXd joint_pos)
+{
+    if (joint_pos.size() != JOINT_DOF_)
+        throw std::invalid_argument("Joint position expected size " + std::to_string(JOINT_DOF_) + " but got " +
+                                    std::to_string(joint_pos.size()));
+    Eigen::Matrix<double, 6, Eigen::Dynamic> J = jacobian_(joint_pos);
+    return std::sqrt(std::max((J * J.transpose()).determinant(), 0.0));
+}
+
+Eigen::VectorXd Arx5NullspaceIk::objective_gradient_(const Eigen::VectorXd &joint_pos,
+                                                     const Eigen::VectorXd &reference_joint_pos,
+                                                     double current_manipulability)
+{
+    // H(q) = w_jl / n * sum(((q - q_mid) / q_range)^2) + w_prev * ||q - q_ref||^2 - w_manip * m(q)
+    Eigen::VectorXd joint_range = JOINT_POS_MAX_ - JOINT_POS_MIN_;
+    Eigen::VectorXd joint_mid = (JOINT_POS_MAX_ + JOINT_POS_MIN_) / 2;
+    Eigen::VectorXd gradient = weights_.joint_limit * 2.0 / JOINT_DOF_ *
+                               (joint_pos - joint_mid).cwiseQuotient(joint_range.cwiseProduct(joint_range));
+    gradient += weights_.previous * 2.0 * (joint_pos - reference_joint_pos);
+    if (weights_.manipulability > 0)
+    {
+        // Numerical gradient of the manipulability
+        const double h = 1E-6;
+        for (int i = 0; i < JOINT_DOF_; i++)
+        {
+            Eigen::VectorXd perturbed_joint_pos = joint_pos;
+            perturbed_joint_pos[i] += h;
+            gradient[i] -= weights_.manipulability * (manipulability(perturbed_joint_pos) - current_manipulability) / h;
+        }
+    }
+    return gradient;
+}
+
+std::tuple<int, Eigen::VectorXd> Arx5NullspaceIk::inverse_kinematics(Pose6d target_pose_6d,
+                                                                     Eigen::VectorXd current_joint_pos)
+{
+    return solve_(pose6d2frame(target_pose_6d), current_joint_pos);
+}
+
+std::tuple<int, Eigen::VectorXd> Arx5NullspaceIk::inverse_kinematics(PoseSE3 target_pose,
+                                                                     Eigen::VectorXd current_joint_pos)
+{
+    return solve_(se32frame(target_pose), current_joint_pos);
+}
+
+std::tuple<int, Eigen::VectorXd> Arx5NullspaceIk::solve_(const KDL::Frame &target,
+                                                         const Eigen::VectorXd &current_joint_pos)
+{
+    if (current_joint_pos.size() != JOINT_DOF_)
+        throw std::invalid_argument("Inverse kinematics input expected size " + std::to_string(JOINT_DOF_) +
+                                    " but got " + std::to_string(current_joint_pos.size()));
+    Eigen::VectorXd q = current_joint_pos.cwiseMax(JOINT_POS_MIN_).cwiseMin(JOINT_POS_MAX_);
+    Eigen::MatrixXd identity = Eigen::MatrixXd::Identity(JOINT_DOF_, JOINT_DOF_);
+    bool pose_converged = false;
+
+    for (int iter = 0; iter < MAXITER_; iter++)
+    {
+        KDL::Frame frame;
+        q_kdl_.data = q;
+        fk_solver_->JntToCart(q_kdl_, frame);
+        KDL::Twist twist = KDL::diff(frame, target);
+        Eigen::Matrix<double, 6, 1> error;
+        error << twist.vel.x(), twist.vel.y(), twist.vel.z(), twist.rot.x(), twist.rot.y(), twist.rot.z();
+        pose_converged = error.head<3>().norm() < POS_TOLERANCE_ && error.tail<3>().norm() < ORI_TOLERANCE_;
+
+        Eigen::Matrix<double, 6, Eigen::Dynamic> J = jacobian_(q);
+        Eigen::Matrix<double, 6, 6> JJt = J * J.transpose();
+        double current_manipulability = std::sqrt(std::max(JJt.determinant(), 0.0));
+
+        // Damped pseudo-inverse, damping is only activated close to singularities
+        double damping_sq = 1E-8;
+        if (current_manipulability < MANIPULABILITY_THRESHOLD_)
+        {
+            double ratio = 1 - current_manipulability / MANIPULABILITY_THRESHOLD_;
+            damping_sq += DAMPING_ * DAMPING_ * ratio * ratio;
+        }
+        Eigen::MatrixXd J_pinv =
+            J.transpose() * (JJt + damping_sq * Eigen::Matrix<double, 6, 6>::Identity()).ldlt().solve(
+                                Eigen::Matrix<double, 6, 6>::Identity());
+
+        Eigen::VectorXd gradient = objective_gradient_(q, current_joint_pos, current_manipulability);
+        Eigen::VectorXd nullspace_step = -NULLSPACE_GAIN_ * (identity - J_pinv * J) * gradient;
+        if (pose_converged && nullspace_step.norm() < NULLSPACE_TOLERANCE_)
+            return std::make_tuple(int(KDL::SolverI::E_NOERROR), q);
+
+        Eigen::VectorXd step = J_pinv * error + nullspace_step;
+        double step_norm = step.cwiseAbs().maxCoeff();
+        if (step_norm > MAX_STEP_)
+            step *= MAX_STEP_ / step_norm;
+        q = (q + step).cwiseMax(JOINT_POS_MIN_).cwiseMin(JOINT_POS_MAX_);
+    }
+    // The secondary objectives may not have fully converged, which is fine as long as the pose is reached
+    KDL::Frame frame;
+    q_kdl_.data = q;
+    fk_solver_->JntToCart(q_kdl_, frame);
+    KDL::Twist twist = KDL::diff(frame, target);
+    pose_converged = Eigen::Vector3d(twist.vel.x(), twist.vel.y(), twist.vel.z()).norm() < POS_TOLERANCE_ &&
+                     Eigen::Vector3d(twist.rot.x(), twist.rot.y(), twist.rot.z()).norm() < ORI_TOLERANCE_;
+    if (pose_converged)
+        return std::make_tuple(int(KDL::SolverI::E_NOERROR), q);
+    return std::make_tuple(int(KDL::SolverI::E_MAX_ITERATIONS_EXCEEDED), q);
+}
+
+} // namespace arx
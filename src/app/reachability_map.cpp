@@ -0,0 +1,278 @@
+#include "app/reachability_map.h"
+#include "app/kdl_utils.h"
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <kdl/chainfksolverpos_recursive.hpp>
+#include <random>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+namespace arx
+{
+
+namespace
+{
+const char REACHABILITY_MAP_MAGIC[8] = "ARXRMAP";
+const uint32_t REACHABILITY_MAP_VERSION = 1;
+static_assert(sizeof(ReachabilityMapHeader) == 80, "ReachabilityMapHeader should not contain padding");
+
+int orientation_bin_num(const ReachabilityMapHeader &header)
+{
+    return 6 * header.ori_resolution * header.ori_resolution;
+}
+
+// First column of Rz(yaw) * Ry(pitch) * Rx(roll)
+Eigen::Vector3d x_axis_of(const Pose6d &pose_6d)
+{
+    return Eigen::Vector3d(std::cos(pose_6d[5]) * std::cos(pose_6d[4]), std::sin(pose_6d[5]) * std::cos(pose_6d[4]),
+                           -std::sin(pose_6d[4]));
+}
+
+// Cube-map bin of the eef x axis direction
+int orientation_bin(const ReachabilityMapHeader &header, const Eigen::Vector3d &x_axis)
+{
+    int axis;
+    x_axis.cwiseAbs().maxCoeff(&axis);
+    int face = axis * 2 + (x_axis[axis] < 0 ? 1 : 0);
+    int k = header.ori_resolution;
+    double u = x_axis[(axis + 1) % 3] / std::abs(x_axis[axis]); // in [-1, 1]
+    double w = x_axis[(axis + 2) % 3] / std::abs(x_axis[axis]);
+    int iu = std::min(std::max(int((u + 1) / 2 * k), 0), k - 1);
+    int iw = std::min(std::max(int((w + 1) / 2 * k), 0), k - 1);
+    return (face * k + iu) * k + iw;
+}
+
+// Returns -1 if the position is out of the voxel grid
+long int voxel_index(const ReachabilityMapHeader &header, const Eigen::Vector3d &pos)
+{
+    long int voxel[3];
+    for (int i = 0; i < 3; i++)
+    {
+        double v = std::floor((pos[i] - header.origin[i]) / header.voxel_size);
+        if (v < 0 || v >= header.dims[i])
+            return -1;
+        voxel[i] = long(v);
+    }
+    return (voxel[0] * header.dims[1] + voxel[1]) * header.dims[2] + voxel[2];
+}
+
+long int cell_index(const ReachabilityMapHeader &header, const Eigen::Vector3d &pos, const Eigen::Vector3d &x_axis)
+{
+    long int voxel = voxel_index(header, pos);
+    if (voxel < 0)
+        return -1;
+    return voxel * orientation_bin_num(header) + orientation_bin(header, x_axis);
+}
+} // namespace
+
+ReachabilityMap::ReachabilityMap(std::string map_path) : map_path_(map_path)
+{
+    int fd = open(map_path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("Cannot open reachability map: " + map_path);
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0 || file_stat.st_size < long(sizeof(ReachabilityMapHeader)))
+    {
+        close(fd);
+        throw std::runtime_error("Invalid reachability map: " + map_path);
+    }
+    data_size_ = file_stat.st_size;
+    data_ = mmap(nullptr, data_size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data_ == MAP_FAILED)
+    {
+        data_ = nullptr;
+        throw std::runtime_error("Failed to mmap reachability map: " + map_path);
+    }
+
+    header_ = static_cast<const ReachabilityMapHeader *>(data_);
+    uint64_t expected_cell_num =
+        uint64_t(header_->dims[0]) * header_->dims[1] * header_->dims[2] * orientation_bin_num(*header_);
+    size_t expected_size = sizeof(ReachabilityMapHeader) + header_->cell_num * sizeof(int32_t) +
+                           header_->seed_num * header_->joint_dof * sizeof(float);
+    if (std::memcmp(header_->magic, REACHABILITY_MAP_MAGIC, sizeof(REACHABILITY_MAP_MAGIC)) != 0 ||
+        header_->version != REACHABILITY_MAP_VERSION || header_->cell_num != expected_cell_num ||
+        data_size_ != expected_size)
+    {
+        munmap(data_, data_size_);
+        data_ = nullptr;
+        throw std::runtime_error("Reachability map is corrupted or has an incompatible version: " + map_path);
+    }
+    index_ = reinterpret_cast<const int32_t *>(static_cast<const char *>(data_) + sizeof(ReachabilityMapHeader));
+    seeds_ = reinterpret_cast<const float *>(index_ + header_->cell_num);
+    // The lookups index the seeds without bounds checks, so every seed row has to be within the file
+    for (uint64_t cell = 0; cell < header_->cell_num; cell++)
+    {
+        if (index_[cell] >= 0 && uint64_t(index_[cell]) >= header_->seed_num)
+        {
+            munmap(data_, data_size_);
+            data_ = nullptr;
+            throw std::runtime_error("Reachability map is corrupted (seed row " + std::to_string(index_[cell]) +
+                                     " out of " + std::to_string(header_->seed_num) + "): " + map_path);
+        }
+    }
+}
+
+ReachabilityMap::~ReachabilityMap()
+{
+    if (data_ != nullptr)
+        munmap(data_, data_size_);
+}
+
+long int ReachabilityMap::cell_index_(const Eigen::Vector3d &pos, const Eigen::Vector3d &x_axis)
+{
+    return cell_index(*header_, pos, x_axis);
+}
+
+bool ReachabilityMap::is_reachable(Pose6d pose_6d)
+{
+    long int cell = cell_index_(pose_6d.head<3>(), x_axis_of(pose_6d));
+    return cell >= 0 && index_[cell] >= 0;
+}
+
+bool ReachabilityMap::is_reachable(PoseSE3 pose)
+{
+    long int cell = cell_index_(pose.pos, pose.quat * Eigen::Vector3d::UnitX());
+    return cell >= 0 && index_[cell] >= 0;
+}
+
+bool ReachabilityMap::get_seed(Pose6d pose_6d, Eigen::VectorXd &seed)
+{
+    return get_seed_(cell_index_(pose_6d.head<3>(), x_axis_of(pose_6d)), seed);
+}
+
+bool ReachabilityMap::get_seed(PoseSE3 pose, Eigen::VectorXd &seed)
+{
+    return get_seed_(cell_index_(pose.pos, pose.quat * Eigen::Vector3d::UnitX()), seed);
+}
+
+bool ReachabilityMap::get_seed_(long int cell, Eigen::VectorXd &seed)
+{
+    if (cell < 0 || index_[cell] < 0)
+        return false;
+    const float *row = seeds_ + long(index_[cell]) * header_->joint_dof;
+    seed.resize(header_->joint_dof);
+    for (int j = 0; j < int(header_->joint_dof); j++)
+        seed[j] = row[j];
+    return true;
+}
+
+int ReachabilityMap::get_joint_dof()
+{
+    return header_->joint_dof;
+}
+
+std::string ReachabilityMap::get_path()
+{
+    return map_path_;
+}
+
+void ReachabilityMap::generate(std::string urdf_path, int joint_dof, Eigen::VectorXd joint_pos_min,
+                               Eigen::VectorXd joint_pos_max, std::string base_link, std::string eef_link,
+                               std::string output_path, double voxel_size, int ori_resolution, long int sample_num)
+{
+    if (voxel_size <= 0 || ori_resolution <= 0 || sample_num <= 0)
+        throw std::invalid_argument("voxel_size, ori_resolution and sample_num must be positive");
+    KDL::Chain chain = load_kdl_chain(urdf_path, base_link, eef_link);
+    if (int(chain.getNrOfJoints()) != joint_dof)
+        throw std::invalid_argument("Joint dof " + std::to_string(joint_dof) + " does not match the urdf chain (" +
+                                    std::to_string(chain.getNrOfJoints()) + " joints)");
+    KDL::ChainFkSolverPos_recursive fk_solver(chain);
+    KDL::JntArray q(joint_dof);
+    KDL::Frame frame;
+    std::mt19937 rng(0); // Deterministic, so the same urdf always generates the same map
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    Eigen::VectorXd joint_range = joint_pos_max - joint_pos_min;
+    auto sample = [&]() {
+        for (int j = 0; j < joint_dof; j++)
+            q(j) = joint_pos_min[j] + uniform(rng) * joint_range[j];
+        fk_solver.JntToCart(q, frame);
+        return frame2pose6d(frame);
+    };
+
+    // Workspace bounding box from a subset of the samples, with two voxels of margin on each side
+    Eigen::Vector3d bbox_min = Eigen::Vector3d::Constant(1e9);
+    Eigen::Vector3d bbox_max = Eigen::Vector3d::Constant(-1e9);
+    for (long int s = 0; s < std::min(sample_num, 20000L); s++)
+    {
+        Pose6d pose_6d = sample();
+        bbox_min = bbox_min.cwiseMin(pose_6d.head<3>());
+        bbox_max = bbox_max.cwiseMax(pose_6d.head<3>());
+    }
+    ReachabilityMapHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, REACHABILITY_MAP_MAGIC, sizeof(REACHABILITY_MAP_MAGIC));
+    header.version = REACHABILITY_MAP_VERSION;
+    header.joint_dof = joint_dof;
+    header.ori_resolution = ori_resolution;
+    header.voxel_size = voxel_size;
+    for (int i = 0; i < 3; i++)
+    {
+        header.origin[i] = bbox_min[i] - 2 * voxel_size;
+        header.dims[i] = uint32_t(std::ceil((bbox_max[i] - bbox_min[i]) / voxel_size)) + 4;
+    }
+    int bin_num = orientation_bin_num(header);
+    header.cell_num = uint64_t(header.dims[0]) * header.dims[1] * header.dims[2] * bin_num;
+
+    // Keep the sample with the largest joint limit margin as the seed of each cell
+    std::vector<int32_t> index(header.cell_num, -1);
+    std::vector<float> seeds;
+    std::vector<double> seed_margins;
+    for (long int s = 0; s < sample_num; s++)
+    {
+        Pose6d pose_6d = sample();
+        long int cell = cell_index(header, pose_6d.head<3>(), x_axis_of(pose_6d));
+        if (cell < 0)
+            continue;
+        Eigen::VectorXd joint_margin = (q.data - joint_pos_min).cwiseMin(joint_pos_max - q.data);
+        double margin = joint_margin.cwiseQuotient(joint_range).minCoeff();
+        if (index[cell] < 0)
+        {
+            index[cell] = seed_margins.size();
+            seed_margins.push_back(margin);
+            for (int j = 0; j < joint_dof; j++)
+                seeds.push_back(q(j));
+        }
+        else if (margin > seed_margins[index[cell]])
+        {
+            seed_margins[index[cell]] = margin;
+            for (int j = 0; j < joint_dof; j++)
+                seeds[long(index[cell]) * joint_dof + j] = q(j);
+        }
+    }
+
+    // Dilate by one voxel (same orientation bin) to compensate for the sampling sparsity
+    std::vector<int32_t> dilated_index = index;
+    long int stride[3] = {long(header.dims[1]) * header.dims[2] * bin_num, long(header.dims[2]) * bin_num, bin_num};
+    for (long int cell = 0; cell < long(header.cell_num); cell++)
+    {
+        if (index[cell] >= 0)
+            continue;
+        long int voxel = cell / bin_num;
+        long int coords[3] = {voxel / (long(header.dims[1]) * header.dims[2]),
+                              (voxel / header.dims[2]) % header.dims[1], voxel % header.dims[2]};
+        for (int axis = 0; axis < 3 && dilated_index[cell] < 0; axis++)
+        {
+            if (coords[axis] > 0 && index[cell - stride[axis]] >= 0)
+                dilated_index[cell] = index[cell - stride[axis]];
+            else if (coords[axis] < header.dims[axis] - 1 && index[cell + stride[axis]] >= 0)
+                dilated_index[cell] = index[cell + stride[axis]];
+        }
+    }
+    header.seed_num = seed_margins.size();
+
+    std::ofstream file(output_path, std::ios::binary | std::ios::trunc);
+    if (!file)
+        throw std::runtime_error("Cannot write reachability map: " + output_path);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(dilated_index.data()), dilated_index.size() * sizeof(int32_t));
+    file.write(reinterpret_cast<const char *>(seeds.data()), seeds.size() * sizeof(float));
+    if (!file)
+        throw std::runtime_error("Failed to write reachability map: " + output_path);
+}
+
+} // namespace arx
@@ -0,0 +1,93 @@
+#include "app/task_scheduler.h"
+#include "app/common.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace arx
+{
+
+TaskScheduler::TaskScheduler(double tick_dt, double budget) : TICK_DT_(tick_dt), BUDGET_(budget)
+{
+    if (tick_dt <= 0)
+        throw std::invalid_argument("Task scheduler tick must be positive");
+    core_stats_.name = "core";
+    core_stats_.period = tick_dt;
+}
+
+void TaskScheduler::add_task(std::string name, double period, int priority, std::function<void(double)> task)
+{
+    if (priority < 0)
+        throw std::invalid_argument("Task priority must be non-negative");
+    Task new_task;
+    new_task.period_ticks = std::max(1, int(std::round(period / TICK_DT_)));
+    new_task.stats.name = name;
+    new_task.stats.period = new_task.period_ticks * TICK_DT_;
+    new_task.stats.priority = priority;
+    int same_period_num = std::count_if(tasks_.begin(), tasks_.end(), [&](const Task &t) {
+        return t.period_ticks == new_task.period_ticks;
+    });
+    new_task.next_tick = same_period_num % new_task.period_ticks;
+    new_task.task = task;
+    auto it = std::upper_bound(tasks_.begin(), tasks_.end(), priority,
+                               [](int p, const Task &t) { return p < t.stats.priority; });
+    tasks_.insert(it, new_task);
+}
+
+void TaskScheduler::run(double timestamp, double core_time, double pacing_time)
+{
+    record_(core_stats_, core_time);
+    double elapsed_time = core_time + pacing_time;
+    for (Task &task : tasks_)
+    {
+        if (tick_ < task.next_tick)
+            continue;
+        {
+            std::lock_guard<std::mutex> guard(stats_mutex_);
+            if (task.stats.priority > 0 && elapsed_time + task.stats.mean > BUDGET_)
+            {
+                task.stats.deferred_count++;
+                continue;
+            }
+        }
+        int start_time_us = get_time_us();
+        task.task(timestamp);
+        int duration_us = get_time_us() - start_time_us;
+        double duration = duration_us * 1e-6;
+        elapsed_time += duration;
+        record_(task.stats, duration);
+        task.next_tick = tick_ + task.period_ticks;
+    }
+    tick_++;
+}
+
+std::vector<TaskStats> TaskScheduler::get_stats()
+{
+    std::lock_guard<std::mutex> guard(stats_mutex_);
+    std::vector<TaskStats> stats{core_stats_};
+    for (const Task &task : tasks_)
+        stats.push_back(task.stats);
+    return stats;
+}
+
+void TaskScheduler::reset_stats()
+{
+    std::lock_guard<std::mutex> guard(stats_mutex_);
+    core_stats_ = TaskStats{core_stats_.name, core_stats_.period, core_stats_.priority};
+    for (Task &task : tasks_)
+        task.stats = TaskStats{task.stats.name, task.stats.period, task.stats.priority};
+}
+
+void TaskScheduler::record_(TaskStats &stats, double duration)
+{
+    std::lock_guard<std::mutex> guard(stats_mutex_);
+    if (stats.count == 0)
+        stats.mean = duration;
+    else
+        stats.mean += STATS_EMA_ALPHA_ * (duration - stats.mean);
+    stats.count++;
+    stats.last = duration;
+    stats.max = std::max(stats.max, duration);
+}
+
+} // namespace arx
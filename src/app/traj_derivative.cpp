@@ -0,0 +1,259 @@
+#include "app/traj_derivative.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace arx
+{
+
+TrajDerivative::TrajDerivative(int dof, std::string method, double avg_window_s)
+    : dof_(dof), method_(method), avg_window_s_(avg_window_s), start_vel_(VecDoF::Zero(dof)),
+      end_vel_(VecDoF::Zero(dof))
+{
+    check_method(method);
+    if (avg_window_s <= 0)
+        throw std::invalid_argument("Velocity averaging window must be positive");
+    reserve(16);
+}
+
+void TrajDerivative::check_method(std::string method)
+{
+    if (method != "window" && method != "spline")
+        throw std::invalid_argument("Invalid trajectory velocity method: " + method +
+                                    ". Currently available: 'window' or 'spline'");
+}
+
+void TrajDerivative::reserve(int waypoint_num)
+{
+    if (waypoint_num <= timestamps_.size())
+        return;
+    timestamps_.conservativeResize(waypoint_num);
+    pos_.conservativeResize(dof_, waypoint_num);
+    vel_.conservativeResize(dof_, waypoint_num);
+    acc_.conservativeResize(dof_, waypoint_num);
+    sweep_c_.conservativeResize(waypoint_num);
+    sweep_d_.conservativeResize(dof_, waypoint_num);
+}
+
+void TrajDerivative::clear()
+{
+    size_ = 0;
+    vel_valid_ = 0;
+    sweep_valid_ = 0;
+    spline_valid_ = false;
+    acc_valid_ = false;
+}
+
+void TrajDerivative::set_boundary_vel(const VecDoF &start_vel, const VecDoF &end_vel)
+{
+    if (start_vel.size() != dof_ || end_vel.size() != dof_)
+        throw std::invalid_argument("Boundary velocity expected size " + std::to_string(dof_));
+    start_vel_ = start_vel;
+    end_vel_ = end_vel;
+    sweep_valid_ = 0;
+    spline_valid_ = false;
+    acc_valid_ = false;
+}
+
+void TrajDerivative::append(double timestamp, Eigen::Ref<const Eigen::VectorXd> pos)
+{
+    if (pos.size() != dof_)
+        throw std::invalid_argument("Waypoint position expected size " + std::to_string(dof_) + " but got " +
+                                    std::to_string(pos.size()));
+    if (size_ > 0 && timestamp <= timestamps_[size_ - 1])
+        throw std::invalid_argument("Trajectory timestamps must be in strictly ascending order");
+    if (size_ == timestamps_.size())
+        reserve(2 * size_);
+    // The windows reaching the previous end are clamped to it and change with the new waypoint
+    if (size_ >= 2)
+        vel_valid_ = std::min(vel_valid_, lower_bound_(timestamps_[size_ - 2] - avg_window_s_));
+    else
+        vel_valid_ = 0;
+    timestamps_[size_] = timestamp;
+    pos_.col(size_) = pos;
+    size_++;
+    // The previous last waypoint was clamped to end_vel_ and is now swept as an interior one
+    sweep_valid_ = std::min(sweep_valid_, std::max(size_ - 2, 0));
+    spline_valid_ = false;
+    acc_valid_ = false;
+}
+
+void TrajDerivative::assign(const Eigen::VectorXd &timestamps, Eigen::Ref<const Eigen::MatrixXd> pos)
+{
+    if (pos.rows() != dof_ || pos.cols() != timestamps.size())
+        throw std::invalid_argument("Trajectory positions expected " + std::to_string(dof_) + " rows and " +
+                                    std::to_string(timestamps.size()) + " columns");
+    clear();
+    reserve(timestamps.size());
+    for (int i = 0; i < timestamps.size(); i++)
+        append(timestamps[i], pos.col(i));
+}
+
+void TrajDerivative::assign(const std::vector<JointState> &traj)
+{
+    clear();
+    reserve(traj.size());
+    for (const JointState &joint_state : traj)
+        append(joint_state.timestamp, joint_state.pos);
+}
+
+void TrajDerivative::assign(const JointTrajectory &traj)
+{
+    // The transpose of the row-major positions is a column per waypoint, without copy
+    assign(traj.timestamps, traj.pos.transpose());
+}
+
+void TrajDerivative::get_traj_vel(std::vector<JointState> &traj)
+{
+    if (int(traj.size()) != size_)
+        throw std::invalid_argument("Trajectory expected " + std::to_string(size_) + " waypoints but got " +
+                                    std::to_string(traj.size()));
+    update_();
+    for (int i = 0; i < size_; i++)
+        traj[i].vel = vel_.col(i);
+}
+
+void TrajDerivative::get_traj_vel(JointTrajectory &traj)
+{
+    if (traj.size() != size_ || traj.dof() != dof_)
+        throw std::invalid_argument("Trajectory expected " + std::to_string(size_) + " waypoints of size " +
+                                    std::to_string(dof_));
+    update_();
+    traj.vel = vel_.leftCols(size_).transpose();
+}
+
+int TrajDerivative::size()
+{
+    return size_;
+}
+
+Eigen::Ref<const Eigen::VectorXd> TrajDerivative::get_timestamps()
+{
+    return timestamps_.head(size_);
+}
+
+Eigen::Ref<const Eigen::MatrixXd> TrajDerivative::get_pos()
+{
+    return pos_.leftCols(size_);
+}
+
+Eigen::Ref<const Eigen::MatrixXd> TrajDerivative::get_vel()
+{
+    update_();
+    return vel_.leftCols(size_);
+}
+
+Eigen::Ref<const Eigen::MatrixXd> TrajDerivative::get_acc()
+{
+    update_();
+    update_acc_();
+    return acc_.leftCols(size_);
+}
+
+void TrajDerivative::update_()
+{
+    if (method_ == "window")
+        update_window_();
+    else
+        update_spline_();
+}
+
+int TrajDerivative::lower_bound_(double timestamp)
+{
+    return std::lower_bound(timestamps_.data(), timestamps_.data() + size_, timestamp) - timestamps_.data();
+}
+
+void TrajDerivative::update_window_()
+{
+    if (vel_valid_ >= size_)
+        return;
+    acc_valid_ = false;
+    if (size_ < 2)
+    {
+        vel_.leftCols(size_).setZero();
+        vel_valid_ = size_;
+        return;
+    }
+    // Same windows as the two-pointer walk of calc_joint_vel, found by binary search from the first
+    // outdated waypoint and then advanced monotonically
+    double t = timestamps_[vel_valid_];
+    int idx_0 = std::min(size_ - 2, std::max(0, lower_bound_(t - avg_window_s_) - 1));
+    int idx_1 = std::min(size_ - 2, std::max(0, lower_bound_(t - avg_window_s_ / 2) - 1));
+    int idx_2 = std::min(size_ - 1, lower_bound_(t + avg_window_s_ / 2));
+    int idx_3 = std::min(size_ - 1, lower_bound_(t + avg_window_s_));
+    for (int i = vel_valid_; i < size_; i++)
+    {
+        t = timestamps_[i];
+        while (idx_0 < size_ - 2 && timestamps_[idx_0 + 1] < t - avg_window_s_)
+            idx_0++;
+        while (idx_1 < size_ - 2 && timestamps_[idx_1 + 1] < t - avg_window_s_ / 2)
+            idx_1++;
+        while (idx_2 < size_ - 1 && timestamps_[idx_2] < t + avg_window_s_ / 2)
+            idx_2++;
+        while (idx_3 < size_ - 1 && timestamps_[idx_3] < t + avg_window_s_)
+            idx_3++;
+        vel_.col(i) = (pos_.col(idx_3) - pos_.col(idx_0)) / (timestamps_[idx_3] - timestamps_[idx_0]) / 2 +
+                      (pos_.col(idx_2) - pos_.col(idx_1)) / (timestamps_[idx_2] - timestamps_[idx_1]) / 2;
+    }
+    vel_valid_ = size_;
+}
+
+void TrajDerivative::update_spline_()
+{
+    if (spline_valid_)
+        return;
+    acc_valid_ = false;
+    spline_valid_ = true;
+    if (size_ == 0)
+        return;
+    if (size_ == 1)
+    {
+        vel_.col(0) = start_vel_;
+        return;
+    }
+    // C2 condition at the interior waypoint i, with h0 = t_i - t_{i-1} and h1 = t_{i+1} - t_i:
+    // vel_{i-1} / h0 + 2 (1 / h0 + 1 / h1) vel_i + vel_{i+1} / h1 = 3 ((p_i - p_{i-1}) / h0^2 + (p_{i+1} - p_i) / h1^2)
+    if (sweep_valid_ == 0)
+    {
+        sweep_c_[0] = 0;
+        sweep_d_.col(0) = start_vel_;
+        sweep_valid_ = 1;
+    }
+    for (int i = sweep_valid_; i < size_ - 1; i++)
+    {
+        double h0 = timestamps_[i] - timestamps_[i - 1];
+        double h1 = timestamps_[i + 1] - timestamps_[i];
+        double denom = 2 * (1 / h0 + 1 / h1) - sweep_c_[i - 1] / h0;
+        sweep_c_[i] = 1 / h1 / denom;
+        sweep_d_.col(i) = (3 * ((pos_.col(i) - pos_.col(i - 1)) / (h0 * h0) +
+                                (pos_.col(i + 1) - pos_.col(i)) / (h1 * h1)) -
+                           sweep_d_.col(i - 1) / h0) /
+                          denom;
+    }
+    sweep_valid_ = size_ - 1;
+    vel_.col(size_ - 1) = end_vel_;
+    for (int i = size_ - 2; i >= 0; i--)
+        vel_.col(i) = sweep_d_.col(i) - sweep_c_[i] * vel_.col(i + 1);
+}
+
+void TrajDerivative::update_acc_()
+{
+    if (acc_valid_)
+        return;
+    acc_valid_ = true;
+    if (size_ < 2)
+    {
+        acc_.leftCols(size_).setZero();
+        return;
+    }
+    // Second derivative of the cubic Hermite segment at its start, and at its end for the last waypoint
+    for (int i = 0; i < size_ - 1; i++)
+    {
+        double h = timestamps_[i + 1] - timestamps_[i];
+        acc_.col(i) = (6 * (pos_.col(i + 1) - pos_.col(i)) / h - 4 * vel_.col(i) - 2 * vel_.col(i + 1)) / h;
+    }
+    int n = size_ - 1;
+    double h = timestamps_[n] - timestamps_[n - 1];
+    acc_.col(n) = (-6 * (pos_.col(n) - pos_.col(n - 1)) / h + 2 * vel_.col(n - 1) + 4 * vel_.col(n)) / h;
+}
+
+} // namespace arx
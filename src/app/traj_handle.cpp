@@ -0,0 +1,84 @@
+#include "app/traj_handle.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+
+namespace arx
+{
+
+TrajHandle::TrajHandle(std::vector<double> waypoint_times)
+    : waypoint_times_(waypoint_times), future_(promise_.get_future().share())
+{
+    if (!std::is_sorted(waypoint_times_.begin(), waypoint_times_.end()))
+        throw std::invalid_argument("Trajectory waypoint times must be in ascending order");
+    progress_.waypoint_num = waypoint_times_.size();
+}
+
+TrajStatus TrajHandle::get_status()
+{
+    std::lock_guard<std::mutex> guard(mutex_);
+    return progress_.status;
+}
+
+TrajProgress TrajHandle::get_progress()
+{
+    std::lock_guard<std::mutex> guard(mutex_);
+    return progress_;
+}
+
+bool TrajHandle::is_done()
+{
+    return get_status() != TrajStatus::RUNNING;
+}
+
+bool TrajHandle::wait(double timeout)
+{
+    if (timeout < 0)
+        future_.wait();
+    else
+        future_.wait_for(std::chrono::duration<double>(timeout));
+    return is_done();
+}
+
+std::shared_future<TrajStatus> TrajHandle::get_future()
+{
+    return future_;
+}
+
+double TrajHandle::get_end_time()
+{
+    return waypoint_times_.empty() ? 0.0 : waypoint_times_.back();
+}
+
+void TrajHandle::update(double timestamp, double tracking_error)
+{
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (progress_.status != TrajStatus::RUNNING)
+        return;
+    progress_.next_waypoint =
+        std::upper_bound(waypoint_times_.begin(), waypoint_times_.end(), timestamp) - waypoint_times_.begin();
+    progress_.time_remaining = std::max(0.0, get_end_time() - timestamp);
+    tick_cnt_++;
+    tracking_error_sq_sum_ += tracking_error * tracking_error;
+    progress_.tracking_error_max = std::max(progress_.tracking_error_max, tracking_error);
+    progress_.tracking_error_rms = std::sqrt(tracking_error_sq_sum_ / tick_cnt_);
+}
+
+void TrajHandle::finish(TrajStatus status)
+{
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        if (progress_.status != TrajStatus::RUNNING)
+            return;
+        progress_.status = status;
+        if (status == TrajStatus::COMPLETED)
+        {
+            progress_.next_waypoint = progress_.waypoint_num;
+            progress_.time_remaining = 0.0;
+        }
+    }
+    promise_.set_value(status);
+}
+
+} // namespace arx
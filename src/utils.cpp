@@ -1,5 +1,7 @@
 
 #include "utils.h"
+#include <algorithm>
+#include <cmath>
 #include <cstdarg>
 #include <cstdio>
 
@@ -33,6 +35,86 @@ Eigen::VectorXd MovingAverageXd::filter(Eigen::VectorXd new_data)
     return window_sum_ / window_size_;
 }
 
+JointKalmanFilter::JointKalmanFilter(int dof, double pos_noise, double vel_noise, double jerk_noise)
+{
+    if (pos_noise <= 0 || vel_noise <= 0 || jerk_noise <= 0)
+        throw std::invalid_argument("Kalman filter noise parameters must be positive");
+    dof_ = dof;
+    pos_var_ = pos_noise * pos_noise;
+    vel_var_ = vel_noise * vel_noise;
+    jerk_noise_ = jerk_noise;
+    reset();
+}
+
+void JointKalmanFilter::reset()
+{
+    initialized_ = false;
+    x_.assign(dof_, Eigen::Vector3d::Zero());
+    P_.assign(dof_, Eigen::Matrix3d::Zero());
+}
+
+void JointKalmanFilter::update(double timestamp, const Eigen::VectorXd &pos, const Eigen::VectorXd &vel)
+{
+    if (pos.size() != dof_ || vel.size() != dof_)
+        throw std::invalid_argument("Joint state dimension mismatch");
+    if (!initialized_)
+    {
+        for (int i = 0; i < dof_; i++)
+        {
+            x_[i] << pos[i], vel[i], 0.0;
+            // The acceleration is unknown at start, its variance is the one reached after a second of jerk noise
+            P_[i] = Eigen::Vector3d(pos_var_, vel_var_, jerk_noise_).asDiagonal();
+        }
+        timestamp_ = timestamp;
+        initialized_ = true;
+        return;
+    }
+    double dt = timestamp - timestamp_;
+    if (dt <= 0)
+        return;
+    timestamp_ = timestamp;
+
+    Eigen::Matrix3d F;
+    F << 1, dt, dt * dt / 2, 0, 1, dt, 0, 0, 1;
+    double dt2 = dt * dt;
+    double dt3 = dt2 * dt;
+    Eigen::Matrix3d Q;
+    Q << dt3 * dt2 / 20, dt2 * dt2 / 8, dt3 / 6, dt2 * dt2 / 8, dt3 / 3, dt2 / 2, dt3 / 6, dt2 / 2, dt;
+    Q *= jerk_noise_;
+    Eigen::Matrix2d R = Eigen::Vector2d(pos_var_, vel_var_).asDiagonal();
+    for (int i = 0; i < dof_; i++)
+    {
+        Eigen::Vector3d &x = x_[i];
+        Eigen::Matrix3d &P = P_[i];
+        x = F * x;
+        P = F * P * F.transpose() + Q;
+        // Both the position and the velocity are measured: H = [I 0]
+        Eigen::Matrix2d S = P.topLeftCorner<2, 2>() + R;
+        Eigen::Matrix<double, 3, 2> K = P.leftCols<2>() * S.inverse();
+        x += K * (Eigen::Vector2d(pos[i], vel[i]) - x.head<2>());
+        P -= K * P.topRows<2>();
+        P = (P + P.transpose()) / 2;
+    }
+}
+
+void JointKalmanFilter::get_estimate(JointStateEstimate &estimate)
+{
+    estimate.timestamp = timestamp_;
+    for (int i = 0; i < dof_; i++)
+    {
+        estimate.pos[i] = x_[i][0];
+        estimate.vel[i] = x_[i][1];
+        estimate.acc[i] = x_[i][2];
+    }
+}
+
+JointStateEstimate JointKalmanFilter::get_estimate()
+{
+    JointStateEstimate estimate{dof_};
+    get_estimate(estimate);
+    return estimate;
+}
+
 // std::string vec2str(const Eigen::VectorXd& vec, int precision) {
 //   std::string str = "[";
 //   for (int i = 0; i < vec.size(); i++) {
@@ -47,17 +129,22 @@ Eigen::VectorXd MovingAverageXd::filter(Eigen::VectorXd new_data)
 //   return str;
 // }
 
-JointStateInterpolator::JointStateInterpolator(int dof, std::string method)
+JointStateInterpolator::JointStateInterpolator(int dof, std::string method, double blend_time) : traj_(dof)
 {
     if (method != "linear" && method != "cubic")
     {
         throw std::invalid_argument("Invalid interpolation method: " + method +
                                     ". Currently available: 'linear' or 'cubic'");
     }
+    if (blend_time < 0)
+    {
+        throw std::invalid_argument("Blend time must be non-negative");
+    }
     dof_ = dof;
     method_ = method;
     initialized_ = false;
-    traj_ = std::vector<JointState>();
+    blend_time_ = blend_time;
+    blend_coeffs_ = Eigen::MatrixXd::Zero(dof, 6);
 }
 
 void JointStateInterpolator::init(JointState start_state, JointState end_state)
@@ -74,9 +161,10 @@ void JointStateInterpolator::init(JointState start_state, JointState end_state)
     {
         throw std::invalid_argument("Joint state dimension mismatch");
     }
-    traj_.clear();
-    traj_.push_back(start_state);
-    traj_.push_back(end_state);
+    traj_ = JointTrajectory(dof_, 2);
+    traj_.set_state(0, start_state);
+    traj_.set_state(1, end_state);
+    blend_end_time_ = 0.0;
     initialized_ = true;
 }
 
@@ -86,8 +174,9 @@ void JointStateInterpolator::init_fixed(JointState start_state)
     {
         throw std::invalid_argument("Joint state dimension mismatch");
     }
-    traj_.clear();
-    traj_.push_back(start_state);
+    traj_ = JointTrajectory(dof_, 1);
+    traj_.set_state(0, start_state);
+    blend_end_time_ = 0.0;
     initialized_ = true;
 }
 
@@ -108,39 +197,10 @@ void JointStateInterpolator::append_waypoint(double current_time, JointState end
         throw std::invalid_argument("End time must be no less than current time");
     }
 
-    JointState current_state{dof_};
-
-    if (current_time < traj_[0].timestamp)
-    {
-        throw std::runtime_error("Current time must be no less than start time");
-    }
-    else
-    {
-        current_state = interpolate(current_time);
-    }
-
-    std::vector<JointState> prev_traj = traj_;
-    traj_.clear();
-    traj_.push_back(current_state);
-    for (int i = 0; i < prev_traj.size(); i++)
-    {
-        if (prev_traj[i].timestamp > current_time)
-        {
-            if (prev_traj[i].timestamp > end_state.timestamp)
-            {
-                traj_.push_back(end_state);
-                break;
-            }
-            else
-            {
-                traj_.push_back(prev_traj[i]);
-            }
-        }
-        if (i == prev_traj.size() - 1)
-        {
-            traj_.push_back(end_state);
-        }
-    }
+    // Keep the previous waypoints between now and the new one
+    JointTrajectory end_traj{dof_, 1};
+    end_traj.set_state(0, end_state);
+    restart_traj_(current_time, upper_bound_(current_time), upper_bound_(end_state.timestamp), end_traj, 0);
 }
 
 void JointStateInterpolator::override_waypoint(double current_time, JointState end_state)
@@ -160,139 +220,181 @@ void JointStateInterpolator::override_waypoint(double current_time, JointState e
         throw std::invalid_argument("End time must be no less than current time");
     }
 
-    JointState current_state{dof_};
-
-    if (current_time < traj_[0].timestamp)
-    {
-        throw std::runtime_error("Current time must be no less than start time");
-    }
-    else
-    {
-        current_state = interpolate(current_time);
-    }
-
-    std::vector<JointState> prev_traj = traj_;
-    traj_.clear();
-    traj_.push_back(current_state);
-    traj_.push_back(end_state);
+    JointTrajectory end_traj{dof_, 1};
+    end_traj.set_state(0, end_state);
+    restart_traj_(current_time, 0, 0, end_traj, 0);
 }
 
 void JointStateInterpolator::append_traj(double current_time, std::vector<JointState> traj)
+{
+    append_traj(current_time, JointTrajectory(traj));
+}
+
+void JointStateInterpolator::append_traj(double current_time, const JointTrajectory &traj)
 {
     if (!initialized_)
     {
         throw std::runtime_error("Interpolator not initialized");
     }
 
-    // remove all the new traj points that are before current time
-    while (traj.size() > 0 && traj[0].timestamp < current_time)
-    {
-        traj.erase(traj.begin());
-    }
-
-    if (traj.size() == 0)
+    // Skip all the new traj points that are before current time
+    int begin = first_new_waypoint_(current_time, traj);
+    if (begin == traj.size())
     {
         printf("JointStateInterpolator::append_traj: Empty trajectory\n");
         return;
     }
 
-    for (int i = 0; i < traj.size() - 1; i++)
-    {
-        if (traj[i].timestamp > traj[i + 1].timestamp)
-        {
-            throw std::invalid_argument("Trajectory timestamps must be in strictly ascending order");
-        }
-        if (traj[i].pos.size() != dof_ || traj[i + 1].pos.size() != dof_)
-        {
-            throw std::invalid_argument("Joint state dimension mismatch");
-        }
-    }
-
-    JointState current_state{dof_};
-    if (current_time < traj_[0].timestamp)
-    {
-        throw std::runtime_error("Current time must be no less than start time");
-    }
-    else
-    {
-        current_state = interpolate(current_time);
-    }
-
-    std::vector<JointState> prev_traj = traj_;
-    traj_.clear();
-    traj_.push_back(current_state);
-    double new_traj_start_time = traj[0].timestamp;
-    // Merge prev_traj before new_traj
-
-    while (prev_traj.size() > 0 && prev_traj[0].timestamp < new_traj_start_time)
-    {
-        if (prev_traj[0].timestamp > current_time)
-        {
-            traj_.push_back(prev_traj[0]);
-        }
-        prev_traj.erase(prev_traj.begin());
-    }
-    while (traj.size() > 0)
-    {
-        traj_.push_back(traj[0]);
-        traj.erase(traj.begin());
-    }
+    // Merge the previous waypoints before the new trajectory
+    int prev_begin = upper_bound_(current_time);
+    int prev_end = std::lower_bound(traj_.timestamps.data(), traj_.timestamps.data() + traj_.size(),
+                                    traj.timestamps[begin]) -
+                   traj_.timestamps.data();
+    restart_traj_(current_time, prev_begin, std::max(prev_begin, prev_end), traj, begin);
 }
 
 void JointStateInterpolator::override_traj(double current_time, std::vector<JointState> traj)
 {
+    override_traj(current_time, JointTrajectory(traj));
+}
 
+void JointStateInterpolator::override_traj(double current_time, const JointTrajectory &traj)
+{
     if (!initialized_)
     {
         throw std::runtime_error("Interpolator not initialized");
     }
 
-    // remove all the new traj points that are before current time
-    while (traj.size() > 0 && traj[0].timestamp < current_time)
+    // Skip all the new traj points that are before current time
+    int begin = first_new_waypoint_(current_time, traj);
+    if (begin == traj.size())
     {
-        traj.erase(traj.begin());
+        printf("JointStateInterpolator::override_traj: Empty trajectory\n");
+        return;
     }
+    restart_traj_(current_time, 0, 0, traj, begin);
+}
+
+int JointStateInterpolator::upper_bound_(double time)
+{
+    return std::upper_bound(traj_.timestamps.data(), traj_.timestamps.data() + traj_.size(), time) -
+           traj_.timestamps.data();
+}
 
-    if (traj.size() == 0)
+int JointStateInterpolator::first_new_waypoint_(double current_time, const JointTrajectory &traj)
+{
+    traj.check();
+    if (traj.size() > 0 && traj.dof() != dof_)
     {
-        printf("JointStateInterpolator::append_traj: Empty trajectory\n");
-        return;
+        throw std::invalid_argument("Joint state dimension mismatch");
     }
-
     for (int i = 0; i < traj.size() - 1; i++)
     {
-        if (traj[i].timestamp > traj[i + 1].timestamp)
+        if (traj.timestamps[i] > traj.timestamps[i + 1])
         {
             throw std::invalid_argument("Trajectory timestamps must be in strictly ascending order");
         }
-        if (traj[i].pos.size() != dof_ || traj[i + 1].pos.size() != dof_)
-        {
-            throw std::invalid_argument("Joint state dimension mismatch");
-        }
     }
+    int begin = 0;
+    while (begin < traj.size() && traj.timestamps[begin] < current_time)
+    {
+        begin++;
+    }
+    return begin;
+}
 
-    JointState current_state{dof_};
-    if (current_time < traj_[0].timestamp)
+void JointStateInterpolator::restart_traj_(double current_time, int prev_begin, int prev_end,
+                                           const JointTrajectory &traj, int begin)
+{
+    if (current_time < traj_.timestamps[0])
     {
         throw std::runtime_error("Current time must be no less than start time");
     }
-    else
-    {
-        current_state = interpolate(current_time);
+    JointState current_state = interpolate(current_time);
+    Eigen::VectorXd prev_vel, prev_acc;
+    pos_derivatives_(current_time, -1, prev_vel, prev_acc);
+
+    // The current state, then the kept rows of the previous trajectory, then the new rows, copied block by block
+    int prev_num = prev_end - prev_begin;
+    int num = traj.size() - begin;
+    JointTrajectory new_traj{dof_, 1 + prev_num + num};
+    new_traj.set_state(0, current_state);
+    new_traj.timestamps.segment(1, prev_num) = traj_.timestamps.segment(prev_begin, prev_num);
+    new_traj.pos.middleRows(1, prev_num) = traj_.pos.middleRows(prev_begin, prev_num);
+    new_traj.vel.middleRows(1, prev_num) = traj_.vel.middleRows(prev_begin, prev_num);
+    new_traj.torque.middleRows(1, prev_num) = traj_.torque.middleRows(prev_begin, prev_num);
+    new_traj.gripper_pos.segment(1, prev_num) = traj_.gripper_pos.segment(prev_begin, prev_num);
+    new_traj.timestamps.tail(num) = traj.timestamps.tail(num);
+    new_traj.pos.bottomRows(num) = traj.pos.bottomRows(num);
+    new_traj.vel.bottomRows(num) = traj.vel.bottomRows(num);
+    new_traj.torque.bottomRows(num) = traj.torque.bottomRows(num);
+    new_traj.gripper_pos.tail(num) = traj.gripper_pos.tail(num);
+    traj_ = std::move(new_traj);
+    start_blend_(current_time, prev_vel, prev_acc);
+}
+
+JointState JointStateInterpolator::interpolate(double time)
+{
+    JointState interp_state = interpolate_traj_(time);
+    if (time < blend_end_time_)
+    {
+        // O(1): evaluate the quintic offset and its derivative with Horner's scheme
+        double tau = time - blend_start_time_;
+        Eigen::VectorXd offset_pos = blend_coeffs_.col(5);
+        Eigen::VectorXd offset_vel = 5 * blend_coeffs_.col(5);
+        for (int k = 4; k >= 0; k--)
+        {
+            offset_pos = offset_pos * tau + blend_coeffs_.col(k);
+            if (k >= 1)
+                offset_vel = offset_vel * tau + k * blend_coeffs_.col(k);
+        }
+        interp_state.pos += offset_pos;
+        interp_state.vel += offset_vel;
     }
+    return interp_state;
+}
 
-    std::vector<JointState> prev_traj = traj_;
-    traj_.clear();
-    traj_.push_back(current_state);
+void JointStateInterpolator::pos_derivatives_(double time, double direction, Eigen::VectorXd &vel,
+                                              Eigen::VectorXd &acc)
+{
+    // One-sided finite differences of the interpolated position: direction -1 looks backwards (the trajectory that is
+    // being replaced), +1 forwards (the new trajectory)
+    const double h = 1E-3;
+    vel = Eigen::VectorXd::Zero(dof_);
+    acc = Eigen::VectorXd::Zero(dof_);
+    if (blend_time_ <= 0 || time + 2 * direction * h <= 0)
+        return;
+    Eigen::VectorXd pos0 = interpolate(time).pos;
+    Eigen::VectorXd pos1 = interpolate(time + direction * h).pos;
+    Eigen::VectorXd pos2 = interpolate(time + 2 * direction * h).pos;
+    vel = direction * (-3 * pos0 + 4 * pos1 - pos2) / (2 * h);
+    acc = (pos0 - 2 * pos1 + pos2) / (h * h);
+}
 
-    while (traj.size() > 0)
-    {
-        traj_.push_back(traj[0]);
-        traj.erase(traj.begin());
-    }
+void JointStateInterpolator::start_blend_(double current_time, const Eigen::VectorXd &prev_vel,
+                                          const Eigen::VectorXd &prev_acc)
+{
+    blend_end_time_ = 0.0;
+    if (blend_time_ <= 0)
+        return;
+    Eigen::VectorXd new_vel, new_acc;
+    pos_derivatives_(current_time, 1, new_vel, new_acc);
+    // The new trajectory starts from the current position, so only the velocity and acceleration differ. The offset
+    // goes from (0, d1, d2) to zero position, velocity and acceleration at tau = T.
+    double T = blend_time_;
+    Eigen::VectorXd d1 = prev_vel - new_vel;
+    Eigen::VectorXd d2 = prev_acc - new_acc;
+    blend_coeffs_.col(0).setZero();
+    blend_coeffs_.col(1) = d1;
+    blend_coeffs_.col(2) = d2 / 2;
+    blend_coeffs_.col(3) = -(12 * d1 * T + 3 * d2 * T * T) / (2 * std::pow(T, 3));
+    blend_coeffs_.col(4) = (16 * d1 * T + 3 * d2 * T * T) / (2 * std::pow(T, 4));
+    blend_coeffs_.col(5) = -(6 * d1 * T + d2 * T * T) / (2 * std::pow(T, 5));
+    blend_start_time_ = current_time;
+    blend_end_time_ = current_time + T;
 }
 
-JointState JointStateInterpolator::interpolate(double time)
+JointState JointStateInterpolator::interpolate_traj_(double time)
 {
 
     if (!initialized_)
@@ -304,75 +406,60 @@ JointState JointStateInterpolator::interpolate(double time)
         throw std::invalid_argument("Interpolate time must be greater than 0");
     }
 
-    if (traj_.size() == 0)
+    int n = traj_.size();
+    if (n == 0)
     {
         throw std::runtime_error("Empty trajectory");
     }
-    if (traj_.size() == 1)
-    {
-        JointState interp_state = traj_[0];
-        interp_state.timestamp = time;
-        return interp_state;
-    }
-
-    if (time <= traj_[0].timestamp)
+    if (n == 1 || time <= traj_.timestamps[0])
     {
-        JointState interp_state = traj_[0];
+        JointState interp_state = traj_.get_state(0);
         interp_state.timestamp = time;
         return interp_state;
     }
-    else if (time >= traj_.back().timestamp)
+    else if (time >= traj_.timestamps[n - 1])
     {
-        JointState interp_state = traj_.back();
+        JointState interp_state = traj_.get_state(n - 1);
         interp_state.timestamp = time;
         return interp_state;
     }
 
-    for (int i = 0; i <= traj_.size() - 2; i++)
+    // Segment i such that t_i <= time < t_{i + 1}, found by binary search
+    int i = upper_bound_(time) - 1;
+    double h = traj_.timestamps[i + 1] - traj_.timestamps[i];
+    double t = (time - traj_.timestamps[i]) / h;
+    JointState interp_result{dof_};
+    interp_result.timestamp = time;
+    // Torque and gripper pos are always linearly interpolated
+    interp_result.torque = ((1 - t) * traj_.torque.row(i) + t * traj_.torque.row(i + 1)).transpose();
+    interp_result.gripper_pos = (1 - t) * traj_.gripper_pos[i] + t * traj_.gripper_pos[i + 1];
+    if (method_ == "linear")
     {
-        JointState start_state = traj_[i];
-        JointState end_state = traj_[i + 1];
-        if (time >= start_state.timestamp && time <= end_state.timestamp)
-        {
-            if (method_ == "linear")
-            {
-                JointState interp_result = start_state + (end_state - start_state) * (time - start_state.timestamp) /
-                                                             (end_state.timestamp - start_state.timestamp);
-                interp_result.timestamp = time;
-                return interp_result;
-            }
-            else if (method_ == "cubic")
-            {
-                // Torque and gripper pos will still be linearly interpolated
-                JointState interp_result = start_state + (end_state - start_state) * (time - start_state.timestamp) /
-                                                             (end_state.timestamp - start_state.timestamp);
-                interp_result.timestamp = time;
-
-                // Cubic interpolation for pos and vel
-                double t = (time - start_state.timestamp) / (end_state.timestamp - start_state.timestamp);
-                double t2 = t * t;
-                double t3 = t2 * t;
-                double pos_a = 2 * t3 - 3 * t2 + 1;
-                double pos_b = t3 - 2 * t2 + t;
-                double pos_c = -2 * t3 + 3 * t2;
-                double pos_d = t3 - t2;
-                interp_result.pos =
-                    pos_a * start_state.pos + pos_b * start_state.vel + pos_c * end_state.pos + pos_d * end_state.vel;
-
-                double vel_a = 6 * t2 - 6 * t;
-                double vel_b = 3 * t2 - 4 * t + 1;
-                double vel_c = -6 * t2 + 6 * t;
-                double vel_d = 3 * t2 - 2 * t;
-                interp_result.vel =
-                    vel_a * start_state.pos + vel_b * start_state.vel + vel_c * end_state.pos + vel_d * end_state.vel;
-                return interp_result;
-            }
-        }
-        if (i == traj_.size() - 2)
-        {
-            throw std::runtime_error("Interpolation failed");
-        }
+        interp_result.pos = ((1 - t) * traj_.pos.row(i) + t * traj_.pos.row(i + 1)).transpose();
+        interp_result.vel = ((1 - t) * traj_.vel.row(i) + t * traj_.vel.row(i + 1)).transpose();
     }
+    else
+    {
+        // Cubic Hermite segment: the waypoint velocities are scaled by the segment duration h
+        double t2 = t * t;
+        double t3 = t2 * t;
+        double pos_a = 2 * t3 - 3 * t2 + 1;
+        double pos_b = t3 - 2 * t2 + t;
+        double pos_c = -2 * t3 + 3 * t2;
+        double pos_d = t3 - t2;
+        interp_result.pos = (pos_a * traj_.pos.row(i) + pos_b * h * traj_.vel.row(i) + pos_c * traj_.pos.row(i + 1) +
+                             pos_d * h * traj_.vel.row(i + 1))
+                                .transpose();
+
+        double vel_a = 6 * t2 - 6 * t;
+        double vel_b = 3 * t2 - 4 * t + 1;
+        double vel_c = -6 * t2 + 6 * t;
+        double vel_d = 3 * t2 - 2 * t;
+        interp_result.vel = (vel_a / h * traj_.pos.row(i) + vel_b * traj_.vel.row(i) +
+                             vel_c / h * traj_.pos.row(i + 1) + vel_d * traj_.vel.row(i + 1))
+                                .transpose();
+    }
+    return interp_result;
 }
 
 std::string JointStateInterpolator::to_string()
@@ -381,44 +468,179 @@ std::string JointStateInterpolator::to_string()
                       " Length: " + std::to_string(traj_.size()) + "\n";
     for (int i = 0; i < traj_.size(); i++)
     {
-        str += state2str(traj_[i]);
+        str += state2str(traj_.get_state(i));
     }
 
     return str;
 }
 
-void calc_joint_vel(std::vector<JointState> &traj, double avg_window_s)
+// Two-pointer walk over the averaging windows, shared by both trajectory types. The timestamps are not checked: a
+// repeated timestamp only matters if it ends up at both ends of a window.
+template <typename TimeFn, typename PosFn, typename SetVelFn>
+static void calc_window_vel(int size, double avg_window_s, TimeFn time, PosFn pos, SetVelFn set_vel)
 {
-    if (traj.size() < 2)
-    {
-        return;
-    }
     int idx_0 = 0;
     int idx_1 = 0;
     int idx_2 = 0;
     int idx_3 = 0;
-    for (int i = 0; i < traj.size(); i++)
+    for (int i = 0; i < size; i++)
     {
-        while (idx_0 < traj.size() - 2 && traj[idx_0 + 1].timestamp < traj[i].timestamp - avg_window_s)
+        while (idx_0 < size - 2 && time(idx_0 + 1) < time(i) - avg_window_s)
         {
             idx_0++;
         }
-        while (idx_1 < traj.size() - 2 && traj[idx_1 + 1].timestamp < traj[i].timestamp - avg_window_s / 2)
+        while (idx_1 < size - 2 && time(idx_1 + 1) < time(i) - avg_window_s / 2)
         {
             idx_1++;
         }
-        while (idx_2 < traj.size() - 1 && traj[idx_2].timestamp < traj[i].timestamp + avg_window_s / 2)
+        while (idx_2 < size - 1 && time(idx_2) < time(i) + avg_window_s / 2)
         {
             idx_2++;
         }
-        while (idx_3 < traj.size() - 1 && traj[idx_3].timestamp < traj[i].timestamp + avg_window_s)
+        while (idx_3 < size - 1 && time(idx_3) < time(i) + avg_window_s)
         {
             idx_3++;
         }
         assert(idx_0 <= idx_1 && idx_1 < idx_2 && idx_2 <= idx_3);
-        traj[i].vel = (traj[idx_3].pos - traj[idx_0].pos) / (traj[idx_3].timestamp - traj[idx_0].timestamp) / 2 +
-                      (traj[idx_2].pos - traj[idx_1].pos) / (traj[idx_2].timestamp - traj[idx_1].timestamp) / 2;
+        set_vel(i, (pos(idx_3) - pos(idx_0)) / (time(idx_3) - time(idx_0)) / 2 +
+                       (pos(idx_2) - pos(idx_1)) / (time(idx_2) - time(idx_1)) / 2);
+    }
+}
+
+void calc_joint_vel(std::vector<JointState> &traj, double avg_window_s)
+{
+    if (traj.size() < 2)
+    {
+        return;
+    }
+    calc_window_vel(
+        int(traj.size()), avg_window_s, [&](int i) { return traj[i].timestamp; },
+        [&](int i) -> const VecDoF & { return traj[i].pos; }, [&](int i, const VecDoF &vel) { traj[i].vel = vel; });
+}
+
+void calc_joint_vel(JointTrajectory &traj, double avg_window_s)
+{
+    if (traj.size() < 2)
+    {
+        return;
     }
+    calc_window_vel(
+        traj.size(), avg_window_s, [&](int i) { return traj.timestamps[i]; },
+        [&](int i) -> VecDoF { return traj.pos.row(i).transpose(); },
+        [&](int i, const VecDoF &vel) { traj.vel.row(i) = vel.transpose(); });
+}
+
+EEFStateInterpolator::EEFStateInterpolator(std::string method)
+{
+    if (method != "linear" && method != "cubic")
+    {
+        throw std::invalid_argument("Invalid interpolation method: " + method +
+                                    ". Currently available: 'linear' or 'cubic'");
+    }
+    method_ = method;
+}
+
+void EEFStateInterpolator::init_fixed(EEFStateSE3 start_state)
+{
+    traj_.clear();
+    traj_.push_back(start_state);
+    initialized_ = true;
+}
+
+void EEFStateInterpolator::override_waypoint(double current_time, EEFStateSE3 end_state)
+{
+    override_traj(current_time, std::vector<EEFStateSE3>{end_state});
+}
+
+void EEFStateInterpolator::override_traj(double current_time, std::vector<EEFStateSE3> traj)
+{
+    if (!initialized_)
+    {
+        throw std::runtime_error("Interpolator not initialized");
+    }
+    if (current_time < traj_[0].timestamp)
+    {
+        throw std::runtime_error("Current time must be no less than start time");
+    }
+    for (int i = 0; i + 1 < int(traj.size()); i++)
+    {
+        if (traj[i].timestamp >= traj[i + 1].timestamp)
+        {
+            throw std::invalid_argument("Trajectory timestamps must be in strictly ascending order");
+        }
+    }
+
+    EEFStateSE3 current_state = interpolate(current_time);
+    traj_.clear();
+    traj_.push_back(current_state);
+    for (const EEFStateSE3 &state : traj)
+    {
+        if (state.timestamp > current_time)
+            traj_.push_back(state);
+    }
+}
+
+Eigen::Vector3d EEFStateInterpolator::pos_tangent_(int index)
+{
+    if (index == 0 || index == int(traj_.size()) - 1)
+        return Eigen::Vector3d::Zero();
+    return (traj_[index + 1].pose.pos - traj_[index - 1].pose.pos) /
+           (traj_[index + 1].timestamp - traj_[index - 1].timestamp);
+}
+
+EEFStateSE3 EEFStateInterpolator::interpolate(double time)
+{
+    if (!initialized_)
+    {
+        throw std::runtime_error("Interpolator not initialized");
+    }
+    if (time <= traj_[0].timestamp || traj_.size() == 1)
+    {
+        EEFStateSE3 interp_state = traj_[0];
+        interp_state.timestamp = time;
+        return interp_state;
+    }
+    else if (time >= traj_.back().timestamp)
+    {
+        EEFStateSE3 interp_state = traj_.back();
+        interp_state.timestamp = time;
+        return interp_state;
+    }
+
+    int i = 0;
+    while (traj_[i + 1].timestamp < time)
+        i++;
+    const EEFStateSE3 &start_state = traj_[i];
+    const EEFStateSE3 &end_state = traj_[i + 1];
+    double duration = end_state.timestamp - start_state.timestamp;
+    double t = (time - start_state.timestamp) / duration;
+
+    EEFStateSE3 interp_state;
+    interp_state.timestamp = time;
+    interp_state.pose = start_state.pose.interpolate(end_state.pose, t);
+    interp_state.gripper_pos = start_state.gripper_pos + (end_state.gripper_pos - start_state.gripper_pos) * t;
+    if (method_ == "cubic")
+    {
+        // Cubic hermite basis, same as JointStateInterpolator
+        double t2 = t * t;
+        double t3 = t2 * t;
+        interp_state.pose.pos = (2 * t3 - 3 * t2 + 1) * start_state.pose.pos +
+                                (t3 - 2 * t2 + t) * duration * pos_tangent_(i) +
+                                (-2 * t3 + 3 * t2) * end_state.pose.pos + (t3 - t2) * duration * pos_tangent_(i + 1);
+    }
+    return interp_state;
+}
+
+bool EEFStateInterpolator::is_initialized()
+{
+    return initialized_;
+}
+
+double EEFStateInterpolator::get_end_time()
+{
+    if (!initialized_)
+        throw std::runtime_error("Interpolator not initialized");
+    return traj_.back().timestamp;
 }
 
 std::string joint_traj2str(const std::vector<JointState> &traj, int precision)
@@ -447,6 +669,13 @@ bool JointStateInterpolator::is_initialized()
 {
     return initialized_;
 }
+
+double JointStateInterpolator::get_end_time()
+{
+    if (!initialized_)
+        throw std::runtime_error("Interpolator not initialized");
+    return traj_.timestamps[traj_.size() - 1];
+}
 } // namespace arx
 
 std::string vec2str(const Eigen::VectorXd &vec, int precision)
@@ -0,0 +1,29 @@
+#include "app/config.h"
+#include "app/reachability_map.h"
+#include <iostream>
+#include <string>
+
+using namespace arx;
+
+// Usage: generate_reachability_map <robot_model> [output_path] [sample_num] [voxel_size]
+// By default the map is written to robot_config.reachability_map_path, where the cartesian controller loads it from.
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        std::cout << "Usage: " << argv[0] << " <robot_model> [output_path] [sample_num] [voxel_size]" << std::endl;
+        return 1;
+    }
+    RobotConfig robot_config = RobotConfigFactory::get_instance().get_config(argv[1]);
+    std::string output_path = argc > 2 ? argv[2] : robot_config.reachability_map_path;
+    long int sample_num = argc > 3 ? std::stol(argv[3]) : 2000000;
+    double voxel_size = argc > 4 ? std::stod(argv[4]) : 0.03;
+
+    std::cout << "Generating reachability map for " << robot_config.robot_model << " with " << sample_num
+              << " samples, voxel size " << voxel_size << "m" << std::endl;
+    ReachabilityMap::generate(robot_config.urdf_path, robot_config.joint_dof, robot_config.joint_pos_min,
+                              robot_config.joint_pos_max, robot_config.base_link_name, robot_config.eef_link_name,
+                              output_path, voxel_size, 2, sample_num);
+    std::cout << "Reachability map is saved to " << output_path << std::endl;
+    return 0;
+}